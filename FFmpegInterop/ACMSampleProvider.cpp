@@ -27,8 +27,8 @@ using namespace wil;
 
 namespace winrt::FFmpegInterop::implementation
 {
-	ACMSampleProvider::ACMSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader) :
-		SampleProvider(formatContext, stream, reader)
+	ACMSampleProvider::ACMSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext) :
+		SampleProvider(formatContext, stream, reader, move(bsfContext))
 	{
 
 	}
@@ -38,7 +38,7 @@ namespace winrt::FFmpegInterop::implementation
 		// We intentionally don't call SampleProvider::SetEncodingProperties() here. We'll set all of the encoding properties we need.
 
 		// FFmpeg strips the wave format header from the codec private data. Recreate it.
-		const AVCodecParameters* codecPar{ m_stream->codecpar };
+		const AVCodecParameters* codecPar{ m_codecPar };
 		vector<uint8_t> waveFormatBuf(sizeof(WAVEFORMATEXTENSIBLE) + codecPar->extradata_size);
 		const bool setValidBitsPerSample{ codecPar->bits_per_coded_sample % BITS_PER_BYTE != 0 };
 
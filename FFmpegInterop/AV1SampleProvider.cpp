@@ -25,8 +25,8 @@ using namespace std;
 
 namespace winrt::FFmpegInterop::implementation
 {
-	AV1SampleProvider::AV1SampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader) :
-		SampleProvider(formatContext, stream, reader)
+	AV1SampleProvider::AV1SampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext) :
+		SampleProvider(formatContext, stream, reader, move(bsfContext))
 	{
 
 	}
@@ -56,8 +56,8 @@ namespace winrt::FFmpegInterop::implementation
 	IBuffer AV1SampleProvider::TransformSample(_Inout_ AVPacket_ptr packet, _In_ bool isKeyFrame)
 	{
 		// FFmpeg strips out the AV1CodecConfigurationRecord so extradata only contains config OBUs
-		const uint8_t* configOBUs{ m_stream->codecpar->extradata };
-		size_t configOBUsSize{ static_cast<size_t>(m_stream->codecpar->extradata_size) };
+		const uint8_t* configOBUs{ m_codecPar->extradata };
+		size_t configOBUsSize{ static_cast<size_t>(m_codecPar->extradata_size) };
 
 		// Prepend any config OBUs to key frames
 		if (isKeyFrame && configOBUs != nullptr && configOBUsSize != 0)
@@ -0,0 +1,1098 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "AudioConversion.h"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <tmmintrin.h>
+#define FFMPEG_INTEROP_SSE2
+#elif defined(_M_ARM64)
+#include <arm64_neon.h>
+#define FFMPEG_INTEROP_NEON
+#endif
+
+using namespace std;
+
+namespace
+{
+#if defined(FFMPEG_INTEROP_SSE2)
+	bool IsSsse3Supported() noexcept
+	{
+#ifdef PF_SSSE3_INSTRUCTIONS_AVAILABLE
+		static const bool isSsse3Supported{ IsProcessorFeaturePresent(PF_SSSE3_INSTRUCTIONS_AVAILABLE) != FALSE };
+		return isSsse3Supported;
+#else
+		return false;
+#endif
+	}
+#endif
+
+	// Largest channel count ConvertToInterleaved() handles, which lets it keep its plane pointers on the stack
+	constexpr int MAX_INTERLEAVED_CHANNELS{ 64 };
+
+	// Samples (across all channels) converted at a time before they're interleaved. The block stays in L1 and on the stack.
+	constexpr int BLOCK_SAMPLE_COUNT{ 2048 };
+
+	template <bool isBigEndian>
+	void ConvertF64ToF32Impl(_Out_writes_(sampleCount) float* dst, _In_reads_bytes_(8 * sampleCount) const uint8_t* src, _In_ size_t sampleCount) noexcept
+	{
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		for (; i + 4 <= sampleCount; i += 4)
+		{
+			__m128i a{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 8 * i)) };
+			__m128i b{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 8 * i + 16)) };
+
+			if constexpr (isBigEndian)
+			{
+				// Swap the bytes in each 16-bit word, then reverse the words in each 64-bit lane
+				a = _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+				a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(a, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+				b = _mm_or_si128(_mm_slli_epi16(b, 8), _mm_srli_epi16(b, 8));
+				b = _mm_shufflehi_epi16(_mm_shufflelo_epi16(b, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+			}
+
+			const __m128 lo{ _mm_cvtpd_ps(_mm_castsi128_pd(a)) };
+			const __m128 hi{ _mm_cvtpd_ps(_mm_castsi128_pd(b)) };
+			_mm_storeu_ps(dst + i, _mm_movelh_ps(lo, hi));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		for (; i + 4 <= sampleCount; i += 4)
+		{
+			uint8x16_t a{ vld1q_u8(src + 8 * i) };
+			uint8x16_t b{ vld1q_u8(src + 8 * i + 16) };
+
+			if constexpr (isBigEndian)
+			{
+				a = vrev64q_u8(a);
+				b = vrev64q_u8(b);
+			}
+
+			const float32x2_t lo{ vcvt_f32_f64(vreinterpretq_f64_u8(a)) };
+			const float32x2_t hi{ vcvt_f32_f64(vreinterpretq_f64_u8(b)) };
+			vst1q_f32(dst + i, vcombine_f32(lo, hi));
+		}
+#endif
+
+		for (; i < sampleCount; i++)
+		{
+			uint64_t bits;
+			memcpy(&bits, src + 8 * i, sizeof(bits));
+
+			if constexpr (isBigEndian)
+			{
+				bits = _byteswap_uint64(bits);
+			}
+
+			double sample;
+			memcpy(&sample, &bits, sizeof(sample));
+			dst[i] = static_cast<float>(sample);
+		}
+	}
+
+	// Sample value conversions over contiguous runs of samples
+
+	void ConvertRun(_Out_writes_(count) int16_t* dst, _In_reads_(count) const int16_t* src, _In_ size_t count) noexcept
+	{
+		memcpy(dst, src, count * sizeof(*dst));
+	}
+
+	void ConvertRun(_Out_writes_(count) float* dst, _In_reads_(count) const float* src, _In_ size_t count) noexcept
+	{
+		memcpy(dst, src, count * sizeof(*dst));
+	}
+
+	void ConvertRun(_Out_writes_(count) int32_t* dst, _In_reads_(count) const int32_t* src, _In_ size_t count) noexcept
+	{
+		memcpy(dst, src, count * sizeof(*dst));
+	}
+
+	// dst[i] = clip(round(src[i] * 2^15))
+	void ConvertRun(_Out_writes_(count) int16_t* dst, _In_reads_(count) const float* src, _In_ size_t count) noexcept
+	{
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		const __m128 scale{ _mm_set1_ps(32768.0f) };
+		const __m128 minValue{ _mm_set1_ps(-32768.0f) };
+		const __m128 maxValue{ _mm_set1_ps(32767.0f) };
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128 a{ _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), minValue), maxValue) };
+			const __m128 b{ _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), minValue), maxValue) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		const float32x4_t minValue{ vdupq_n_f32(-32768.0f) };
+		const float32x4_t maxValue{ vdupq_n_f32(32767.0f) };
+		for (; i + 8 <= count; i += 8)
+		{
+			const float32x4_t a{ vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(src + i), 32768.0f), minValue), maxValue) };
+			const float32x4_t b{ vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(src + i + 4), 32768.0f), minValue), maxValue) };
+			vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b))));
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			dst[i] = static_cast<int16_t>(lrintf(clamp(src[i] * 32768.0f, -32768.0f, 32767.0f)));
+		}
+	}
+
+	// dst[i] = src[i] / 2^16
+	void ConvertRun(_Out_writes_(count) int16_t* dst, _In_reads_(count) const int32_t* src, _In_ size_t count) noexcept
+	{
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i a{ _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), 16) };
+			const __m128i b{ _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 4)), 16) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(a, b));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		for (; i + 8 <= count; i += 8)
+		{
+			vst1q_s16(dst + i, vcombine_s16(vshrn_n_s32(vld1q_s32(src + i), 16), vshrn_n_s32(vld1q_s32(src + i + 4), 16)));
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			dst[i] = static_cast<int16_t>(src[i] >> 16);
+		}
+	}
+
+	// dst[i] = src[i] * 2^16
+	void ConvertRun(_Out_writes_(count) int32_t* dst, _In_reads_(count) const int16_t* src, _In_ size_t count) noexcept
+	{
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		for (; i + 8 <= count; i += 8)
+		{
+			// Unpacking each sample into the high half of a 32-bit lane is the shift
+			const __m128i v{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(_mm_setzero_si128(), v));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(_mm_setzero_si128(), v));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		for (; i + 8 <= count; i += 8)
+		{
+			const int16x8_t v{ vld1q_s16(src + i) };
+			vst1q_s32(dst + i, vshll_n_s16(vget_low_s16(v), 16));
+			vst1q_s32(dst + i + 4, vshll_n_s16(vget_high_s16(v), 16));
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			dst[i] = static_cast<int32_t>(static_cast<uint32_t>(src[i]) << 16);
+		}
+	}
+
+	// dst[i] = clip(round(src[i] * 2^23)) * 2^8
+	void ConvertRun(_Out_writes_(count) int32_t* dst, _In_reads_(count) const float* src, _In_ size_t count) noexcept
+	{
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		const __m128 scale{ _mm_set1_ps(8388608.0f) };
+		const __m128 minValue{ _mm_set1_ps(-8388608.0f) };
+		const __m128 maxValue{ _mm_set1_ps(8388607.0f) };
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 v{ _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), minValue), maxValue) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_slli_epi32(_mm_cvtps_epi32(v), 8));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		const float32x4_t minValue{ vdupq_n_f32(-8388608.0f) };
+		const float32x4_t maxValue{ vdupq_n_f32(8388607.0f) };
+		for (; i + 4 <= count; i += 4)
+		{
+			const float32x4_t v{ vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(src + i), 8388608.0f), minValue), maxValue) };
+			vst1q_s32(dst + i, vshlq_n_s32(vcvtnq_s32_f32(v), 8));
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			dst[i] = static_cast<int32_t>(static_cast<uint32_t>(lrintf(clamp(src[i] * 8388608.0f, -8388608.0f, 8388607.0f))) << 8);
+		}
+	}
+
+	// dst[i] = src[i] / 2^15
+	void ConvertRun(_Out_writes_(count) float* dst, _In_reads_(count) const int16_t* src, _In_ size_t count) noexcept
+	{
+		constexpr float scale{ 1.0f / (1 << 15) };
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		for (; i + 8 <= count; i += 8)
+		{
+			// Sign extend by unpacking each sample into the high half of a 32-bit lane
+			const __m128i v{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)) };
+			const __m128i lo{ _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16) };
+			const __m128i hi{ _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16) };
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), _mm_set1_ps(scale)));
+			_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), _mm_set1_ps(scale)));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		for (; i + 8 <= count; i += 8)
+		{
+			const int16x8_t v{ vld1q_s16(src + i) };
+			vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+			vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			dst[i] = src[i] * scale;
+		}
+	}
+
+	// dst[i] = src[i] / 2^31
+	void ConvertRun(_Out_writes_(count) float* dst, _In_reads_(count) const int32_t* src, _In_ size_t count) noexcept
+	{
+		constexpr float scale{ 1.0f / (1U << 31) };
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i v{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)) };
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(scale)));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		for (; i + 4 <= count; i += 4)
+		{
+			vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(src + i)), scale));
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			dst[i] = src[i] * scale;
+		}
+	}
+
+	// Interleaves channel planes. Stereo and 7.1 have vectorized paths, other channel counts get unrolled loops.
+
+	template <class T, int channels>
+	void InterleaveScalar(_Out_writes_(channels * count) T* dst, _In_reads_(channels) const T* const* planes, _In_ size_t start, _In_ size_t count) noexcept
+	{
+		for (size_t i{ start }; i < count; i++)
+		{
+			for (int c{ 0 }; c < channels; c++)
+			{
+				dst[i * channels + c] = planes[c][i];
+			}
+		}
+	}
+
+	void InterleaveStereo(_Out_writes_(2 * count) int16_t* dst, _In_reads_(2) const int16_t* const* planes, _In_ size_t count) noexcept
+	{
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i l{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i)) };
+			const __m128i r{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i)) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), _mm_unpacklo_epi16(l, r));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i + 8), _mm_unpackhi_epi16(l, r));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		for (; i + 8 <= count; i += 8)
+		{
+			vst2q_s16(dst + 2 * i, int16x8x2_t{ vld1q_s16(planes[0] + i), vld1q_s16(planes[1] + i) });
+		}
+#endif
+
+		InterleaveScalar<int16_t, 2>(dst, planes, i, count);
+	}
+
+	void InterleaveStereo(_Out_writes_(2 * count) float* dst, _In_reads_(2) const float* const* planes, _In_ size_t count) noexcept
+	{
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 l{ _mm_loadu_ps(planes[0] + i) };
+			const __m128 r{ _mm_loadu_ps(planes[1] + i) };
+			_mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(l, r));
+			_mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(l, r));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		for (; i + 4 <= count; i += 4)
+		{
+			vst2q_f32(dst + 2 * i, float32x4x2_t{ vld1q_f32(planes[0] + i), vld1q_f32(planes[1] + i) });
+		}
+#endif
+
+		InterleaveScalar<float, 2>(dst, planes, i, count);
+	}
+
+#if defined(FFMPEG_INTEROP_SSE2)
+	// Interleaves three vectors of four 32-bit elements: a0 b0 c0 a1 | b1 c1 a2 b2 | c2 a3 b3 c3
+	void Interleave3x4(_Out_writes_(12) float* dst, _In_ __m128 a, _In_ __m128 b, _In_ __m128 c) noexcept
+	{
+		const __m128 ab{ _mm_unpacklo_ps(a, b) };
+		const __m128 ca{ _mm_unpacklo_ps(c, a) };
+		const __m128 bc{ _mm_unpacklo_ps(b, c) };
+		_mm_storeu_ps(dst, _mm_shuffle_ps(ab, ca, _MM_SHUFFLE(3, 0, 1, 0)));
+		_mm_storeu_ps(dst + 4, _mm_shuffle_ps(bc, _mm_unpackhi_ps(a, b), _MM_SHUFFLE(1, 0, 3, 2)));
+		_mm_storeu_ps(dst + 8, _mm_shuffle_ps(_mm_unpackhi_ps(c, a), _mm_unpackhi_ps(b, c), _MM_SHUFFLE(3, 2, 3, 0)));
+	}
+#endif
+
+	void Interleave6(_Out_writes_(6 * count) int16_t* dst, _In_reads_(6) const int16_t* const* planes, _In_ size_t count) noexcept
+	{
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		// Zip channel pairs, then interleave the three pairs as 32-bit elements
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128 lo[3];
+			__m128 hi[3];
+			for (int c{ 0 }; c < 3; c++)
+			{
+				const __m128i l{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2 * c] + i)) };
+				const __m128i r{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2 * c + 1] + i)) };
+				lo[c] = _mm_castsi128_ps(_mm_unpacklo_epi16(l, r));
+				hi[c] = _mm_castsi128_ps(_mm_unpackhi_epi16(l, r));
+			}
+
+			float* out{ reinterpret_cast<float*>(dst + 6 * i) };
+			Interleave3x4(out, lo[0], lo[1], lo[2]);
+			Interleave3x4(out + 12, hi[0], hi[1], hi[2]);
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		// Zip channel pairs, then interleave the three pairs as 32-bit elements
+		for (; i + 8 <= count; i += 8)
+		{
+			int32x4_t p[3][2];
+			for (int c{ 0 }; c < 3; c++)
+			{
+				const int16x8x2_t z{ vzipq_s16(vld1q_s16(planes[2 * c] + i), vld1q_s16(planes[2 * c + 1] + i)) };
+				p[c][0] = vreinterpretq_s32_s16(z.val[0]);
+				p[c][1] = vreinterpretq_s32_s16(z.val[1]);
+			}
+
+			vst3q_s32(reinterpret_cast<int32_t*>(dst + 6 * i), int32x4x3_t{ p[0][0], p[1][0], p[2][0] });
+			vst3q_s32(reinterpret_cast<int32_t*>(dst + 6 * i + 24), int32x4x3_t{ p[0][1], p[1][1], p[2][1] });
+		}
+#endif
+
+		InterleaveScalar<int16_t, 6>(dst, planes, i, count);
+	}
+
+	void Interleave6(_Out_writes_(6 * count) float* dst, _In_reads_(6) const float* const* planes, _In_ size_t count) noexcept
+	{
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		// Transpose the first four channels, then fill the remaining two slots of each sample from the last two channels
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 a0{ _mm_loadu_ps(planes[0] + i) };
+			__m128 a1{ _mm_loadu_ps(planes[1] + i) };
+			__m128 a2{ _mm_loadu_ps(planes[2] + i) };
+			__m128 a3{ _mm_loadu_ps(planes[3] + i) };
+			_MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+
+			const __m128 b4{ _mm_loadu_ps(planes[4] + i) };
+			const __m128 b5{ _mm_loadu_ps(planes[5] + i) };
+			const __m128 lo{ _mm_unpacklo_ps(b4, b5) };
+			const __m128 hi{ _mm_unpackhi_ps(b4, b5) };
+
+			float* out{ dst + 6 * i };
+			_mm_storeu_ps(out, a0);
+			_mm_storeu_ps(out + 4, _mm_movelh_ps(lo, a1));
+			_mm_storeu_ps(out + 8, _mm_shuffle_ps(a1, lo, _MM_SHUFFLE(3, 2, 3, 2)));
+			_mm_storeu_ps(out + 12, a2);
+			_mm_storeu_ps(out + 16, _mm_movelh_ps(hi, a3));
+			_mm_storeu_ps(out + 20, _mm_shuffle_ps(a3, hi, _MM_SHUFFLE(3, 2, 3, 2)));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		// Zip channel pairs, then interleave the three pairs as 64-bit elements
+		for (; i + 4 <= count; i += 4)
+		{
+			uint64x2_t p[3][2];
+			for (int c{ 0 }; c < 3; c++)
+			{
+				const float32x4x2_t z{ vzipq_f32(vld1q_f32(planes[2 * c] + i), vld1q_f32(planes[2 * c + 1] + i)) };
+				p[c][0] = vreinterpretq_u64_f32(z.val[0]);
+				p[c][1] = vreinterpretq_u64_f32(z.val[1]);
+			}
+
+			vst3q_u64(reinterpret_cast<uint64_t*>(dst + 6 * i), uint64x2x3_t{ p[0][0], p[1][0], p[2][0] });
+			vst3q_u64(reinterpret_cast<uint64_t*>(dst + 6 * i + 12), uint64x2x3_t{ p[0][1], p[1][1], p[2][1] });
+		}
+#endif
+
+		InterleaveScalar<float, 6>(dst, planes, i, count);
+	}
+
+	void Interleave8(_Out_writes_(8 * count) int16_t* dst, _In_reads_(8) const int16_t* const* planes, _In_ size_t count) noexcept
+	{
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		// 8x8 transpose of 16-bit samples
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i a[8];
+			for (int c{ 0 }; c < 8; c++)
+			{
+				a[c] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[c] + i));
+			}
+
+			const __m128i t0{ _mm_unpacklo_epi16(a[0], a[1]) };
+			const __m128i t1{ _mm_unpackhi_epi16(a[0], a[1]) };
+			const __m128i t2{ _mm_unpacklo_epi16(a[2], a[3]) };
+			const __m128i t3{ _mm_unpackhi_epi16(a[2], a[3]) };
+			const __m128i t4{ _mm_unpacklo_epi16(a[4], a[5]) };
+			const __m128i t5{ _mm_unpackhi_epi16(a[4], a[5]) };
+			const __m128i t6{ _mm_unpacklo_epi16(a[6], a[7]) };
+			const __m128i t7{ _mm_unpackhi_epi16(a[6], a[7]) };
+
+			const __m128i u0{ _mm_unpacklo_epi32(t0, t2) };
+			const __m128i u1{ _mm_unpackhi_epi32(t0, t2) };
+			const __m128i u2{ _mm_unpacklo_epi32(t1, t3) };
+			const __m128i u3{ _mm_unpackhi_epi32(t1, t3) };
+			const __m128i u4{ _mm_unpacklo_epi32(t4, t6) };
+			const __m128i u5{ _mm_unpackhi_epi32(t4, t6) };
+			const __m128i u6{ _mm_unpacklo_epi32(t5, t7) };
+			const __m128i u7{ _mm_unpackhi_epi32(t5, t7) };
+
+			__m128i* out{ reinterpret_cast<__m128i*>(dst + 8 * i) };
+			_mm_storeu_si128(out, _mm_unpacklo_epi64(u0, u4));
+			_mm_storeu_si128(out + 1, _mm_unpackhi_epi64(u0, u4));
+			_mm_storeu_si128(out + 2, _mm_unpacklo_epi64(u1, u5));
+			_mm_storeu_si128(out + 3, _mm_unpackhi_epi64(u1, u5));
+			_mm_storeu_si128(out + 4, _mm_unpacklo_epi64(u2, u6));
+			_mm_storeu_si128(out + 5, _mm_unpackhi_epi64(u2, u6));
+			_mm_storeu_si128(out + 6, _mm_unpacklo_epi64(u3, u7));
+			_mm_storeu_si128(out + 7, _mm_unpackhi_epi64(u3, u7));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		// Zip channel pairs, then interleave the pairs as 32-bit elements
+		for (; i + 8 <= count; i += 8)
+		{
+			int32x4_t p[4][2];
+			for (int c{ 0 }; c < 4; c++)
+			{
+				const int16x8x2_t z{ vzipq_s16(vld1q_s16(planes[2 * c] + i), vld1q_s16(planes[2 * c + 1] + i)) };
+				p[c][0] = vreinterpretq_s32_s16(z.val[0]);
+				p[c][1] = vreinterpretq_s32_s16(z.val[1]);
+			}
+
+			vst4q_s32(reinterpret_cast<int32_t*>(dst + 8 * i), int32x4x4_t{ p[0][0], p[1][0], p[2][0], p[3][0] });
+			vst4q_s32(reinterpret_cast<int32_t*>(dst + 8 * i + 32), int32x4x4_t{ p[0][1], p[1][1], p[2][1], p[3][1] });
+		}
+#endif
+
+		InterleaveScalar<int16_t, 8>(dst, planes, i, count);
+	}
+
+	void Interleave8(_Out_writes_(8 * count) float* dst, _In_reads_(8) const float* const* planes, _In_ size_t count) noexcept
+	{
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		// Two 4x4 transposes of 32-bit samples
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 a0{ _mm_loadu_ps(planes[0] + i) };
+			__m128 a1{ _mm_loadu_ps(planes[1] + i) };
+			__m128 a2{ _mm_loadu_ps(planes[2] + i) };
+			__m128 a3{ _mm_loadu_ps(planes[3] + i) };
+			__m128 b0{ _mm_loadu_ps(planes[4] + i) };
+			__m128 b1{ _mm_loadu_ps(planes[5] + i) };
+			__m128 b2{ _mm_loadu_ps(planes[6] + i) };
+			__m128 b3{ _mm_loadu_ps(planes[7] + i) };
+			_MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+			_MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+
+			float* out{ dst + 8 * i };
+			_mm_storeu_ps(out, a0);
+			_mm_storeu_ps(out + 4, b0);
+			_mm_storeu_ps(out + 8, a1);
+			_mm_storeu_ps(out + 12, b1);
+			_mm_storeu_ps(out + 16, a2);
+			_mm_storeu_ps(out + 20, b2);
+			_mm_storeu_ps(out + 24, a3);
+			_mm_storeu_ps(out + 28, b3);
+		}
+#endif
+
+		InterleaveScalar<float, 8>(dst, planes, i, count);
+	}
+
+	// 32-bit integer samples are moved with the float paths, which don't modify the bits
+
+	void InterleaveStereo(_Out_writes_(2 * count) int32_t* dst, _In_reads_(2) const int32_t* const* planes, _In_ size_t count) noexcept
+	{
+		InterleaveStereo(reinterpret_cast<float*>(dst), reinterpret_cast<const float* const*>(planes), count);
+	}
+
+	void Interleave6(_Out_writes_(6 * count) int32_t* dst, _In_reads_(6) const int32_t* const* planes, _In_ size_t count) noexcept
+	{
+		Interleave6(reinterpret_cast<float*>(dst), reinterpret_cast<const float* const*>(planes), count);
+	}
+
+	void Interleave8(_Out_writes_(8 * count) int32_t* dst, _In_reads_(8) const int32_t* const* planes, _In_ size_t count) noexcept
+	{
+		Interleave8(reinterpret_cast<float*>(dst), reinterpret_cast<const float* const*>(planes), count);
+	}
+
+	template <class T>
+	void Interleave(_Out_writes_(channels * count) T* dst, _In_reads_(channels) const T* const* planes, _In_ int channels, _In_ size_t count) noexcept
+	{
+		switch (channels)
+		{
+		case 1: ConvertRun(dst, planes[0], count); break;
+		case 2: InterleaveStereo(dst, planes, count); break;
+		case 3: InterleaveScalar<T, 3>(dst, planes, 0, count); break;
+		case 4: InterleaveScalar<T, 4>(dst, planes, 0, count); break;
+		case 5: InterleaveScalar<T, 5>(dst, planes, 0, count); break;
+		case 6: Interleave6(dst, planes, count); break;
+		case 7: InterleaveScalar<T, 7>(dst, planes, 0, count); break;
+		case 8: Interleave8(dst, planes, count); break;
+
+		default:
+			for (size_t i{ 0 }; i < count; i++)
+			{
+				for (int c{ 0 }; c < channels; c++)
+				{
+					dst[i * channels + c] = planes[c][i];
+				}
+			}
+			break;
+		}
+	}
+
+	template <class In, class Out>
+	void ConvertToInterleavedImpl(_Out_ Out* dst, _In_ const uint8_t* const* src, _In_ bool isPlanar, _In_ int channels, _In_ int sampleCount)
+	{
+		if (!isPlanar)
+		{
+			ConvertRun(dst, reinterpret_cast<const In*>(src[0]), static_cast<size_t>(channels) * sampleCount);
+			return;
+		}
+
+		WINRT_ASSERT(channels <= MAX_INTERLEAVED_CHANNELS);
+
+		if constexpr (is_same_v<In, Out>)
+		{
+			array<const Out*, MAX_INTERLEAVED_CHANNELS> planes;
+			for (int c{ 0 }; c < channels; c++)
+			{
+				planes[c] = reinterpret_cast<const Out*>(src[c]);
+			}
+
+			Interleave(dst, planes.data(), channels, sampleCount);
+		}
+		else
+		{
+			// Convert a block of each plane into a small buffer that stays in cache, then interleave the block
+			const int blockSize{ BLOCK_SAMPLE_COUNT / channels };
+			array<Out, BLOCK_SAMPLE_COUNT> block;
+			array<const Out*, MAX_INTERLEAVED_CHANNELS> blockPlanes;
+			for (int c{ 0 }; c < channels; c++)
+			{
+				blockPlanes[c] = block.data() + static_cast<size_t>(c) * blockSize;
+			}
+
+			for (int start{ 0 }; start < sampleCount; start += blockSize)
+			{
+				const int count{ min(blockSize, sampleCount - start) };
+				for (int c{ 0 }; c < channels; c++)
+				{
+					ConvertRun(block.data() + static_cast<size_t>(c) * blockSize, reinterpret_cast<const In*>(src[c]) + start, count);
+				}
+
+				Interleave(dst + static_cast<size_t>(start) * channels, blockPlanes.data(), channels, count);
+			}
+		}
+	}
+
+	template <class Out>
+	void ConvertToInterleavedImpl(_Out_ Out* dst, _In_ const uint8_t* const* src, _In_ AVSampleFormat inputFormat, _In_ int channels, _In_ int sampleCount)
+	{
+		const bool isPlanar{ av_sample_fmt_is_planar(inputFormat) != 0 };
+
+		switch (av_get_packed_sample_fmt(inputFormat))
+		{
+		case AV_SAMPLE_FMT_S16:
+			ConvertToInterleavedImpl<int16_t>(dst, src, isPlanar, channels, sampleCount);
+			break;
+
+		case AV_SAMPLE_FMT_S32:
+			ConvertToInterleavedImpl<int32_t>(dst, src, isPlanar, channels, sampleCount);
+			break;
+
+		case AV_SAMPLE_FMT_FLT:
+			ConvertToInterleavedImpl<float>(dst, src, isPlanar, channels, sampleCount);
+			break;
+
+		default:
+			THROW_HR(MF_E_INVALIDMEDIATYPE);
+		}
+	}
+
+	// Level kernel loads: converts 4 samples to float without scaling
+#if defined(FFMPEG_INTEROP_SSE2)
+	inline __m128 LoadLevelSamples(_In_reads_(4) const int16_t* src) noexcept
+	{
+		const __m128i a{ _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)) };
+		return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(a, a), 16));
+	}
+
+	inline __m128 LoadLevelSamples(_In_reads_(4) const int32_t* src) noexcept
+	{
+		return _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+	}
+
+	inline __m128 LoadLevelSamples(_In_reads_(4) const float* src) noexcept
+	{
+		return _mm_loadu_ps(src);
+	}
+#elif defined(FFMPEG_INTEROP_NEON)
+	inline float32x4_t LoadLevelSamples(_In_reads_(4) const int16_t* src) noexcept
+	{
+		return vcvtq_f32_s32(vmovl_s16(vld1_s16(src)));
+	}
+
+	inline float32x4_t LoadLevelSamples(_In_reads_(4) const int32_t* src) noexcept
+	{
+		return vcvtq_f32_s32(vld1q_s32(src));
+	}
+
+	inline float32x4_t LoadLevelSamples(_In_reads_(4) const float* src) noexcept
+	{
+		return vld1q_f32(src);
+	}
+#endif
+
+#if defined(FFMPEG_INTEROP_SSE2) || defined(FFMPEG_INTEROP_NEON)
+	// Accumulates whole groups of vectorCount vectors. A group spans a whole number of frames, so each lane of each vector
+	// always holds the same channel. Returns the number of samples consumed.
+	template <int vectorCount, class T>
+	size_t AccumulateLevelGroups(
+		_Inout_ float* peak,
+		_Inout_ double* sumOfSquares,
+		_In_ const T* src,
+		_In_ int channels,
+		_In_ size_t count,
+		_In_ float scale) noexcept
+	{
+		constexpr size_t groupSize{ 4 * vectorCount };
+		float lanePeak[groupSize];
+		float laneSum[groupSize];
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		const __m128 absMask{ _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)) };
+		__m128 peakValue[vectorCount];
+		__m128 squareSum[vectorCount];
+		for (int v{ 0 }; v < vectorCount; v++)
+		{
+			peakValue[v] = _mm_setzero_ps();
+			squareSum[v] = _mm_setzero_ps();
+		}
+
+		for (; i + groupSize <= count; i += groupSize)
+		{
+			for (int v{ 0 }; v < vectorCount; v++)
+			{
+				const __m128 a{ LoadLevelSamples(src + i + 4 * v) };
+				peakValue[v] = _mm_max_ps(peakValue[v], _mm_and_ps(a, absMask));
+				squareSum[v] = _mm_add_ps(squareSum[v], _mm_mul_ps(a, a));
+			}
+		}
+
+		for (int v{ 0 }; v < vectorCount; v++)
+		{
+			_mm_storeu_ps(lanePeak + 4 * v, peakValue[v]);
+			_mm_storeu_ps(laneSum + 4 * v, squareSum[v]);
+		}
+#else
+		float32x4_t peakValue[vectorCount];
+		float32x4_t squareSum[vectorCount];
+		for (int v{ 0 }; v < vectorCount; v++)
+		{
+			peakValue[v] = vdupq_n_f32(0.0f);
+			squareSum[v] = vdupq_n_f32(0.0f);
+		}
+
+		for (; i + groupSize <= count; i += groupSize)
+		{
+			for (int v{ 0 }; v < vectorCount; v++)
+			{
+				const float32x4_t a{ LoadLevelSamples(src + i + 4 * v) };
+				peakValue[v] = vmaxq_f32(peakValue[v], vabsq_f32(a));
+				squareSum[v] = vmlaq_f32(squareSum[v], a, a);
+			}
+		}
+
+		for (int v{ 0 }; v < vectorCount; v++)
+		{
+			vst1q_f32(lanePeak + 4 * v, peakValue[v]);
+			vst1q_f32(laneSum + 4 * v, squareSum[v]);
+		}
+#endif
+
+		const double squareScale{ static_cast<double>(scale) * scale };
+		for (size_t lane{ 0 }; lane < groupSize; lane++)
+		{
+			const size_t channel{ lane % channels };
+			peak[channel] = max(peak[channel], lanePeak[lane] * scale);
+			sumOfSquares[channel] += laneSum[lane] * squareScale;
+		}
+
+		return i;
+	}
+#endif
+
+	template <class T>
+	void AccumulateLevelsImpl(
+		_Inout_updates_(channels) float* peak,
+		_Inout_updates_(channels) double* sumOfSquares,
+		_In_reads_(channels * sampleCount) const T* src,
+		_In_ int channels,
+		_In_ int sampleCount,
+		_In_ float scale) noexcept
+	{
+		const size_t count{ static_cast<size_t>(channels) * sampleCount };
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2) || defined(FFMPEG_INTEROP_NEON)
+		// Use as many vectors as it takes for a group of them to start and end on a frame boundary, which is channels / gcd(channels, 4)
+		switch (channels / (channels % 4 == 0 ? 4 : (channels % 2 == 0 ? 2 : 1)))
+		{
+		case 1:
+			i = AccumulateLevelGroups<1>(peak, sumOfSquares, src, channels, count, scale);
+			break;
+
+		case 2:
+			i = AccumulateLevelGroups<2>(peak, sumOfSquares, src, channels, count, scale);
+			break;
+
+		case 3:
+			i = AccumulateLevelGroups<3>(peak, sumOfSquares, src, channels, count, scale);
+			break;
+
+		case 4:
+			i = AccumulateLevelGroups<4>(peak, sumOfSquares, src, channels, count, scale);
+			break;
+
+		case 5:
+			i = AccumulateLevelGroups<5>(peak, sumOfSquares, src, channels, count, scale);
+			break;
+
+		case 7:
+			i = AccumulateLevelGroups<7>(peak, sumOfSquares, src, channels, count, scale);
+			break;
+
+		default:
+			// Unusual channel counts fall back to the scalar loop
+			break;
+		}
+#endif
+
+		// The vector loop always stops on a frame boundary, so the channel can be tracked from here
+		const double squareScale{ static_cast<double>(scale) * scale };
+		for (int channel{ 0 }; i < count; i++)
+		{
+			const float value{ static_cast<float>(src[i]) };
+			peak[channel] = max(peak[channel], abs(value) * scale);
+			sumOfSquares[channel] += static_cast<double>(value) * value * squareScale;
+
+			if (++channel == channels)
+			{
+				channel = 0;
+			}
+		}
+	}
+}
+
+namespace winrt::FFmpegInterop::implementation
+{
+	void ByteSwap16(_Out_writes_bytes_(2 * sampleCount) uint8_t* dst, _In_reads_bytes_(2 * sampleCount) const uint8_t* src, _In_ size_t sampleCount) noexcept
+	{
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		for (; i + 8 <= sampleCount; i += 8)
+		{
+			const __m128i v{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i)) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		for (; i + 8 <= sampleCount; i += 8)
+		{
+			vst1q_u8(dst + 2 * i, vrev16q_u8(vld1q_u8(src + 2 * i)));
+		}
+#endif
+
+		for (; i < sampleCount; i++)
+		{
+			const uint8_t lo{ src[2 * i] };
+			dst[2 * i] = src[2 * i + 1];
+			dst[2 * i + 1] = lo;
+		}
+	}
+
+	void ByteSwap24(_Out_writes_bytes_(3 * sampleCount) uint8_t* dst, _In_reads_bytes_(3 * sampleCount) const uint8_t* src, _In_ size_t sampleCount) noexcept
+	{
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		if (IsSsse3Supported())
+		{
+			// Swap 5 samples at a time. The 16th byte belongs to the next sample and is written back unchanged, which keeps
+			// in-place swaps correct. Stop while a whole register still fits.
+			const __m128i shuffle{ _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15) };
+			for (; i + 6 <= sampleCount; i += 5)
+			{
+				const __m128i v{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * i)) };
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 3 * i), _mm_shuffle_epi8(v, shuffle));
+			}
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		// De-interleave 16 samples into their first, middle, and last bytes and swap the first and last
+		for (; i + 16 <= sampleCount; i += 16)
+		{
+			uint8x16x3_t v{ vld3q_u8(src + 3 * i) };
+			swap(v.val[0], v.val[2]);
+			vst3q_u8(dst + 3 * i, v);
+		}
+#endif
+
+		for (; i < sampleCount; i++)
+		{
+			const uint8_t first{ src[3 * i] };
+			dst[3 * i + 1] = src[3 * i + 1];
+			dst[3 * i] = src[3 * i + 2];
+			dst[3 * i + 2] = first;
+		}
+	}
+
+	void ByteSwap32(_Out_writes_bytes_(4 * sampleCount) uint8_t* dst, _In_reads_bytes_(4 * sampleCount) const uint8_t* src, _In_ size_t sampleCount) noexcept
+	{
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		for (; i + 4 <= sampleCount; i += 4)
+		{
+			// Swap the bytes in each 16-bit word, then swap the words in each 32-bit lane
+			__m128i v{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i)) };
+			v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+			v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i), v);
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		for (; i + 4 <= sampleCount; i += 4)
+		{
+			vst1q_u8(dst + 4 * i, vrev32q_u8(vld1q_u8(src + 4 * i)));
+		}
+#endif
+
+		for (; i < sampleCount; i++)
+		{
+			uint32_t sample;
+			memcpy(&sample, src + 4 * i, sizeof(sample));
+			sample = _byteswap_ulong(sample);
+			memcpy(dst + 4 * i, &sample, sizeof(sample));
+		}
+	}
+
+	void ConvertF64ToF32(_Out_writes_(sampleCount) float* dst, _In_reads_bytes_(8 * sampleCount) const uint8_t* src, _In_ size_t sampleCount) noexcept
+	{
+		ConvertF64ToF32Impl<false>(dst, src, sampleCount);
+	}
+
+	void ConvertF64BEToF32(_Out_writes_(sampleCount) float* dst, _In_reads_bytes_(8 * sampleCount) const uint8_t* src, _In_ size_t sampleCount) noexcept
+	{
+		ConvertF64ToF32Impl<true>(dst, src, sampleCount);
+	}
+
+	bool IsInterleavedConversionSupported(_In_ AVSampleFormat inputFormat, _In_ AVSampleFormat outputFormat, _In_ int channels) noexcept
+	{
+		if (channels <= 0 || channels > MAX_INTERLEAVED_CHANNELS)
+		{
+			return false;
+		}
+
+		if (outputFormat != AV_SAMPLE_FMT_S16 && outputFormat != AV_SAMPLE_FMT_S32 && outputFormat != AV_SAMPLE_FMT_FLT)
+		{
+			return false;
+		}
+
+		switch (av_get_packed_sample_fmt(inputFormat))
+		{
+		case AV_SAMPLE_FMT_S16:
+		case AV_SAMPLE_FMT_S32:
+		case AV_SAMPLE_FMT_FLT:
+			return true;
+
+		default:
+			return false;
+		}
+	}
+
+	void ConvertToInterleaved(
+		_Out_ uint8_t* dst,
+		_In_ AVSampleFormat outputFormat,
+		_In_ const uint8_t* const* src,
+		_In_ AVSampleFormat inputFormat,
+		_In_ int channels,
+		_In_ int sampleCount)
+	{
+		WINRT_ASSERT(IsInterleavedConversionSupported(inputFormat, outputFormat, channels));
+
+		switch (outputFormat)
+		{
+		case AV_SAMPLE_FMT_S16:
+			ConvertToInterleavedImpl(reinterpret_cast<int16_t*>(dst), src, inputFormat, channels, sampleCount);
+			break;
+
+		case AV_SAMPLE_FMT_S32:
+			ConvertToInterleavedImpl(reinterpret_cast<int32_t*>(dst), src, inputFormat, channels, sampleCount);
+			break;
+
+		default:
+			ConvertToInterleavedImpl(reinterpret_cast<float*>(dst), src, inputFormat, channels, sampleCount);
+			break;
+		}
+	}
+
+	void UpdateMinMax(
+		_Inout_updates_(2 * channels) float* minMax,
+		_In_reads_(channels * sampleCount) const float* src,
+		_In_ int channels,
+		_In_ int sampleCount) noexcept
+	{
+		const size_t count{ static_cast<size_t>(channels) * sampleCount };
+		size_t i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2) || defined(FFMPEG_INTEROP_NEON)
+		// With 1, 2, or 4 channels, each vector lane always holds the same channel
+		if (4 % channels == 0 && count >= 4)
+		{
+			float laneMin[4];
+			float laneMax[4];
+
+#if defined(FFMPEG_INTEROP_SSE2)
+			__m128 minValue{ _mm_loadu_ps(src) };
+			__m128 maxValue{ minValue };
+			for (i = 4; i + 8 <= count; i += 8)
+			{
+				const __m128 a{ _mm_loadu_ps(src + i) };
+				const __m128 b{ _mm_loadu_ps(src + i + 4) };
+				minValue = _mm_min_ps(minValue, _mm_min_ps(a, b));
+				maxValue = _mm_max_ps(maxValue, _mm_max_ps(a, b));
+			}
+			for (; i + 4 <= count; i += 4)
+			{
+				const __m128 a{ _mm_loadu_ps(src + i) };
+				minValue = _mm_min_ps(minValue, a);
+				maxValue = _mm_max_ps(maxValue, a);
+			}
+
+			_mm_storeu_ps(laneMin, minValue);
+			_mm_storeu_ps(laneMax, maxValue);
+#else
+			float32x4_t minValue{ vld1q_f32(src) };
+			float32x4_t maxValue{ minValue };
+			for (i = 4; i + 8 <= count; i += 8)
+			{
+				const float32x4_t a{ vld1q_f32(src + i) };
+				const float32x4_t b{ vld1q_f32(src + i + 4) };
+				minValue = vminq_f32(minValue, vminq_f32(a, b));
+				maxValue = vmaxq_f32(maxValue, vmaxq_f32(a, b));
+			}
+			for (; i + 4 <= count; i += 4)
+			{
+				const float32x4_t a{ vld1q_f32(src + i) };
+				minValue = vminq_f32(minValue, a);
+				maxValue = vmaxq_f32(maxValue, a);
+			}
+
+			vst1q_f32(laneMin, minValue);
+			vst1q_f32(laneMax, maxValue);
+#endif
+
+			for (int lane{ 0 }; lane < 4; lane++)
+			{
+				const int channel{ lane % channels };
+				minMax[2 * channel] = min(minMax[2 * channel], laneMin[lane]);
+				minMax[2 * channel + 1] = max(minMax[2 * channel + 1], laneMax[lane]);
+			}
+		}
+#endif
+
+		// The vector loop always stops on a frame boundary, so the channel can be tracked from here
+		for (int channel{ 0 }; i < count; i++)
+		{
+			minMax[2 * channel] = min(minMax[2 * channel], src[i]);
+			minMax[2 * channel + 1] = max(minMax[2 * channel + 1], src[i]);
+
+			if (++channel == channels)
+			{
+				channel = 0;
+			}
+		}
+	}
+
+	void AccumulateLevels(
+		_Inout_updates_(channels) float* peak,
+		_Inout_updates_(channels) double* sumOfSquares,
+		_In_ const uint8_t* src,
+		_In_ AVSampleFormat format,
+		_In_ int channels,
+		_In_ int sampleCount) noexcept
+	{
+		switch (format)
+		{
+		case AV_SAMPLE_FMT_S16:
+			AccumulateLevelsImpl(peak, sumOfSquares, reinterpret_cast<const int16_t*>(src), channels, sampleCount, 1.0f / 32768.0f);
+			break;
+
+		case AV_SAMPLE_FMT_S32:
+			AccumulateLevelsImpl(peak, sumOfSquares, reinterpret_cast<const int32_t*>(src), channels, sampleCount, 1.0f / 2147483648.0f);
+			break;
+
+		case AV_SAMPLE_FMT_FLT:
+			AccumulateLevelsImpl(peak, sumOfSquares, reinterpret_cast<const float*>(src), channels, sampleCount, 1.0f);
+			break;
+
+		default:
+			WINRT_ASSERT(false);
+			break;
+		}
+	}
+}
@@ -0,0 +1,61 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+namespace winrt::FFmpegInterop::implementation
+{
+	// Sample conversion kernels. Counts are the total number of samples across all channels.
+	// The source doesn't need to be aligned, and the destination may be the same as the source when the sample size doesn't change.
+	void ByteSwap16(_Out_writes_bytes_(2 * sampleCount) uint8_t* dst, _In_reads_bytes_(2 * sampleCount) const uint8_t* src, _In_ size_t sampleCount) noexcept;
+	void ByteSwap24(_Out_writes_bytes_(3 * sampleCount) uint8_t* dst, _In_reads_bytes_(3 * sampleCount) const uint8_t* src, _In_ size_t sampleCount) noexcept;
+	void ByteSwap32(_Out_writes_bytes_(4 * sampleCount) uint8_t* dst, _In_reads_bytes_(4 * sampleCount) const uint8_t* src, _In_ size_t sampleCount) noexcept;
+	void ConvertF64ToF32(_Out_writes_(sampleCount) float* dst, _In_reads_bytes_(8 * sampleCount) const uint8_t* src, _In_ size_t sampleCount) noexcept;
+	void ConvertF64BEToF32(_Out_writes_(sampleCount) float* dst, _In_reads_bytes_(8 * sampleCount) const uint8_t* src, _In_ size_t sampleCount) noexcept;
+
+	// Returns true if ConvertToInterleaved() can convert between these sample formats. Up to 64 channels are supported.
+	bool IsInterleavedConversionSupported(_In_ AVSampleFormat inputFormat, _In_ AVSampleFormat outputFormat, _In_ int channels) noexcept;
+
+	// Converts planar or interleaved S16, S32, or FLT samples to interleaved S16, S32, or FLT samples. Conversions to
+	// S16 and FLT match swresample's rounding and clipping. Conversions to S32 produce 24-bit samples in the high bits,
+	// except that S32 input is passed through as is. Counts are per channel. Nothing is allocated.
+	void ConvertToInterleaved(
+		_Out_ uint8_t* dst,
+		_In_ AVSampleFormat outputFormat,
+		_In_ const uint8_t* const* src,
+		_In_ AVSampleFormat inputFormat,
+		_In_ int channels,
+		_In_ int sampleCount);
+
+	// Widens each channel's (min, max) pair in minMax to cover the interleaved float samples in src. Counts are per channel.
+	void UpdateMinMax(
+		_Inout_updates_(2 * channels) float* minMax,
+		_In_reads_(channels * sampleCount) const float* src,
+		_In_ int channels,
+		_In_ int sampleCount) noexcept;
+
+	// Raises each channel's peak to the largest absolute sample value and adds each sample's square to the channel's sum of
+	// squares. Takes interleaved S16, S32, or FLT samples and measures them relative to full scale. Counts are per channel.
+	void AccumulateLevels(
+		_Inout_updates_(channels) float* peak,
+		_Inout_updates_(channels) double* sumOfSquares,
+		_In_ const uint8_t* src,
+		_In_ AVSampleFormat format,
+		_In_ int channels,
+		_In_ int sampleCount) noexcept;
+}
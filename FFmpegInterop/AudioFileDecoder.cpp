@@ -0,0 +1,163 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "AudioFileDecoder.h"
+#include "StreamFactory.h"
+#include "SampleProvider.h"
+
+using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Media::Core;
+using namespace winrt::Windows::Media::MediaProperties;
+using namespace winrt::Windows::Storage::Streams;
+using namespace std;
+
+namespace winrt::FFmpegInterop::implementation
+{
+	AudioFileDecoder::AudioFileDecoder(
+		_In_ const IRandomAccessStream& fileStream,
+		_In_ uint32_t channels,
+		_In_ uint32_t sampleRate,
+		_In_ const TimeSpan& batchDuration,
+		_In_ uint32_t decodeAheadDepth) :
+		m_formatContext(avformat_alloc_context()),
+		m_reader(m_formatContext.get(), m_streamIdMap)
+	{
+		THROW_HR_IF_NULL(E_INVALIDARG, fileStream);
+		THROW_IF_NULL_ALLOC(m_formatContext);
+
+		// Convert async IRandomAccessStream to sync IStream
+		THROW_IF_FAILED(CreateStreamOverRandomAccessStream(winrt::get_unknown(fileStream), __uuidof(m_fileStream), m_fileStream.put_void()));
+
+		// Use a larger IO buffer than playback does since the whole file is read as fast as possible
+		AVBlob_ptr ioBuffer{ av_malloc(IO_BUFFER_SIZE) };
+		THROW_IF_NULL_ALLOC(ioBuffer);
+
+		m_ioContext.reset(avio_alloc_context(reinterpret_cast<unsigned char*>(ioBuffer.get()), IO_BUFFER_SIZE, 0, m_fileStream.get(), FileStreamRead, nullptr, FileStreamSeek));
+		THROW_IF_NULL_ALLOC(m_ioContext);
+		ioBuffer.release(); // The IO context has taken ownership of the buffer
+
+		m_formatContext->pb = m_ioContext.get();
+
+		AVFormatContext* formatContextRaw{ m_formatContext.release() };
+		int result{ avformat_open_input(&formatContextRaw, "", nullptr, nullptr) }; // The format context is freed on failure
+		THROW_HR_IF_FFMPEG_FAILED(result);
+		m_formatContext.reset(exchange(formatContextRaw, nullptr));
+
+		THROW_HR_IF_FFMPEG_FAILED(avformat_find_stream_info(m_formatContext.get(), nullptr));
+
+		const int streamIndex{ av_find_best_stream(m_formatContext.get(), AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0) };
+		THROW_HR_IF_FFMPEG_FAILED(streamIndex);
+
+		for (unsigned int i{ 0 }; i < m_formatContext->nb_streams; i++)
+		{
+			m_formatContext->streams[i]->discard = AVDISCARD_ALL;
+		}
+
+		// Always decode to float. The output rate is pinned so mid-stream rate changes are resampled.
+		AVStream* stream{ m_formatContext->streams[streamIndex] };
+
+		FFmpegInterop::FFmpegInteropMSSConfig config;
+		config.ForceAudioDecode(true);
+		config.AudioOutputFormat(FFmpegInterop::AudioOutputFormat::Float32);
+		config.AudioOutputChannels(channels);
+		config.AudioOutputSampleRate(sampleRate > 0 ? sampleRate : static_cast<uint32_t>(stream->codecpar->sample_rate));
+		config.AudioBatchPolicy(FFmpegInterop::AudioBatchPolicy::Custom);
+		config.MinAudioSampleDuration(batchDuration);
+		config.MaxAudioSampleDuration(batchDuration);
+		config.DecodeAheadDepth(decodeAheadDepth);
+
+		auto [sampleProvider, streamDescriptor] = StreamFactory::CreateAudioStream(m_formatContext.get(), stream, m_reader, config);
+		m_sampleProvider = move(sampleProvider);
+		m_streamIdMap[streamIndex] = m_sampleProvider.get();
+		m_sampleProvider->Select();
+
+		const AudioEncodingProperties encProp{ streamDescriptor.EncodingProperties() };
+		m_sampleRate = static_cast<int>(encProp.SampleRate());
+
+		const int outputChannels{ static_cast<int>(encProp.ChannelCount()) };
+		if (outputChannels == stream->codecpar->ch_layout.nb_channels)
+		{
+			m_channelLayout = stream->codecpar->ch_layout;
+		}
+		else
+		{
+			m_channelLayout = AVChannelLayoutWrapper{ outputChannels };
+		}
+	}
+
+	AudioFileDecoder::~AudioFileDecoder() = default;
+
+	int64_t AudioFileDecoder::GetDuration() const noexcept
+	{
+		if (m_formatContext->duration == AV_NOPTS_VALUE)
+		{
+			return 0;
+		}
+
+		return ConvertFromAVTime(m_formatContext->duration, av_get_time_base_q(), HNS_PER_SEC);
+	}
+
+	void AudioFileDecoder::Seek(_In_ int64_t hnsTime)
+	{
+		// Convert the seek time from HNS to AV_TIME_BASE
+		int64_t avSeekTime{ ConvertToAVTime(hnsTime, HNS_PER_SEC, av_get_time_base_q()) };
+
+		if (m_formatContext->start_time != AV_NOPTS_VALUE)
+		{
+			// Adjust the seek time by the start time offset
+			avSeekTime += m_formatContext->start_time;
+		}
+
+		// Stop decoding ahead before the demuxer is repositioned
+		m_sampleProvider->Pause();
+
+		THROW_HR_IF_FFMPEG_FAILED(avformat_seek_file(m_formatContext.get(), -1, numeric_limits<int64_t>::min(), avSeekTime, avSeekTime, 0));
+
+		m_sampleProvider->OnSeek(hnsTime);
+		m_isEOS = false;
+	}
+
+	tuple<IBuffer, int64_t, int64_t> AudioFileDecoder::ReadSamples()
+	{
+		if (!m_isEOS)
+		{
+			try
+			{
+				auto [buf, pts, dur, properties, formatChanges] = m_sampleProvider->ReadSample();
+
+				// The output rate is pinned, so only the channel count can change. Consumers expect a fixed layout.
+				THROW_HR_IF(MF_E_INVALIDMEDIATYPE, any_of(formatChanges.begin(), formatChanges.end(),
+					[](const auto& formatChange) { return formatChange.first == MF_MT_AUDIO_NUM_CHANNELS; }));
+
+				return { move(buf), pts, dur };
+			}
+			catch (...)
+			{
+				if (to_hresult() != MF_E_END_OF_STREAM)
+				{
+					throw;
+				}
+			}
+
+			m_isEOS = true;
+		}
+
+		return { nullptr, 0, 0 };
+	}
+}
@@ -0,0 +1,67 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+#include "Reader.h"
+
+namespace winrt::FFmpegInterop::implementation
+{
+	class SampleProvider;
+
+	// Decodes the best audio stream in a file to interleaved float samples without a MSS, for consumers that process
+	// audio faster than realtime. Decoding goes through the same sample providers as playback.
+	class AudioFileDecoder
+	{
+	public:
+		// A channel count or sample rate of 0 keeps the source's. Sources are never upmixed. A decode-ahead depth above 0
+		// decodes that many batches ahead on a worker thread while the caller processes earlier ones.
+		AudioFileDecoder(
+			_In_ const Windows::Storage::Streams::IRandomAccessStream& fileStream,
+			_In_ uint32_t channels,
+			_In_ uint32_t sampleRate,
+			_In_ const Windows::Foundation::TimeSpan& batchDuration = DEFAULT_BATCH_DURATION,
+			_In_ uint32_t decodeAheadDepth = 0);
+		~AudioFileDecoder();
+
+		const AVChannelLayout& GetChannelLayout() const noexcept { return m_channelLayout; }
+		int GetChannelCount() const noexcept { return m_channelLayout.nb_channels; }
+		int GetSampleRate() const noexcept { return m_sampleRate; }
+		int64_t GetDuration() const noexcept; // hns, or 0 if unknown
+
+		void Seek(_In_ int64_t hnsTime);
+
+		// Decodes the next batch of samples and returns them with their timestamp and duration (hns).
+		// Returns a null buffer at the end of the stream.
+		std::tuple<Windows::Storage::Streams::IBuffer, int64_t, int64_t> ReadSamples();
+
+	private:
+		static constexpr int IO_BUFFER_SIZE{ 64 * 1024 };
+		static constexpr std::chrono::milliseconds DEFAULT_BATCH_DURATION{ 500 };
+
+		com_ptr<IStream> m_fileStream;
+		AVIOContext_ptr m_ioContext;
+		AVFormatContext_ptr m_formatContext;
+		std::map<int, SampleProvider*> m_streamIdMap;
+		Reader m_reader;
+		std::unique_ptr<SampleProvider> m_sampleProvider;
+		AVChannelLayoutWrapper m_channelLayout;
+		int m_sampleRate{ 0 };
+		bool m_isEOS{ false };
+	};
+}
@@ -0,0 +1,144 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "AudioLevelMeter.h"
+#include "AudioLevelMeter.g.cpp"
+#include "AudioLevels.h"
+
+using namespace winrt::Windows::Foundation;
+using namespace std;
+
+namespace winrt::FFmpegInterop::implementation
+{
+	FFmpegInterop::AudioLevels AudioLevelMeter::GetLatestLevels()
+	{
+		Levels levels;
+		while (true)
+		{
+			const uint64_t publishCount{ m_publishCount.load(memory_order_acquire) };
+			if (publishCount <= GetFirstReadableIndex(publishCount))
+			{
+				return nullptr;
+			}
+
+			if (TryRead(publishCount - 1, levels))
+			{
+				return MakeLevels(levels);
+			}
+
+			// The slot was reused while we read it. Try again with the newer levels.
+		}
+	}
+
+	FFmpegInterop::AudioLevels AudioLevelMeter::GetLevels(_In_ const TimeSpan& position)
+	{
+		// Search from the newest levels back, since apps usually ask about the recent past
+		const uint64_t publishCount{ m_publishCount.load(memory_order_acquire) };
+		const uint64_t firstIndex{ GetFirstReadableIndex(publishCount) };
+		Levels levels;
+		for (uint64_t index{ publishCount }; index > firstIndex; index--)
+		{
+			if (TryRead(index - 1, levels) && levels.pts <= position.count() && position.count() < levels.pts + levels.dur)
+			{
+				return MakeLevels(levels);
+			}
+		}
+
+		return nullptr;
+	}
+
+	void AudioLevelMeter::Publish(
+		_In_ int64_t pts,
+		_In_ int64_t dur,
+		_In_ int channels,
+		_In_reads_(channels) const float* peak,
+		_In_reads_(channels) const float* rms) noexcept
+	{
+		lock_guard<mutex> lock{ m_publishLock };
+
+		const uint64_t index{ m_publishCount.load(memory_order_relaxed) };
+		Slot& slot{ m_slots[index % SLOT_COUNT] };
+		const int reportedChannels{ min(channels, MAX_CHANNELS) };
+
+		// Mark the slot as being written before touching its contents
+		const uint32_t sequence{ slot.sequence.load(memory_order_relaxed) };
+		slot.sequence.store(sequence + 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+
+		slot.index.store(index, memory_order_relaxed);
+		slot.pts.store(pts, memory_order_relaxed);
+		slot.dur.store(dur, memory_order_relaxed);
+		slot.channels.store(reportedChannels, memory_order_relaxed);
+		for (int channel{ 0 }; channel < reportedChannels; channel++)
+		{
+			slot.peak[channel].store(peak[channel], memory_order_relaxed);
+			slot.rms[channel].store(rms[channel], memory_order_relaxed);
+		}
+
+		slot.sequence.store(sequence + 2, memory_order_release);
+		m_publishCount.store(index + 1, memory_order_release);
+	}
+
+	void AudioLevelMeter::Reset() noexcept
+	{
+		lock_guard<mutex> lock{ m_publishLock };
+		m_firstValidIndex.store(m_publishCount.load(memory_order_relaxed), memory_order_release);
+	}
+
+	uint64_t AudioLevelMeter::GetFirstReadableIndex(_In_ uint64_t publishCount) const noexcept
+	{
+		// Older slots have been reused, and slots from before the last reset are stale
+		const uint64_t firstRetainedIndex{ publishCount > SLOT_COUNT ? publishCount - SLOT_COUNT : 0 };
+		return max(firstRetainedIndex, m_firstValidIndex.load(memory_order_acquire));
+	}
+
+	bool AudioLevelMeter::TryRead(_In_ uint64_t index, _Out_ Levels& levels) const noexcept
+	{
+		const Slot& slot{ m_slots[index % SLOT_COUNT] };
+
+		const uint32_t sequence{ slot.sequence.load(memory_order_acquire) };
+		if ((sequence & 1) != 0 || slot.index.load(memory_order_relaxed) != index)
+		{
+			// The slot is being written or has been reused
+			return false;
+		}
+
+		levels.pts = slot.pts.load(memory_order_relaxed);
+		levels.dur = slot.dur.load(memory_order_relaxed);
+		levels.channels = slot.channels.load(memory_order_relaxed);
+		for (int channel{ 0 }; channel < levels.channels; channel++)
+		{
+			levels.peak[channel] = slot.peak[channel].load(memory_order_relaxed);
+			levels.rms[channel] = slot.rms[channel].load(memory_order_relaxed);
+		}
+
+		// Make sure the slot wasn't rewritten while we read it
+		atomic_thread_fence(memory_order_acquire);
+		return slot.sequence.load(memory_order_relaxed) == sequence;
+	}
+
+	FFmpegInterop::AudioLevels AudioLevelMeter::MakeLevels(_In_ const Levels& levels)
+	{
+		return make<AudioLevels>(
+			levels.pts,
+			levels.dur,
+			vector<float>{ levels.peak.begin(), levels.peak.begin() + levels.channels },
+			vector<float>{ levels.rms.begin(), levels.rms.begin() + levels.channels });
+	}
+}
@@ -0,0 +1,92 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+#include "AudioLevelMeter.g.h"
+
+namespace winrt::FFmpegInterop::implementation
+{
+	// Keeps the levels of recently decoded samples in a ring of seqlocked slots, so the decoder can publish levels
+	// while the app reads them without either side waiting on the other. Readers skip a slot that's overwritten
+	// while they're reading it.
+	class AudioLevelMeter :
+		public AudioLevelMeterT<AudioLevelMeter>
+	{
+	public:
+		AudioLevelMeter() = default;
+
+		FFmpegInterop::AudioLevels GetLatestLevels();
+		FFmpegInterop::AudioLevels GetLevels(_In_ const Windows::Foundation::TimeSpan& position);
+
+		// Publishes the levels of a decoded sample. Times are in hns, and levels are linear relative to full scale.
+		// Channels past MAX_CHANNELS aren't reported.
+		void Publish(
+			_In_ int64_t pts,
+			_In_ int64_t dur,
+			_In_ int channels,
+			_In_reads_(channels) const float* peak,
+			_In_reads_(channels) const float* rms) noexcept;
+
+		// Drops the published levels, e.g. after a seek
+		void Reset() noexcept;
+
+		static constexpr int MAX_CHANNELS{ 16 };
+
+	private:
+		static constexpr uint64_t SLOT_COUNT{ 256 };
+
+		struct Slot
+		{
+			std::atomic<uint32_t> sequence{ 0 }; // Odd while the slot is being written
+			std::atomic<uint64_t> index{ 0 };
+			std::atomic<int64_t> pts{ 0 };
+			std::atomic<int64_t> dur{ 0 };
+			std::atomic<int> channels{ 0 };
+			std::array<std::atomic<float>, MAX_CHANNELS> peak{ };
+			std::array<std::atomic<float>, MAX_CHANNELS> rms{ };
+		};
+
+		struct Levels
+		{
+			int64_t pts{ 0 };
+			int64_t dur{ 0 };
+			int channels{ 0 };
+			std::array<float, MAX_CHANNELS> peak{ };
+			std::array<float, MAX_CHANNELS> rms{ };
+		};
+
+		uint64_t GetFirstReadableIndex(_In_ uint64_t publishCount) const noexcept;
+		bool TryRead(_In_ uint64_t index, _Out_ Levels& levels) const noexcept;
+		static FFmpegInterop::AudioLevels MakeLevels(_In_ const Levels& levels);
+
+		std::mutex m_publishLock; // Serializes publishers. Readers never take it.
+		std::array<Slot, SLOT_COUNT> m_slots;
+		std::atomic<uint64_t> m_publishCount{ 0 };
+		std::atomic<uint64_t> m_firstValidIndex{ 0 };
+	};
+}
+
+namespace winrt::FFmpegInterop::factory_implementation
+{
+	struct AudioLevelMeter :
+		public AudioLevelMeterT<AudioLevelMeter, implementation::AudioLevelMeter>
+	{
+
+	};
+}
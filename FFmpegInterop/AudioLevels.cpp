@@ -0,0 +1,57 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "AudioLevels.h"
+#include "AudioLevels.g.cpp"
+
+using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Foundation::Collections;
+using namespace std;
+
+namespace winrt::FFmpegInterop::implementation
+{
+	AudioLevels::AudioLevels(_In_ int64_t timestamp, _In_ int64_t duration, _In_ vector<float> peak, _In_ vector<float> rms) :
+		m_timestamp(timestamp),
+		m_duration(duration),
+		m_peak(single_threaded_vector<float>(move(peak)).GetView()),
+		m_rms(single_threaded_vector<float>(move(rms)).GetView())
+	{
+
+	}
+
+	TimeSpan AudioLevels::Timestamp()
+	{
+		return TimeSpan{ m_timestamp };
+	}
+
+	TimeSpan AudioLevels::Duration()
+	{
+		return TimeSpan{ m_duration };
+	}
+
+	IVectorView<float> AudioLevels::Peak()
+	{
+		return m_peak;
+	}
+
+	IVectorView<float> AudioLevels::Rms()
+	{
+		return m_rms;
+	}
+}
@@ -0,0 +1,42 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+#include "AudioLevels.g.h"
+
+namespace winrt::FFmpegInterop::implementation
+{
+	class AudioLevels :
+		public AudioLevelsT<AudioLevels>
+	{
+	public:
+		AudioLevels(_In_ int64_t timestamp, _In_ int64_t duration, _In_ std::vector<float> peak, _In_ std::vector<float> rms);
+
+		Windows::Foundation::TimeSpan Timestamp();
+		Windows::Foundation::TimeSpan Duration();
+		Windows::Foundation::Collections::IVectorView<float> Peak();
+		Windows::Foundation::Collections::IVectorView<float> Rms();
+
+	private:
+		int64_t m_timestamp{ 0 }; // hns
+		int64_t m_duration{ 0 }; // hns
+		Windows::Foundation::Collections::IVectorView<float> m_peak{ nullptr };
+		Windows::Foundation::Collections::IVectorView<float> m_rms{ nullptr };
+	};
+}
@@ -0,0 +1,82 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "AudioOutputBufferPool.h"
+
+using namespace std;
+
+namespace winrt::FFmpegInterop::implementation
+{
+	AudioOutputBufferPool::AudioOutputBufferPool(_In_ int streamIndex) noexcept :
+		m_streamIndex(streamIndex)
+	{
+
+	}
+
+	void AudioOutputBufferPool::Init(_In_ size_t bufferSize)
+	{
+		// Buffers still held by earlier samples stay valid after the old pool is released
+		m_pool.reset(av_buffer_pool_init2(bufferSize, this, AllocateBuffer, nullptr));
+		THROW_IF_NULL_ALLOC(m_pool);
+
+		m_bufferSize = bufferSize;
+	}
+
+	void AudioOutputBufferPool::Reserve(_Inout_ AVBufferRef_ptr& outputBuf, _In_ size_t outputSize, _In_ size_t frameSize)
+	{
+		const size_t requiredSize{ outputSize + frameSize };
+		if (outputBuf != nullptr && requiredSize <= outputBuf->size)
+		{
+			// The current output buffer has room for the frame
+			return;
+		}
+
+		if (requiredSize > m_bufferSize)
+		{
+			// The decoder output a larger frame than expected. Grow the pool so this doesn't happen again.
+			FFMPEG_INTEROP_TRACE("Stream %d: Growing audio output buffers. Old size = %zu, Required size = %zu",
+				m_streamIndex, m_bufferSize, requiredSize);
+
+			Init(max(requiredSize, 2 * m_bufferSize));
+		}
+
+		AVBufferRef_ptr newOutputBuf{ av_buffer_pool_get(m_pool.get()) };
+		THROW_IF_NULL_ALLOC(newOutputBuf);
+
+		if (outputBuf != nullptr)
+		{
+			// Carry over the samples we've already compacted
+			memcpy(newOutputBuf->data, outputBuf->data, outputSize);
+		}
+
+		outputBuf = move(newOutputBuf);
+	}
+
+	AVBufferRef* AudioOutputBufferPool::AllocateBuffer(_In_opt_ void* opaque, _In_ size_t size) noexcept
+	{
+		// Only the current pool hands out buffers, and it's always released before this object is
+		AudioOutputBufferPool* pool{ static_cast<AudioOutputBufferPool*>(opaque) };
+		pool->m_allocationCount++;
+
+		FFMPEG_INTEROP_TRACE("Stream %d: Allocating audio output buffer. Size = %zu, Total allocations = %I64u",
+			pool->m_streamIndex, size, pool->m_allocationCount);
+
+		return av_buffer_alloc(size);
+	}
+}
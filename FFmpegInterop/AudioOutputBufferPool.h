@@ -0,0 +1,54 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+namespace winrt::FFmpegInterop::implementation
+{
+	// Hands out the buffers decoded audio is converted into. A buffer goes back to the pool once the sample built on it
+	// is released, so steady state decoding reuses the same few buffers instead of allocating one per frame.
+	class AudioOutputBufferPool
+	{
+	public:
+		explicit AudioOutputBufferPool(_In_ int streamIndex) noexcept;
+
+		// The pool's allocator refers back to this object
+		AudioOutputBufferPool(_In_ const AudioOutputBufferPool& other) = delete;
+		AudioOutputBufferPool& operator=(_In_ const AudioOutputBufferPool& other) = delete;
+
+		// Sizes the buffers handed out from now on. Buffers still held by earlier samples stay valid.
+		void Init(_In_ size_t bufferSize);
+
+		// Makes sure outputBuf has room for frameSize more bytes after the first outputSize bytes, which are carried
+		// over if a new buffer is needed. The pool grows if the frame doesn't fit in a buffer of the current size.
+		void Reserve(_Inout_ AVBufferRef_ptr& outputBuf, _In_ size_t outputSize, _In_ size_t frameSize);
+
+		size_t GetBufferSize() const noexcept { return m_bufferSize; }
+
+		// Number of buffers that had to be allocated rather than reused
+		uint64_t GetAllocationCount() const noexcept { return m_allocationCount; }
+
+	private:
+		static AVBufferRef* AllocateBuffer(_In_opt_ void* opaque, _In_ size_t size) noexcept;
+
+		int m_streamIndex{ -1 };
+		AVBufferPool_ptr m_pool;
+		size_t m_bufferSize{ 0 };
+		uint64_t m_allocationCount{ 0 };
+	};
+}
@@ -0,0 +1,78 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "AudioSampleBatcher.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace winrt::FFmpegInterop::implementation
+{
+	AudioSampleBatcher::AudioSampleBatcher(_In_ int streamIndex, _In_ pair<int64_t, int64_t> durationRange) noexcept :
+		m_streamIndex(streamIndex),
+		m_minDuration(durationRange.first),
+		m_maxDuration(durationRange.second),
+		m_targetDuration(durationRange.first)
+	{
+
+	}
+
+	void AudioSampleBatcher::OnSampleRequested() noexcept
+	{
+		OnSampleRequested(steady_clock::now());
+	}
+
+	void AudioSampleBatcher::OnSampleRequested(_In_ steady_clock::time_point now) noexcept
+	{
+		const steady_clock::time_point lastRequestTime{ exchange(m_lastRequestTime, now) };
+		if (lastRequestTime == steady_clock::time_point{ })
+		{
+			return;
+		}
+
+		// A consumer that only asks for the next sample once it has played most of the last one is buffered ahead
+		// and waiting on the clock, not on us, so larger samples won't add latency. Requests in quick succession
+		// mean it's still filling its buffer (e.g. after a seek), where smaller samples get it playing sooner.
+		const int64_t requestInterval{ duration_cast<nanoseconds>(now - lastRequestTime).count() / 100 }; // hns
+		const int64_t targetDuration{ m_targetDuration.load(memory_order_relaxed) };
+		if (targetDuration < m_maxDuration && requestInterval >= targetDuration * 3 / 4)
+		{
+			const int64_t newTargetDuration{ min(2 * targetDuration, m_maxDuration) };
+			m_targetDuration.store(newTargetDuration, memory_order_relaxed);
+
+			FFmpegInteropProvider::AudioBatchDurationChanged(m_streamIndex, newTargetDuration, requestInterval);
+		}
+		else if (targetDuration > m_minDuration && requestInterval < targetDuration / 4)
+		{
+			// Once samples have grown, a request right after the last one means a whole sample wasn't enough to keep
+			// the consumer going (e.g. the renderer glitched and raised its buffering). It's waiting on us again, so
+			// shrink the samples until it has caught up, the same as after a seek.
+			const int64_t newTargetDuration{ max(targetDuration / 2, m_minDuration) };
+			m_targetDuration.store(newTargetDuration, memory_order_relaxed);
+
+			FFmpegInteropProvider::AudioBatchDurationChanged(m_streamIndex, newTargetDuration, requestInterval);
+		}
+	}
+
+	void AudioSampleBatcher::Reset() noexcept
+	{
+		m_targetDuration.store(m_minDuration, memory_order_relaxed);
+		m_lastRequestTime = { };
+	}
+}
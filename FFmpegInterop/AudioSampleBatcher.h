@@ -0,0 +1,50 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+namespace winrt::FFmpegInterop::implementation
+{
+	// Decides how much audio to batch into each sample. Every sample costs the pipeline a request, a buffer, and a wakeup,
+	// but a larger sample delays playback after a seek by its duration. Samples start at the policy's minimum duration
+	// after each discontinuity, grow toward the maximum while the consumer is pulling at a steady real-time pace, and
+	// shrink back toward the minimum when the consumer runs short and has to catch up.
+	class AudioSampleBatcher
+	{
+	public:
+		// Takes the (minimum, maximum) sample duration in hns, e.g. from FFmpegInteropMSSConfig::GetAudioSampleDurationRange()
+		AudioSampleBatcher(_In_ int streamIndex, _In_ std::pair<int64_t, int64_t> durationRange) noexcept;
+
+		// Called for each sample request, on the thread the request arrives on
+		void OnSampleRequested() noexcept;
+		void OnSampleRequested(_In_ std::chrono::steady_clock::time_point now) noexcept;
+
+		// Called when the stream is flushed, e.g. for a seek
+		void Reset() noexcept;
+
+		int64_t GetTargetDuration() const noexcept { return m_targetDuration.load(std::memory_order_relaxed); } // hns
+		int64_t GetMaxDuration() const noexcept { return m_maxDuration; } // hns
+
+	private:
+		int m_streamIndex{ -1 };
+		int64_t m_minDuration{ 0 }; // hns
+		int64_t m_maxDuration{ 0 }; // hns
+		std::atomic<int64_t> m_targetDuration{ 0 }; // hns
+		std::chrono::steady_clock::time_point m_lastRequestTime;
+	};
+}
@@ -0,0 +1,330 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "AudioScanAnalyzer.h"
+#include "AudioConversion.h"
+
+using namespace std;
+
+namespace winrt::FFmpegInterop::implementation
+{
+	AudioScanAnalyzer::AudioScanAnalyzer(_In_ int sampleRate, _In_ vector<double> channelWeights, _In_ uint32_t samplesPerPeak, _In_ int64_t startSample, _In_ int64_t endSample) :
+		m_channels(static_cast<int>(channelWeights.size())),
+		m_channelWeights(move(channelWeights)),
+		m_samplesPerPeak(samplesPerPeak),
+		m_samplesPerSubblock(max<int64_t>(llround(sampleRate / 10.0), 1)),
+		m_startSample(startSample),
+		m_endSample(endSample),
+		m_filterState(m_channels),
+		m_firstBin(startSample / samplesPerPeak),
+		m_firstSubblock(startSample / m_samplesPerSubblock)
+	{
+		THROW_HR_IF(E_INVALIDARG, sampleRate <= 0 || m_channels == 0 || samplesPerPeak == 0 || startSample < 0 || endSample <= startSample);
+
+		// K-weighting filter coefficients for the sample rate, as derived from the 48 kHz coefficients in ITU-R BS.1770
+		constexpr double pi{ 3.14159265358979323846 };
+		{
+			// Stage 1: High shelf that models the acoustic effect of the head
+			constexpr double f0{ 1681.974450955533 };
+			constexpr double gain{ 3.999843853973347 }; // dB
+			constexpr double q{ 0.7071752369554196 };
+
+			const double k{ tan(pi * f0 / sampleRate) };
+			const double vh{ pow(10.0, gain / 20.0) };
+			const double vb{ pow(vh, 0.4996667741545416) };
+			const double a0{ 1.0 + k / q + k * k };
+
+			m_shelfFilter.b0 = (vh + vb * k / q + k * k) / a0;
+			m_shelfFilter.b1 = 2.0 * (k * k - vh) / a0;
+			m_shelfFilter.b2 = (vh - vb * k / q + k * k) / a0;
+			m_shelfFilter.a1 = 2.0 * (k * k - 1.0) / a0;
+			m_shelfFilter.a2 = (1.0 - k / q + k * k) / a0;
+		}
+		{
+			// Stage 2: RLB high-pass filter
+			constexpr double f0{ 38.13547087602444 };
+			constexpr double q{ 0.5003270373238773 };
+
+			const double k{ tan(pi * f0 / sampleRate) };
+			const double a0{ 1.0 + k / q + k * k };
+
+			m_highPassFilter.b0 = 1.0;
+			m_highPassFilter.b1 = -2.0;
+			m_highPassFilter.b2 = 1.0;
+			m_highPassFilter.a1 = 2.0 * (k * k - 1.0) / a0;
+			m_highPassFilter.a2 = (1.0 - k / q + k * k) / a0;
+		}
+	}
+
+	void AudioScanAnalyzer::AddSamples(_In_reads_(sampleCount * m_channels) const float* samples, _In_ int64_t sampleIndex, _In_ int sampleCount)
+	{
+		// Skip samples that overlap with what's already been analyzed
+		if (sampleIndex < m_position)
+		{
+			const int64_t overlap{ min<int64_t>(m_position - sampleIndex, sampleCount) };
+			samples += overlap * m_channels;
+			sampleIndex += overlap;
+			sampleCount -= static_cast<int>(overlap);
+		}
+
+		// Ignore samples past the end of the range
+		sampleCount = static_cast<int>(clamp<int64_t>(m_endSample - sampleIndex, 0, sampleCount));
+		if (sampleCount == 0)
+		{
+			return;
+		}
+
+		// Samples before the start of the range prime the loudness filter
+		const int primingCount{ static_cast<int>(clamp<int64_t>(m_startSample - sampleIndex, 0, sampleCount)) };
+		if (primingCount > 0)
+		{
+			FilterSamples(samples, sampleIndex, primingCount, false);
+			samples += static_cast<size_t>(primingCount) * m_channels;
+			sampleIndex += primingCount;
+			sampleCount -= primingCount;
+		}
+
+		if (sampleCount > 0)
+		{
+			FilterSamples(samples, sampleIndex, sampleCount, true);
+			UpdatePeaks(samples, sampleIndex, sampleCount);
+		}
+
+		m_position = sampleIndex + sampleCount;
+	}
+
+	void AudioScanAnalyzer::FilterSamples(_In_reads_(sampleCount * m_channels) const float* samples, _In_ int64_t sampleIndex, _In_ int sampleCount, _In_ bool isMeasured)
+	{
+		// The filters are recursive, so they run sample by sample. Each channel's state is kept in registers across a run.
+		const Biquad s{ m_shelfFilter };
+		const Biquad h{ m_highPassFilter };
+
+		for (int64_t offset{ 0 }; offset < sampleCount; )
+		{
+			// Process up to the end of the current sub-block
+			const int64_t subblock{ (sampleIndex + offset) / m_samplesPerSubblock };
+			const int64_t runCount{ min<int64_t>((subblock + 1) * m_samplesPerSubblock - (sampleIndex + offset), sampleCount - offset) };
+
+			double runEnergy{ 0.0 };
+			for (int channel{ 0 }; channel < m_channels; channel++)
+			{
+				auto [s1, s2, h1, h2] = m_filterState[channel];
+				const float* src{ samples + offset * m_channels + channel };
+				double sumOfSquares{ 0.0 };
+
+				for (int64_t i{ 0 }; i < runCount; i++, src += m_channels)
+				{
+					const double x{ *src };
+					const double y{ s.b0 * x + s1 };
+					s1 = s.b1 * x - s.a1 * y + s2;
+					s2 = s.b2 * x - s.a2 * y;
+
+					const double z{ h.b0 * y + h1 };
+					h1 = h.b1 * y - h.a1 * z + h2;
+					h2 = h.b2 * y - h.a2 * z;
+
+					sumOfSquares += z * z;
+				}
+
+				m_filterState[channel] = { s1, s2, h1, h2 };
+				runEnergy += m_channelWeights[channel] * sumOfSquares;
+			}
+
+			if (isMeasured)
+			{
+				const size_t i{ static_cast<size_t>(subblock - m_firstSubblock) };
+				if (i >= m_subblockEnergy.size())
+				{
+					m_subblockEnergy.resize(i + 1);
+					m_subblockSamples.resize(i + 1);
+				}
+
+				m_subblockEnergy[i] += runEnergy;
+				m_subblockSamples[i] += runCount;
+			}
+
+			offset += runCount;
+		}
+	}
+
+	void AudioScanAnalyzer::UpdatePeaks(_In_reads_(sampleCount * m_channels) const float* samples, _In_ int64_t sampleIndex, _In_ int sampleCount)
+	{
+		const size_t binSize{ 2 * static_cast<size_t>(m_channels) };
+
+		for (int64_t offset{ 0 }; offset < sampleCount; )
+		{
+			const int64_t bin{ (sampleIndex + offset) / m_samplesPerPeak };
+			const int64_t runCount{ min<int64_t>((bin + 1) * m_samplesPerPeak - (sampleIndex + offset), sampleCount - offset) };
+
+			const size_t i{ static_cast<size_t>(bin - m_firstBin) * binSize };
+			if (i >= m_peaks.size())
+			{
+				// Start new bins empty
+				const size_t oldSize{ m_peaks.size() };
+				m_peaks.resize(i + binSize);
+				for (size_t j{ oldSize }; j < m_peaks.size(); j += 2)
+				{
+					m_peaks[j] = numeric_limits<float>::max();
+					m_peaks[j + 1] = numeric_limits<float>::lowest();
+				}
+			}
+
+			UpdateMinMax(m_peaks.data() + i, samples + offset * m_channels, m_channels, static_cast<int>(runCount));
+			offset += runCount;
+		}
+	}
+
+	vector<vector<float>> AudioScanAnalyzer::MergePeaks(_In_ const vector<AudioScanAnalyzer>& segments)
+	{
+		THROW_HR_IF(E_INVALIDARG, segments.empty());
+
+		const size_t binSize{ 2 * static_cast<size_t>(segments.front().m_channels) };
+
+		// Combine the segments' bins. A bin may span two segments.
+		vector<float> peaks;
+		for (const AudioScanAnalyzer& segment : segments)
+		{
+			const size_t offset{ static_cast<size_t>(segment.m_firstBin) * binSize };
+			if (offset + segment.m_peaks.size() > peaks.size())
+			{
+				const size_t oldSize{ peaks.size() };
+				peaks.resize(offset + segment.m_peaks.size());
+				for (size_t j{ oldSize }; j < peaks.size(); j += 2)
+				{
+					peaks[j] = numeric_limits<float>::max();
+					peaks[j + 1] = numeric_limits<float>::lowest();
+				}
+			}
+
+			for (size_t j{ 0 }; j < segment.m_peaks.size(); j += 2)
+			{
+				peaks[offset + j] = min(peaks[offset + j], segment.m_peaks[j]);
+				peaks[offset + j + 1] = max(peaks[offset + j + 1], segment.m_peaks[j + 1]);
+			}
+		}
+
+		// Bins that didn't get any samples (e.g. a gap in the timestamps) are silent
+		for (size_t j{ 0 }; j < peaks.size(); j += 2)
+		{
+			if (peaks[j] > peaks[j + 1])
+			{
+				peaks[j] = 0.0f;
+				peaks[j + 1] = 0.0f;
+			}
+		}
+
+		vector<vector<float>> levels;
+		levels.push_back(move(peaks));
+
+		// Build each coarser level by combining pairs of bins from the one before
+		while (levels.back().size() > binSize)
+		{
+			const vector<float>& fine{ levels.back() };
+			const size_t binCount{ (fine.size() / binSize + 1) / 2 };
+			vector<float> coarse(binCount * binSize);
+
+			for (size_t bin{ 0 }; bin < binCount; bin++)
+			{
+				const float* first{ fine.data() + 2 * bin * binSize };
+				const float* second{ 2 * bin + 1 < fine.size() / binSize ? first + binSize : first };
+				float* dst{ coarse.data() + bin * binSize };
+
+				for (size_t j{ 0 }; j < binSize; j += 2)
+				{
+					dst[j] = min(first[j], second[j]);
+					dst[j + 1] = max(first[j + 1], second[j + 1]);
+				}
+			}
+
+			levels.push_back(move(coarse));
+		}
+
+		return levels;
+	}
+
+	double AudioScanAnalyzer::MergeLoudness(_In_ const vector<AudioScanAnalyzer>& segments)
+	{
+		THROW_HR_IF(E_INVALIDARG, segments.empty());
+
+		const int64_t samplesPerSubblock{ segments.front().m_samplesPerSubblock };
+
+		// Combine the segments' sub-blocks. A sub-block may span two segments.
+		vector<double> energy;
+		vector<int64_t> sampleCounts;
+		for (const AudioScanAnalyzer& segment : segments)
+		{
+			const size_t offset{ static_cast<size_t>(segment.m_firstSubblock) };
+			if (offset + segment.m_subblockEnergy.size() > energy.size())
+			{
+				energy.resize(offset + segment.m_subblockEnergy.size());
+				sampleCounts.resize(offset + segment.m_subblockEnergy.size());
+			}
+
+			for (size_t i{ 0 }; i < segment.m_subblockEnergy.size(); i++)
+			{
+				energy[offset + i] += segment.m_subblockEnergy[i];
+				sampleCounts[offset + i] += segment.m_subblockSamples[i];
+			}
+		}
+
+		// Mean square of each complete 400 ms gating block
+		vector<double> blocks;
+		for (size_t i{ 0 }; i + SUBBLOCKS_PER_BLOCK <= energy.size(); i++)
+		{
+			double blockEnergy{ 0.0 };
+			bool isComplete{ true };
+			for (size_t j{ i }; j < i + SUBBLOCKS_PER_BLOCK; j++)
+			{
+				blockEnergy += energy[j];
+				isComplete = isComplete && sampleCounts[j] == samplesPerSubblock;
+			}
+
+			if (isComplete)
+			{
+				blocks.push_back(blockEnergy / (SUBBLOCKS_PER_BLOCK * samplesPerSubblock));
+			}
+		}
+
+		const auto toLoudness{ [](_In_ double meanSquare) { return -0.691 + 10.0 * log10(meanSquare); } };
+		const auto gatedMean{ [&](_In_ double threshold)
+			{
+				double sum{ 0.0 };
+				size_t count{ 0 };
+				for (double block : blocks)
+				{
+					if (block > 0.0 && toLoudness(block) > threshold)
+					{
+						sum += block;
+						count++;
+					}
+				}
+
+				return count > 0 ? sum / count : 0.0;
+			} };
+
+		const double absoluteGatedMean{ gatedMean(ABSOLUTE_GATE_LUFS) };
+		if (absoluteGatedMean == 0.0)
+		{
+			return -numeric_limits<double>::infinity();
+		}
+
+		const double relativeGatedMean{ gatedMean(max(ABSOLUTE_GATE_LUFS, toLoudness(absoluteGatedMean) + RELATIVE_GATE_LU)) };
+		return toLoudness(relativeGatedMean);
+	}
+}
@@ -0,0 +1,86 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+namespace winrt::FFmpegInterop::implementation
+{
+	// Measures waveform peaks and loudness over a range of an audio file. Long files are split into segments that are
+	// analyzed in parallel, and the segments' results are merged once they're all done.
+	class AudioScanAnalyzer
+	{
+	public:
+		// Loudness weights are per channel, as defined by ITU-R BS.1770. The range is in samples per channel.
+		AudioScanAnalyzer(_In_ int sampleRate, _In_ std::vector<double> channelWeights, _In_ uint32_t samplesPerPeak, _In_ int64_t startSample, _In_ int64_t endSample);
+
+		// Adds interleaved float samples, starting at the given sample in the file. Samples before the start of the range
+		// only prime the loudness filter, and samples the analyzer has already seen are skipped.
+		void AddSamples(_In_reads_(sampleCount * m_channels) const float* samples, _In_ int64_t sampleIndex, _In_ int sampleCount);
+
+		bool IsComplete() const noexcept { return m_position >= m_endSample; }
+		int64_t GetStartSample() const noexcept { return m_startSample; }
+		int64_t GetPosition() const noexcept { return m_position; }
+
+		// Returns the peak levels. Level 0 has a bin for every samplesPerPeak samples, and each following level halves
+		// the number of bins until there's one left. Each bin holds a (min, max) pair per channel.
+		static std::vector<std::vector<float>> MergePeaks(_In_ const std::vector<AudioScanAnalyzer>& segments);
+
+		// Returns the integrated loudness in LUFS, as defined by EBU R128, or -infinity if no block passes the gates.
+		static double MergeLoudness(_In_ const std::vector<AudioScanAnalyzer>& segments);
+
+	private:
+		// Transposed direct form II biquad
+		struct Biquad
+		{
+			double b0{ 0.0 };
+			double b1{ 0.0 };
+			double b2{ 0.0 };
+			double a1{ 0.0 };
+			double a2{ 0.0 };
+		};
+
+		static constexpr double ABSOLUTE_GATE_LUFS{ -70.0 };
+		static constexpr double RELATIVE_GATE_LU{ -10.0 };
+		static constexpr int SUBBLOCKS_PER_BLOCK{ 4 }; // 400 ms gating blocks with 75% overlap
+
+		void FilterSamples(_In_reads_(sampleCount * m_channels) const float* samples, _In_ int64_t sampleIndex, _In_ int sampleCount, _In_ bool isMeasured);
+		void UpdatePeaks(_In_reads_(sampleCount * m_channels) const float* samples, _In_ int64_t sampleIndex, _In_ int sampleCount);
+
+		int m_channels{ 0 };
+		std::vector<double> m_channelWeights;
+		uint32_t m_samplesPerPeak{ 0 };
+		int64_t m_samplesPerSubblock{ 0 }; // 100 ms
+		int64_t m_startSample{ 0 };
+		int64_t m_endSample{ 0 };
+		int64_t m_position{ std::numeric_limits<int64_t>::min() };
+
+		// K-weighting filter
+		Biquad m_shelfFilter;
+		Biquad m_highPassFilter;
+		std::vector<std::array<double, 4>> m_filterState; // Per channel
+
+		// Peaks from m_firstBin on. Bins that haven't seen any samples have min > max.
+		int64_t m_firstBin{ 0 };
+		std::vector<float> m_peaks;
+
+		// Sum of the weighted mean squares, and the number of samples, for each 100 ms sub-block from m_firstSubblock on
+		int64_t m_firstSubblock{ 0 };
+		std::vector<double> m_subblockEnergy;
+		std::vector<int64_t> m_subblockSamples;
+	};
+}
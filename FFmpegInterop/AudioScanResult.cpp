@@ -0,0 +1,82 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "AudioScanResult.h"
+#include "AudioScanResult.g.cpp"
+
+using namespace winrt::Windows::Foundation;
+using namespace std;
+
+namespace winrt::FFmpegInterop::implementation
+{
+	AudioScanResult::AudioScanResult(
+		_In_ int64_t duration,
+		_In_ uint32_t sampleRate,
+		_In_ uint32_t channelCount,
+		_In_ double integratedLoudness,
+		_In_ uint32_t samplesPerPeak,
+		_In_ vector<vector<float>> peaks) :
+		m_duration(duration),
+		m_sampleRate(sampleRate),
+		m_channelCount(channelCount),
+		m_integratedLoudness(integratedLoudness),
+		m_samplesPerPeak(samplesPerPeak),
+		m_peaks(move(peaks))
+	{
+
+	}
+
+	TimeSpan AudioScanResult::Duration()
+	{
+		return TimeSpan{ m_duration };
+	}
+
+	uint32_t AudioScanResult::SampleRate()
+	{
+		return m_sampleRate;
+	}
+
+	uint32_t AudioScanResult::ChannelCount()
+	{
+		return m_channelCount;
+	}
+
+	double AudioScanResult::IntegratedLoudness()
+	{
+		return m_integratedLoudness;
+	}
+
+	uint32_t AudioScanResult::SamplesPerPeak()
+	{
+		return m_samplesPerPeak;
+	}
+
+	uint32_t AudioScanResult::PeakLevelCount()
+	{
+		return static_cast<uint32_t>(m_peaks.size());
+	}
+
+	com_array<float> AudioScanResult::GetPeaks(_In_ uint32_t level)
+	{
+		THROW_HR_IF(E_BOUNDS, level >= m_peaks.size());
+
+		const vector<float>& peaks{ m_peaks[level] };
+		return com_array<float>{ peaks.begin(), peaks.end() };
+	}
+}
@@ -0,0 +1,53 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+#include "AudioScanResult.g.h"
+
+namespace winrt::FFmpegInterop::implementation
+{
+	class AudioScanResult :
+		public AudioScanResultT<AudioScanResult>
+	{
+	public:
+		AudioScanResult(
+			_In_ int64_t duration,
+			_In_ uint32_t sampleRate,
+			_In_ uint32_t channelCount,
+			_In_ double integratedLoudness,
+			_In_ uint32_t samplesPerPeak,
+			_In_ std::vector<std::vector<float>> peaks);
+
+		Windows::Foundation::TimeSpan Duration();
+		uint32_t SampleRate();
+		uint32_t ChannelCount();
+		double IntegratedLoudness();
+		uint32_t SamplesPerPeak();
+		uint32_t PeakLevelCount();
+		com_array<float> GetPeaks(_In_ uint32_t level);
+
+	private:
+		int64_t m_duration{ 0 }; // hns
+		uint32_t m_sampleRate{ 0 };
+		uint32_t m_channelCount{ 0 };
+		double m_integratedLoudness{ 0.0 };
+		uint32_t m_samplesPerPeak{ 0 };
+		std::vector<std::vector<float>> m_peaks;
+	};
+}
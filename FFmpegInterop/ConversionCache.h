@@ -0,0 +1,65 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+namespace winrt::FFmpegInterop::implementation
+{
+	// Small LRU cache of conversion contexts (e.g. scalers, resamplers, and their buffer pools), so that streams which
+	// switch back and forth between formats can reuse contexts instead of rebuilding them. Contexts are moved out of the
+	// cache while they're in use.
+	template<class Key, class Value, size_t Capacity = 4>
+	class ConversionCache
+	{
+	public:
+		// Removes and returns the contexts cached for the key, if any
+		std::optional<Value> Take(_In_ const Key& key)
+		{
+			const auto iter{ std::find_if(m_entries.begin(), m_entries.end(), [&key](const auto& entry) { return entry.first == key; }) };
+			if (iter == m_entries.end())
+			{
+				m_missCount++;
+				return std::nullopt;
+			}
+
+			m_hitCount++;
+			std::optional<Value> value{ std::move(iter->second) };
+			m_entries.erase(iter);
+			return value;
+		}
+
+		// Caches contexts for the key, evicting the least recently used contexts if the cache is full
+		void Put(_In_ Key key, _In_ Value value)
+		{
+			if (m_entries.size() == Capacity)
+			{
+				m_entries.pop_back();
+			}
+
+			m_entries.emplace_front(std::move(key), std::move(value));
+		}
+
+		uint32_t GetHitCount() const noexcept { return m_hitCount; }
+		uint32_t GetMissCount() const noexcept { return m_missCount; }
+
+	private:
+		std::deque<std::pair<Key, Value>> m_entries; // Most recently used first
+		uint32_t m_hitCount{ 0 };
+		uint32_t m_missCount{ 0 };
+	};
+}
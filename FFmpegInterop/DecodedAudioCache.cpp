@@ -0,0 +1,93 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "DecodedAudioCache.h"
+
+using namespace std;
+
+namespace winrt::FFmpegInterop::implementation
+{
+	void DecodedAudioCache::SetCapacity(_In_ size_t capacity) noexcept
+	{
+		lock_guard<mutex> lock{ s_lock };
+
+		s_capacity = capacity;
+		Trim();
+	}
+
+	size_t DecodedAudioCache::GetCapacity() noexcept
+	{
+		lock_guard<mutex> lock{ s_lock };
+		return s_capacity;
+	}
+
+	size_t DecodedAudioCache::Hash(_In_ const vector<uint8_t>& content) noexcept
+	{
+		return hash<string_view>{ }(string_view{ reinterpret_cast<const char*>(content.data()), content.size() });
+	}
+
+	shared_ptr<const DecodedAudioClip> DecodedAudioCache::Find(_In_ size_t contentHash, _In_ const vector<uint8_t>& content) noexcept
+	{
+		lock_guard<mutex> lock{ s_lock };
+
+		const auto iter{ find_if(s_clips.begin(), s_clips.end(),
+			[&](const auto& clip) { return clip->contentHash == contentHash && clip->content == content; }) };
+		if (iter == s_clips.end())
+		{
+			return nullptr;
+		}
+
+		// Mark the clip as most recently used
+		s_clips.splice(s_clips.begin(), s_clips, iter);
+		return s_clips.front();
+	}
+
+	void DecodedAudioCache::Add(_In_ shared_ptr<const DecodedAudioClip> clip) noexcept
+	{
+		lock_guard<mutex> lock{ s_lock };
+
+		if (clip->size > s_capacity)
+		{
+			return;
+		}
+
+		// Another session may have cached the same clip while this one was recording it
+		if (any_of(s_clips.begin(), s_clips.end(),
+			[&](const auto& cachedClip) { return cachedClip->contentHash == clip->contentHash && cachedClip->content == clip->content; }))
+		{
+			return;
+		}
+
+		FFMPEG_INTEROP_TRACE("Caching decoded audio clip. Size = %zu, Cache Size = %zu, Capacity = %zu", clip->size, s_size, s_capacity);
+
+		s_size += clip->size;
+		s_clips.push_front(move(clip));
+		Trim();
+	}
+
+	void DecodedAudioCache::Trim() noexcept
+	{
+		// Evict the least recently used clips. Sessions still playing an evicted clip keep it alive until they're done.
+		while (s_size > s_capacity)
+		{
+			s_size -= s_clips.back()->size;
+			s_clips.pop_back();
+		}
+	}
+}
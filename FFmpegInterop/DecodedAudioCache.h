@@ -0,0 +1,72 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+namespace winrt::FFmpegInterop::implementation
+{
+	// A fully decoded audio clip. Clips are immutable once they're in the cache, so any number of sessions can play
+	// them at once from the same buffers.
+	struct DecodedAudioClip
+	{
+		struct Sample
+		{
+			Windows::Storage::Streams::IBuffer buffer{ nullptr };
+			int64_t pts{ 0 }; // hns
+			int64_t dur{ 0 }; // hns
+		};
+
+		size_t contentHash{ 0 };
+		std::vector<uint8_t> content; // The compressed file, to tell clips with the same hash apart
+
+		hstring subtype;
+		uint32_t sampleRate{ 0 };
+		uint32_t channelCount{ 0 };
+		uint32_t bitsPerSample{ 0 };
+		std::vector<std::pair<GUID, Windows::Foundation::IInspectable>> properties;
+
+		std::vector<Sample> samples;
+		int64_t duration{ 0 }; // hns
+		size_t size{ 0 }; // Total bytes of compressed and decoded data
+	};
+
+	// Process-wide LRU cache of fully decoded short clips (e.g. UI sounds), keyed by the content of the compressed file.
+	// Sessions that play a cached clip don't open a demuxer or decoder at all.
+	class DecodedAudioCache
+	{
+	public:
+		// Files larger than this aren't cached
+		static constexpr uint64_t MAX_FILE_SIZE{ 1024 * 1024 };
+
+		// The capacity is process-wide. The last session to set it wins, and lowering it evicts clips right away.
+		static void SetCapacity(_In_ size_t capacity) noexcept;
+		static size_t GetCapacity() noexcept;
+
+		static size_t Hash(_In_ const std::vector<uint8_t>& content) noexcept;
+		static std::shared_ptr<const DecodedAudioClip> Find(_In_ size_t contentHash, _In_ const std::vector<uint8_t>& content) noexcept;
+		static void Add(_In_ std::shared_ptr<const DecodedAudioClip> clip) noexcept;
+
+	private:
+		static void Trim() noexcept;
+
+		static inline std::mutex s_lock;
+		static inline std::list<std::shared_ptr<const DecodedAudioClip>> s_clips; // Most recently used first
+		static inline size_t s_size{ 0 };
+		static inline size_t s_capacity{ 0 };
+	};
+}
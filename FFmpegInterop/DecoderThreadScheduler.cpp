@@ -0,0 +1,189 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "DecoderThreadScheduler.h"
+#include <winrt/FFmpegInterop.h>
+
+using namespace std;
+
+namespace winrt::FFmpegInterop::implementation
+{
+	DecoderThreadScheduler::Allocation::Allocation(_In_ shared_ptr<Share> share) noexcept :
+		m_share(move(share))
+	{
+
+	}
+
+	DecoderThreadScheduler::Allocation::Allocation(Allocation&& other) noexcept :
+		m_share(move(other.m_share))
+	{
+
+	}
+
+	DecoderThreadScheduler::Allocation& DecoderThreadScheduler::Allocation::operator=(Allocation&& other) noexcept
+	{
+		if (this != &other)
+		{
+			DecoderThreadScheduler::Release(m_share);
+			m_share = move(other.m_share);
+		}
+
+		return *this;
+	}
+
+	DecoderThreadScheduler::Allocation::~Allocation()
+	{
+		DecoderThreadScheduler::Release(m_share);
+	}
+
+	int DecoderThreadScheduler::Allocation::GetThreadCount() const noexcept
+	{
+		return m_share != nullptr ? m_share->threadCount.load(memory_order_relaxed) : 1;
+	}
+
+	void DecoderThreadScheduler::Allocation::SetPriority(_In_ FFmpegInterop::DecoderThreadPriority priority)
+	{
+		if (m_share == nullptr)
+		{
+			return;
+		}
+
+		lock_guard<mutex> lock{ s_lock };
+
+		if (m_share->priority != priority)
+		{
+			m_share->priority = priority;
+			DecoderThreadScheduler::Rebalance();
+		}
+	}
+
+	DecoderThreadScheduler::Allocation DecoderThreadScheduler::Allocate(_In_ const AVCodecContext* codecContext, _In_ FFmpegInterop::DecoderThreadPriority priority)
+	{
+		const uint64_t workloadWeight{ GetWorkloadWeight(codecContext) };
+		if (workloadWeight == 0)
+		{
+			// The decoder doesn't benefit from threading
+			return { };
+		}
+
+		auto share{ make_shared<Share>() };
+		share->codecId = codecContext->codec_id;
+		share->workloadWeight = workloadWeight;
+		share->priority = priority;
+
+		lock_guard<mutex> lock{ s_lock };
+
+		s_shares.push_back(share);
+		Rebalance();
+
+		return Allocation{ move(share) };
+	}
+
+	uint64_t DecoderThreadScheduler::GetWorkloadWeight(_In_ const AVCodecContext* codecContext) noexcept
+	{
+		if (codecContext->codec_type != AVMEDIA_TYPE_VIDEO)
+		{
+			// FFmpeg's audio decoders are single threaded
+			return 0;
+		}
+
+		// Newer codecs cost roughly twice as much to decode per pixel
+		uint64_t codecWeight{ 1 };
+		switch (codecContext->codec_id)
+		{
+		case AV_CODEC_ID_AV1:
+		case AV_CODEC_ID_HEVC:
+		case AV_CODEC_ID_VP9:
+			codecWeight = 2;
+			break;
+
+		default:
+			break;
+		}
+
+		const uint64_t pixelCount{ (static_cast<uint64_t>(max(codecContext->width, 0)) * static_cast<uint64_t>(max(codecContext->height, 0))) >> (2 * codecContext->lowres) };
+		const uint64_t resolutionWeight{ max<uint64_t>(pixelCount / REFERENCE_PIXEL_COUNT, 1) };
+
+		return codecWeight * resolutionWeight;
+	}
+
+	uint64_t DecoderThreadScheduler::GetPriorityWeight(_In_ FFmpegInterop::DecoderThreadPriority priority) noexcept
+	{
+		switch (priority)
+		{
+		case FFmpegInterop::DecoderThreadPriority::Low:
+			return 1;
+
+		case FFmpegInterop::DecoderThreadPriority::High:
+			return 16;
+
+		case FFmpegInterop::DecoderThreadPriority::Normal:
+		default:
+			return 4;
+		}
+	}
+
+	void DecoderThreadScheduler::Release(_In_ const shared_ptr<Share>& share) noexcept
+	{
+		if (share == nullptr)
+		{
+			return;
+		}
+
+		lock_guard<mutex> lock{ s_lock };
+
+		const auto iter{ find(s_shares.begin(), s_shares.end(), share) };
+		WINRT_ASSERT(iter != s_shares.end());
+		if (iter != s_shares.end())
+		{
+			s_shares.erase(iter);
+			Rebalance();
+		}
+	}
+
+	void DecoderThreadScheduler::Rebalance() noexcept
+	{
+		// Must be called with s_lock held
+		const unsigned int hardwareThreadCount{ thread::hardware_concurrency() };
+
+		uint64_t totalWeight{ 0 };
+		for (const auto& share : s_shares)
+		{
+			totalWeight += share->workloadWeight * GetPriorityWeight(share->priority);
+		}
+
+		// Give each decoder its weighted share of the hardware threads, counting every decoder that's currently open
+		for (const auto& share : s_shares)
+		{
+			const uint64_t weight{ share->workloadWeight * GetPriorityWeight(share->priority) };
+
+			int threadCount{ 1 };
+			if (hardwareThreadCount > 0)
+			{
+				threadCount = static_cast<int>(clamp<uint64_t>((hardwareThreadCount * weight + totalWeight / 2) / totalWeight, 1, MAX_THREAD_COUNT));
+			}
+
+			if (share->threadCount.exchange(threadCount, memory_order_relaxed) != threadCount)
+			{
+				FFMPEG_INTEROP_TRACE("Codec %hs: Allocated %d decoder threads. Weight = %I64u, Total Weight = %I64u",
+					avcodec_get_name(share->codecId), threadCount, weight, totalWeight);
+			}
+		}
+	}
+}
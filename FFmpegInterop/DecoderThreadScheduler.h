@@ -0,0 +1,82 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+namespace winrt::FFmpegInterop
+{
+	enum class DecoderThreadPriority : int32_t;
+}
+
+namespace winrt::FFmpegInterop::implementation
+{
+	// Splits the CPU's threads between all of the software decoders in the process so concurrent
+	// sessions (e.g. a grid of previews) don't each create a thread per core.
+	class DecoderThreadScheduler
+	{
+		struct Share;
+
+	public:
+		// A decoder's share of the thread budget. Shares are recomputed whenever a decoder is opened or closed or
+		// changes priority. The share is returned to the scheduler when this is destroyed.
+		class Allocation
+		{
+		public:
+			Allocation() = default;
+			Allocation(Allocation&& other) noexcept;
+			Allocation& operator=(Allocation&& other) noexcept;
+			~Allocation();
+
+			// The decoder's current share, which can change at any time
+			int GetThreadCount() const noexcept;
+
+			void SetPriority(_In_ FFmpegInterop::DecoderThreadPriority priority);
+
+		private:
+			friend class DecoderThreadScheduler;
+
+			explicit Allocation(_In_ std::shared_ptr<Share> share) noexcept;
+
+			std::shared_ptr<Share> m_share;
+		};
+
+		// FFmpeg can't change a decoder's thread count once it's open, so decoders should poll their allocation and
+		// reopen at a convenient point (e.g. a key frame) when their share changes.
+		static Allocation Allocate(_In_ const AVCodecContext* codecContext, _In_ FFmpegInterop::DecoderThreadPriority priority);
+
+	private:
+		struct Share
+		{
+			AVCodecID codecId{ AV_CODEC_ID_NONE };
+			uint64_t workloadWeight{ 0 };
+			FFmpegInterop::DecoderThreadPriority priority{ };
+			std::atomic<int> threadCount{ 0 }; // Set by Rebalance()
+		};
+
+		static uint64_t GetWorkloadWeight(_In_ const AVCodecContext* codecContext) noexcept;
+		static uint64_t GetPriorityWeight(_In_ FFmpegInterop::DecoderThreadPriority priority) noexcept;
+		static void Release(_In_ const std::shared_ptr<Share>& share) noexcept;
+		static void Rebalance() noexcept;
+
+		static constexpr int MAX_THREAD_COUNT{ 16 }; // FFmpeg warns that more threads than this aren't useful
+		static constexpr int REFERENCE_PIXEL_COUNT{ 640 * 360 };
+
+		static inline std::mutex s_lock;
+		static inline std::vector<std::shared_ptr<Share>> s_shares; // Guarded by s_lock
+	};
+}
@@ -0,0 +1,105 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "FFmpegInteropAudioExtractor.h"
+#include "FFmpegInteropAudioExtractor.g.cpp"
+#include "AudioFileDecoder.h"
+
+using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Storage::Streams;
+using namespace std;
+
+namespace winrt::FFmpegInterop::implementation
+{
+	FFmpegInteropAudioExtractor::FFmpegInteropAudioExtractor(
+		_In_ const IRandomAccessStream& fileStream,
+		_In_ uint32_t channelCount,
+		_In_ uint32_t sampleRate,
+		_In_ const TimeSpan& chunkDuration)
+	{
+		THROW_HR_IF(E_INVALIDARG, chunkDuration < TimeSpan::zero());
+
+		// The sample provider converts each frame straight to the target format in a single resampler pass, and
+		// compacts frames into pooled buffers of a whole chunk
+		m_decoder = make_unique<AudioFileDecoder>(
+			fileStream,
+			channelCount,
+			sampleRate,
+			chunkDuration > TimeSpan::zero() ? chunkDuration : DEFAULT_CHUNK_DURATION,
+			DECODE_AHEAD_DEPTH);
+
+		m_channelCount = static_cast<uint32_t>(m_decoder->GetChannelCount());
+		m_sampleRate = static_cast<uint32_t>(m_decoder->GetSampleRate());
+		m_duration = m_decoder->GetDuration();
+	}
+
+	FFmpegInteropAudioExtractor::~FFmpegInteropAudioExtractor() = default;
+
+	uint32_t FFmpegInteropAudioExtractor::ChannelCount()
+	{
+		return m_channelCount;
+	}
+
+	uint32_t FFmpegInteropAudioExtractor::SampleRate()
+	{
+		return m_sampleRate;
+	}
+
+	TimeSpan FFmpegInteropAudioExtractor::Duration()
+	{
+		return TimeSpan{ m_duration };
+	}
+
+	TimeSpan FFmpegInteropAudioExtractor::Position()
+	{
+		lock_guard<mutex> lock{ m_lock };
+		return TimeSpan{ m_position };
+	}
+
+	IBuffer FFmpegInteropAudioExtractor::ReadChunk()
+	{
+		lock_guard<mutex> lock{ m_lock };
+		THROW_HR_IF(RO_E_CLOSED, m_decoder == nullptr);
+
+		auto [buf, pts, dur] = m_decoder->ReadSamples();
+		if (buf != nullptr)
+		{
+			m_position = pts + dur;
+		}
+
+		return buf;
+	}
+
+	void FFmpegInteropAudioExtractor::Seek(_In_ const TimeSpan& position)
+	{
+		lock_guard<mutex> lock{ m_lock };
+		THROW_HR_IF(RO_E_CLOSED, m_decoder == nullptr);
+		THROW_HR_IF(E_INVALIDARG, position < TimeSpan::zero());
+
+		m_decoder->Seek(position.count());
+		m_position = position.count();
+	}
+
+	void FFmpegInteropAudioExtractor::Close()
+	{
+		// Stops the decode-ahead thread and releases the file. Chunks the caller still holds stay valid.
+		lock_guard<mutex> lock{ m_lock };
+		m_decoder.reset();
+	}
+}
@@ -0,0 +1,67 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+#include "FFmpegInteropAudioExtractor.g.h"
+
+namespace winrt::FFmpegInterop::implementation
+{
+	class AudioFileDecoder;
+
+	class FFmpegInteropAudioExtractor :
+		public FFmpegInteropAudioExtractorT<FFmpegInteropAudioExtractor>
+	{
+	public:
+		FFmpegInteropAudioExtractor(
+			_In_ const Windows::Storage::Streams::IRandomAccessStream& fileStream,
+			_In_ uint32_t channelCount,
+			_In_ uint32_t sampleRate,
+			_In_ const Windows::Foundation::TimeSpan& chunkDuration);
+		~FFmpegInteropAudioExtractor();
+
+		uint32_t ChannelCount();
+		uint32_t SampleRate();
+		Windows::Foundation::TimeSpan Duration();
+		Windows::Foundation::TimeSpan Position();
+		Windows::Storage::Streams::IBuffer ReadChunk();
+		void Seek(_In_ const Windows::Foundation::TimeSpan& position);
+		void Close();
+
+	private:
+		// Number of chunks to decode ahead of the caller. Each one holds an output buffer until the caller releases it.
+		static constexpr uint32_t DECODE_AHEAD_DEPTH{ 2 };
+		static constexpr std::chrono::seconds DEFAULT_CHUNK_DURATION{ 1 };
+
+		std::mutex m_lock;
+		std::unique_ptr<AudioFileDecoder> m_decoder;
+		uint32_t m_channelCount{ 0 };
+		uint32_t m_sampleRate{ 0 };
+		int64_t m_duration{ 0 }; // hns
+		int64_t m_position{ 0 }; // hns
+	};
+}
+
+namespace winrt::FFmpegInterop::factory_implementation
+{
+	struct FFmpegInteropAudioExtractor :
+		public FFmpegInteropAudioExtractorT<FFmpegInteropAudioExtractor, implementation::FFmpegInteropAudioExtractor>
+	{
+
+	};
+}
@@ -0,0 +1,176 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "FFmpegInteropAudioScanner.h"
+#include "FFmpegInteropAudioScanner.g.cpp"
+#include "AudioScanResult.h"
+#include "AudioFileDecoder.h"
+#include "AudioScanAnalyzer.h"
+
+using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Storage::Streams;
+using namespace std;
+
+namespace winrt::FFmpegInterop::implementation
+{
+	IAsyncOperationWithProgress<FFmpegInterop::AudioScanResult, double> FFmpegInteropAudioScanner::ScanAsync(
+		_In_ IRandomAccessStream fileStream,
+		_In_ uint32_t samplesPerPeak)
+	{
+		THROW_HR_IF_NULL(E_INVALIDARG, fileStream);
+
+		auto cancellation{ co_await get_cancellation_token() };
+		auto progress{ co_await get_progress_token() };
+
+		co_await resume_background();
+
+		auto logger{ FFmpegInteropProvider::ScanAudio::Start() };
+		[[maybe_unused]] wil::ThreadErrorContext errorContext; // Enable WIL's thread error cache for averror_to_hresult()
+
+		if (samplesPerPeak == 0)
+		{
+			samplesPerPeak = DEFAULT_SAMPLES_PER_PEAK;
+		}
+
+		// Open the file to plan the segments. The first segment reuses this decoder.
+		unique_ptr<AudioFileDecoder> firstDecoder{ make_unique<AudioFileDecoder>(fileStream, 0, 0) };
+		const int sampleRate{ firstDecoder->GetSampleRate() };
+		const int channels{ firstDecoder->GetChannelCount() };
+		const int64_t duration{ firstDecoder->GetDuration() };
+		const int64_t sampleCount{ av_rescale(duration, sampleRate, HNS_PER_SEC) };
+		const vector<double> loudnessWeights{ GetLoudnessWeights(firstDecoder->GetChannelLayout()) };
+
+		// Split long files into segments that are decoded in parallel. Files with an unknown duration are scanned in one pass.
+		const int64_t segmentCount{ clamp<int64_t>(duration / MIN_SEGMENT_DURATION, 1, max(thread::hardware_concurrency(), 1u)) };
+
+		vector<AudioScanAnalyzer> segments;
+		segments.reserve(static_cast<size_t>(segmentCount));
+		for (int64_t i{ 0 }; i < segmentCount; i++)
+		{
+			const int64_t startSample{ sampleCount * i / segmentCount };
+			const int64_t endSample{ i + 1 < segmentCount ? sampleCount * (i + 1) / segmentCount : numeric_limits<int64_t>::max() };
+			segments.emplace_back(sampleRate, loudnessWeights, samplesPerPeak, startSample, endSample);
+		}
+
+		FFMPEG_INTEROP_TRACE("Scanning %I64d samples in %I64d segments", sampleCount, segmentCount);
+
+		atomic<int64_t> analyzedSamples{ 0 };
+		mutex progressLock;
+		double reportedProgress{ 0.0 };
+
+		concurrency::parallel_for(int64_t{ 0 }, segmentCount, [&](int64_t i)
+			{
+				[[maybe_unused]] wil::ThreadErrorContext errorContext;
+
+				AudioScanAnalyzer& segment{ segments[static_cast<size_t>(i)] };
+				unique_ptr<AudioFileDecoder> decoder;
+
+				if (i == 0)
+				{
+					decoder = move(firstDecoder);
+				}
+				else
+				{
+					// Each segment has its own demuxer and decoder over its own view of the file
+					decoder = make_unique<AudioFileDecoder>(fileStream.CloneStream(), 0, 0);
+					THROW_HR_IF(E_UNEXPECTED, decoder->GetSampleRate() != sampleRate || decoder->GetChannelCount() != channels);
+
+					const int64_t startTime{ av_rescale(segment.GetStartSample(), HNS_PER_SEC, sampleRate) };
+					decoder->Seek(max<int64_t>(startTime - SEGMENT_PREROLL, 0));
+				}
+
+				while (!segment.IsComplete() && !cancellation())
+				{
+					const auto [buf, pts, dur] = decoder->ReadSamples();
+					if (buf == nullptr)
+					{
+						break;
+					}
+
+					const int64_t previousPosition{ max(segment.GetPosition(), segment.GetStartSample()) };
+					segment.AddSamples(reinterpret_cast<const float*>(buf.data()), av_rescale(pts, sampleRate, HNS_PER_SEC), static_cast<int>(buf.Length() / (sizeof(float) * channels)));
+
+					if (sampleCount > 0)
+					{
+						const int64_t analyzed{ analyzedSamples += max<int64_t>(segment.GetPosition() - previousPosition, 0) };
+						const double value{ min(static_cast<double>(analyzed) / sampleCount, 1.0) };
+
+						// Report progress in steps rather than for every batch of samples
+						lock_guard<mutex> lock{ progressLock };
+						if (value >= reportedProgress + PROGRESS_STEP)
+						{
+							reportedProgress = value;
+							progress(value);
+						}
+					}
+				}
+			});
+
+		THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_CANCELLED), cancellation());
+
+		int64_t decodedSamples{ 0 };
+		for (const AudioScanAnalyzer& segment : segments)
+		{
+			decodedSamples = max(decodedSamples, segment.GetPosition());
+		}
+
+		vector<vector<float>> peaks{ AudioScanAnalyzer::MergePeaks(segments) };
+		const double integratedLoudness{ AudioScanAnalyzer::MergeLoudness(segments) };
+
+		progress(1.0);
+		logger.Stop();
+
+		co_return make<AudioScanResult>(
+			av_rescale(decodedSamples, HNS_PER_SEC, sampleRate),
+			static_cast<uint32_t>(sampleRate),
+			static_cast<uint32_t>(channels),
+			integratedLoudness,
+			samplesPerPeak,
+			move(peaks));
+	}
+
+	vector<double> FFmpegInteropAudioScanner::GetLoudnessWeights(_In_ const AVChannelLayout& channelLayout)
+	{
+		// ITU-R BS.1770 weights the surround channels up and leaves out the LFE channels
+		vector<double> weights(static_cast<size_t>(channelLayout.nb_channels), 1.0);
+
+		for (int i{ 0 }; i < channelLayout.nb_channels; i++)
+		{
+			switch (av_channel_layout_channel_from_index(&channelLayout, static_cast<unsigned int>(i)))
+			{
+			case AV_CHAN_LOW_FREQUENCY:
+			case AV_CHAN_LOW_FREQUENCY_2:
+				weights[i] = 0.0;
+				break;
+
+			case AV_CHAN_SIDE_LEFT:
+			case AV_CHAN_SIDE_RIGHT:
+			case AV_CHAN_BACK_LEFT:
+			case AV_CHAN_BACK_RIGHT:
+				weights[i] = 1.41;
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		return weights;
+	}
+}
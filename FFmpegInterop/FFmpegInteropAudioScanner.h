@@ -0,0 +1,56 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+#include "FFmpegInteropAudioScanner.g.h"
+
+namespace winrt::FFmpegInterop::implementation
+{
+	class FFmpegInteropAudioScanner
+	{
+	public:
+		static Windows::Foundation::IAsyncOperationWithProgress<FFmpegInterop::AudioScanResult, double> ScanAsync(
+			_In_ Windows::Storage::Streams::IRandomAccessStream fileStream,
+			_In_ uint32_t samplesPerPeak);
+
+	private:
+		FFmpegInteropAudioScanner() = delete;
+
+		static std::vector<double> GetLoudnessWeights(_In_ const AVChannelLayout& channelLayout);
+
+		static constexpr uint32_t DEFAULT_SAMPLES_PER_PEAK{ 256 };
+
+		// Files are split into segments of at least this length (hns) so each decoder's setup cost is worth it
+		static constexpr int64_t MIN_SEGMENT_DURATION{ 60 * HNS_PER_SEC };
+
+		// Each segment starts decoding this far (hns) before its range to settle the decoder and the loudness filter
+		static constexpr int64_t SEGMENT_PREROLL{ HNS_PER_SEC / 2 };
+
+		static constexpr double PROGRESS_STEP{ 0.01 };
+	};
+}
+
+namespace winrt::FFmpegInterop::factory_implementation
+{
+	struct FFmpegInteropAudioScanner :
+		public FFmpegInteropAudioScannerT<FFmpegInteropAudioScanner, implementation::FFmpegInteropAudioScanner>
+	{
+
+	};
+}
@@ -44,6 +44,16 @@ namespace winrt::FFmpegInterop::implementation
 		m_buf.get_deleter() = [bufRef{ move(bufRef) }](uint8_t*) noexcept { };
 	}
 
+	FFmpegInteropBuffer::FFmpegInteropBuffer(_In_ AVBufferRef_ptr bufRef, _In_ uint32_t length) :
+		m_length(length)
+	{
+		// Only the first length bytes of the buffer are valid (e.g. a pooled buffer that was partially filled)
+		THROW_HR_IF(E_INVALIDARG, length > bufRef->size);
+
+		m_buf.reset(bufRef->data);
+		m_buf.get_deleter() = [bufRef{ move(bufRef) }](uint8_t*) noexcept { };
+	}
+
 	FFmpegInteropBuffer::FFmpegInteropBuffer(_In_ AVPacket_ptr packet) noexcept :
 		m_buf(packet->data),
 		m_length(packet->size)
@@ -61,6 +71,14 @@ namespace winrt::FFmpegInterop::implementation
 		}
 	}
 
+	FFmpegInteropBuffer::FFmpegInteropBuffer(_In_ AVFrame_ptr frame, _In_ uint32_t length) noexcept :
+		m_buf(frame->data[0]),
+		m_length(length)
+	{
+		// The image starts at the first plane. Keep all of the frame's buffers alive.
+		m_buf.get_deleter() = [frame{ move(frame) }](uint8_t*) noexcept { };
+	}
+
 	FFmpegInteropBuffer::FFmpegInteropBuffer(_In_ AVBlob_ptr buf, _In_ uint32_t bufSize) noexcept :
 		m_buf(static_cast<uint8_t*>(buf.get())),
 		m_length(bufSize)
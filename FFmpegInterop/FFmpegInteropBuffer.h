@@ -30,7 +30,9 @@ namespace winrt::FFmpegInterop::implementation
 	public:
 		FFmpegInteropBuffer(_In_ AVBufferRef* bufRef);
 		FFmpegInteropBuffer(_In_ AVBufferRef_ptr bufRef);
+		FFmpegInteropBuffer(_In_ AVBufferRef_ptr bufRef, _In_ uint32_t length);
 		FFmpegInteropBuffer(_In_ AVPacket_ptr packet) noexcept;
+		FFmpegInteropBuffer(_In_ AVFrame_ptr frame, _In_ uint32_t length) noexcept;
 		FFmpegInteropBuffer(_In_ AVBlob_ptr buf, _In_ uint32_t bufSize) noexcept;
 		FFmpegInteropBuffer(_In_ std::vector<uint8_t>&& buf) noexcept;
 
@@ -28,36 +28,17 @@ using namespace winrt::Windows::Foundation;
 using namespace winrt::Windows::Foundation::Collections;
 using namespace winrt::Windows::Foundation::Metadata;
 using namespace winrt::Windows::Media::Core;
+using namespace winrt::Windows::Media::MediaProperties;
 using namespace winrt::Windows::Storage::Streams;
 using namespace std;
 
 namespace
 {
-	// Function to read from file stream. Credit to Philipp Sch http://www.codeproject.com/Tips/489450/Creating-Custom-FFmpeg-IO-Context
-	int FileStreamRead(void* ptr, uint8_t* buf, int bufSize)
+	// Only PCM and float output can be replayed from the decoded audio cache
+	bool IsUncompressedAudioSubtype(_In_ const hstring& subtype)
 	{
-		IStream* fileStream{ reinterpret_cast<IStream*>(ptr) };
-		ULONG bytesRead{ 0 };
-
-		RETURN_IF_FAILED(fileStream->Read(buf, bufSize, &bytesRead));
-
-		// Assume we've reached EOF if we didn't read any bytes
-		RETURN_HR_IF(static_cast<HRESULT>(AVERROR_EOF), bytesRead == 0);
-
-		return bytesRead;
-	}
-
-	// Function to seek in file stream. Credit to Philipp Sch http://www.codeproject.com/Tips/489450/Creating-Custom-FFmpeg-IO-Context
-	int64_t FileStreamSeek(void* ptr, int64_t pos, int whence)
-	{
-		IStream* fileStream{ reinterpret_cast<IStream*>(ptr) };
-		LARGE_INTEGER in{ 0 };
-		in.QuadPart = pos;
-		ULARGE_INTEGER out{ 0 };
-
-		RETURN_IF_FAILED(fileStream->Seek(in, whence, &out));
-
-		return out.QuadPart;
+		return subtype == MediaEncodingSubtypes::Pcm() || subtype == to_hstring(MFAudioFormat_PCM) ||
+			subtype == MediaEncodingSubtypes::Float() || subtype == to_hstring(MFAudioFormat_Float);
 	}
 }
 
@@ -97,8 +78,18 @@ namespace winrt::FFmpegInterop::implementation
 	{
 		try
 		{
+			if (InitFromDecodedAudioCache(fileStream, config))
+			{
+				return;
+			}
+
 			OpenFile(fileStream, config);
 			InitFFmpegContext(config);
+
+			if (m_recordedClip != nullptr)
+			{
+				StartRecordingClip();
+			}
 		}
 		catch (...)
 		{
@@ -202,6 +193,37 @@ namespace winrt::FFmpegInterop::implementation
 		{
 			AVStream* stream{ m_formatContext->streams[i] };
 
+			// Skip streams whose packets are already consumed by another stream's sample provider (e.g. the AC-3 stream embedded in TrueHD)
+			if (auto iter{ m_streamIdMap.find(i) }; iter != m_streamIdMap.end())
+			{
+				FFMPEG_INTEROP_TRACE("Stream %d: Provided by another stream", i);
+
+				if (i == audioStreamId)
+				{
+					// This was the preferred audio stream. The stream providing it was enumerated earlier and is still pending, so
+					// add it first and select it.
+					const auto preferredIter{ find_if(pendingAudioStreamDescriptors.begin(), pendingAudioStreamDescriptors.end(),
+						[&](_In_ const IMediaStreamDescriptor& descriptor) { return m_streamDescriptorMap.at(descriptor).get() == iter->second; }) };
+					WINRT_ASSERT(preferredIter != pendingAudioStreamDescriptors.end());
+
+					if (preferredIter != pendingAudioStreamDescriptors.end())
+					{
+						m_mss.AddStreamDescriptor(*preferredIter);
+						pendingAudioStreamDescriptors.erase(preferredIter);
+					}
+
+					iter->second->Select();
+
+					for (auto& audioStreamDescriptor : pendingAudioStreamDescriptors)
+					{
+						m_mss.AddStreamDescriptor(move(audioStreamDescriptor));
+					}
+					pendingAudioStreamDescriptors.clear();
+				}
+
+				continue;
+			}
+
 			// Discard all samples for this stream until it is selected
 			stream->discard = AVDISCARD_ALL;
 
@@ -321,14 +343,23 @@ namespace winrt::FFmpegInterop::implementation
 				continue;
 			}
 
-			// Add the stream to our maps
-			m_streamIdMap[i] = sampleProvider.get();
+			// Add the stream to our maps. The sample provider may be backed by a different stream than the one enumerated.
+			m_streamIdMap[sampleProvider->GetStreamIndex()] = sampleProvider.get();
 			m_streamDescriptorMap[move(streamDescriptor)] = move(sampleProvider);
 		}
 
 		WINRT_ASSERT(pendingAudioStreamDescriptors.empty());
 		WINRT_ASSERT(pendingVideoStreamDescriptors.empty());
 
+		if (videoStreamId < 0)
+		{
+			// Nothing needs to stay in sync with audio at a fine grain, so decoders may work in bursts
+			for (auto& [streamDescriptor, sampleProvider] : m_streamDescriptorMap)
+			{
+				sampleProvider->NotifyAudioOnly();
+			}
+		}
+
 		if (m_formatContext->duration > 0)
 		{
 			// Set the duration
@@ -357,13 +388,186 @@ namespace winrt::FFmpegInterop::implementation
 		FFMPEG_INTEROP_TRACE("Populating format metadata");
 		PopulateMetadata(m_mss, m_formatContext->metadata);
 
+		RegisterEventHandlers();
+	}
+
+	void FFmpegInteropMSS::RegisterEventHandlers()
+	{
 		// Register event handlers. The delegates hold strong references to tie the lifetime of this object to the MSS.
 		m_startingRevoker = m_mss.Starting(auto_revoke, { get_strong(), &FFmpegInteropMSS::OnStarting });
 		m_sampleRequestedRevoker = m_mss.SampleRequested(auto_revoke, { get_strong(), &FFmpegInteropMSS::OnSampleRequested });
 		m_switchStreamsRequestedRevoker = m_mss.SwitchStreamsRequested(auto_revoke, { get_strong(), &FFmpegInteropMSS::OnSwitchStreamsRequested });
+
+		// The SampleRendered event reports how late the renderer is. It was added in RS2.
+		if (ApiInformation::IsEventPresent(L"Windows.Media.Core.MediaStreamSource", L"SampleRendered"))
+		{
+			m_sampleRenderedRevoker = m_mss.SampleRendered(auto_revoke, { get_strong(), &FFmpegInteropMSS::OnSampleRendered });
+		}
+
 		m_closedRevoker = m_mss.Closed(auto_revoke, { get_strong(), &FFmpegInteropMSS::OnClosed });
 	}
 
+	bool FFmpegInteropMSS::InitFromDecodedAudioCache(_In_ const IRandomAccessStream& fileStream, _In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config)
+	{
+		if (config == nullptr || config.DecodedAudioCacheCapacity() == 0)
+		{
+			return false;
+		}
+
+		DecodedAudioCache::SetCapacity(static_cast<size_t>(min<uint64_t>(config.DecodedAudioCacheCapacity(), numeric_limits<size_t>::max())));
+
+		THROW_HR_IF_NULL(E_INVALIDARG, fileStream);
+		const uint64_t fileSize{ fileStream.Size() };
+		if (fileSize == 0 || fileSize > DecodedAudioCache::MAX_FILE_SIZE)
+		{
+			return false;
+		}
+
+		// Read the whole file to identify it. It's small enough that this costs less than probing it.
+		com_ptr<IStream> stream;
+		THROW_IF_FAILED(CreateStreamOverRandomAccessStream(winrt::get_unknown(fileStream), __uuidof(stream), stream.put_void()));
+
+		vector<uint8_t> content(static_cast<size_t>(fileSize));
+		ULONG bytesRead{ 0 };
+		THROW_IF_FAILED(stream->Seek({ }, STREAM_SEEK_SET, nullptr));
+		THROW_IF_FAILED(stream->Read(content.data(), static_cast<ULONG>(content.size()), &bytesRead));
+		THROW_IF_FAILED(stream->Seek({ }, STREAM_SEEK_SET, nullptr));
+
+		if (bytesRead != content.size())
+		{
+			return false;
+		}
+
+		const size_t contentHash{ DecodedAudioCache::Hash(content) };
+		shared_ptr<const DecodedAudioClip> clip{ DecodedAudioCache::Find(contentHash, content) };
+		if (clip == nullptr)
+		{
+			// Record the decoded clip during playback so later sessions can use it
+			m_recordedClip = make_shared<DecodedAudioClip>();
+			m_recordedClip->contentHash = contentHash;
+			m_recordedClip->content = move(content);
+			return false;
+		}
+
+		FFMPEG_INTEROP_TRACE("Playing clip from the decoded audio cache. Samples = %zu, Duration = %I64d hns", clip->samples.size(), clip->duration);
+
+		AudioEncodingProperties encProp{ AudioEncodingProperties::CreatePcm(clip->sampleRate, clip->channelCount, clip->bitsPerSample) };
+		encProp.Subtype(clip->subtype);
+
+		MediaPropertySet properties{ encProp.Properties() };
+		for (const auto& [key, value] : clip->properties)
+		{
+			properties.Insert(key, value);
+		}
+
+		m_mss.AddStreamDescriptor(AudioStreamDescriptor{ encProp });
+		m_mss.Duration(TimeSpan{ clip->duration });
+		m_mss.CanSeek(true);
+
+		m_cachedClip = move(clip);
+		RegisterEventHandlers();
+
+		return true;
+	}
+
+	void FFmpegInteropMSS::GetCachedClipSample(_In_ const MediaStreamSourceSampleRequest& request)
+	{
+		if (m_cachedClipSampleIndex >= m_cachedClip->samples.size())
+		{
+			// Leave the request without a sample to signal EOS
+			return;
+		}
+
+		const DecodedAudioClip::Sample& clipSample{ m_cachedClip->samples[m_cachedClipSampleIndex++] };
+
+		MediaStreamSample sample{ MediaStreamSample::CreateFromBuffer(clipSample.buffer, TimeSpan{ clipSample.pts }) };
+		sample.Duration(TimeSpan{ clipSample.dur });
+		sample.Discontinuous(exchange(m_isCachedClipDiscontinuous, false));
+
+		request.Sample(sample);
+	}
+
+	void FFmpegInteropMSS::StartRecordingClip()
+	{
+		// Only files with a single audio stream that's decoded to PCM are cached
+		const AudioStreamDescriptor audioStreamDescriptor{ m_streamDescriptorMap.size() == 1 ?
+			m_streamDescriptorMap.begin()->first.try_as<AudioStreamDescriptor>() : nullptr };
+
+		if (audioStreamDescriptor == nullptr)
+		{
+			m_recordedClip.reset();
+			return;
+		}
+
+		const AudioEncodingProperties encProp{ audioStreamDescriptor.EncodingProperties() };
+		if (!IsUncompressedAudioSubtype(encProp.Subtype()))
+		{
+			m_recordedClip.reset();
+			return;
+		}
+
+		m_recordedClip->subtype = encProp.Subtype();
+		m_recordedClip->sampleRate = encProp.SampleRate();
+		m_recordedClip->channelCount = encProp.ChannelCount();
+		m_recordedClip->bitsPerSample = encProp.BitsPerSample();
+		m_recordedClip->size = m_recordedClip->content.size();
+	}
+
+	void FFmpegInteropMSS::RecordClipSample(_In_ const MediaStreamSourceSampleRequest& request)
+	{
+		const MediaStreamSample sample{ request.Sample() };
+		if (sample == nullptr)
+		{
+			return;
+		}
+
+		// The decoded buffers aren't written to again once they're handed to the MSS, so they can be shared as is
+		const AudioEncodingProperties encProp{ request.StreamDescriptor().as<AudioStreamDescriptor>().EncodingProperties() };
+		const IBuffer buffer{ sample.Buffer() };
+		const bool isFormatChanged{ encProp.Subtype() != m_recordedClip->subtype ||
+			encProp.SampleRate() != m_recordedClip->sampleRate ||
+			encProp.ChannelCount() != m_recordedClip->channelCount ||
+			encProp.BitsPerSample() != m_recordedClip->bitsPerSample };
+
+		if (isFormatChanged || (sample.Discontinuous() && !m_recordedClip->samples.empty()))
+		{
+			FFMPEG_INTEROP_TRACE("Format change or discontinuity during recording. Not caching the clip.");
+			m_recordedClip.reset();
+			return;
+		}
+
+		m_recordedClip->size += buffer.Length();
+		if (m_recordedClip->size > DecodedAudioCache::GetCapacity())
+		{
+			FFMPEG_INTEROP_TRACE("Decoded clip exceeds the cache capacity. Not caching the clip.");
+			m_recordedClip.reset();
+			return;
+		}
+
+		m_recordedClip->samples.push_back({ buffer, sample.Timestamp().count(), sample.Duration().count() });
+	}
+
+	void FFmpegInteropMSS::FinishRecordingClip()
+	{
+		shared_ptr<DecodedAudioClip> clip{ move(m_recordedClip) };
+		if (clip->samples.empty())
+		{
+			return;
+		}
+
+		const DecodedAudioClip::Sample& lastSample{ clip->samples.back() };
+		clip->duration = lastSample.pts + lastSample.dur;
+
+		// Snapshot the output format so cached sessions report exactly what this one did
+		const AudioEncodingProperties encProp{ m_streamDescriptorMap.begin()->first.as<AudioStreamDescriptor>().EncodingProperties() };
+		for (const auto& [key, value] : encProp.Properties())
+		{
+			clip->properties.emplace_back(key, value);
+		}
+
+		DecodedAudioCache::Add(move(clip));
+	}
+
 	void FFmpegInteropMSS::OnStarting(_In_ const MediaStreamSource&, _In_ const MediaStreamSourceStartingEventArgs& args)
 	{
 		auto logger{ FFmpegInteropProvider::OnStarting::Start() };
@@ -380,6 +584,28 @@ namespace winrt::FFmpegInterop::implementation
 			const TimeSpan hnsSeekTime{ startPosition.Value() };
 			FFMPEG_INTEROP_TRACE("Seek to %I64d hns", hnsSeekTime.count());
 
+			if (m_cachedClip != nullptr)
+			{
+				// Start from the first cached sample that ends after the seek time
+				const vector<DecodedAudioClip::Sample>& samples{ m_cachedClip->samples };
+				const auto iter{ find_if(samples.begin(), samples.end(),
+					[&](const DecodedAudioClip::Sample& sample) { return sample.pts + sample.dur > hnsSeekTime.count(); }) };
+
+				m_cachedClipSampleIndex = static_cast<size_t>(iter - samples.begin());
+				m_isCachedClipDiscontinuous = true;
+				request.SetActualStartPosition(iter != samples.end() ? TimeSpan{ iter->pts } : hnsSeekTime);
+
+				logger.Stop();
+				return;
+			}
+
+			if (m_recordedClip != nullptr && (hnsSeekTime.count() != 0 || !m_recordedClip->samples.empty()))
+			{
+				// Only a single uninterrupted playback from the start is recorded
+				FFMPEG_INTEROP_TRACE("Seek during recording. Not caching the clip.");
+				m_recordedClip.reset();
+			}
+
 			try
 			{
 				// Convert the seek time from HNS to AV_TIME_BASE
@@ -392,6 +618,12 @@ namespace winrt::FFmpegInterop::implementation
 					avSeekTime += m_formatContext->start_time;
 				}
 
+				// Stop any decode-ahead threads so they don't read packets while the demuxer is repositioned
+				for (auto& [streamId, stream] : m_streamIdMap)
+				{
+					stream->Pause();
+				}
+
 				THROW_HR_IF_FFMPEG_FAILED(avformat_seek_file(m_formatContext.get(), -1, numeric_limits<int64_t>::min(), avSeekTime, avSeekTime, 0));
 
 				for (auto& [streamId, stream] : m_streamIdMap)
@@ -427,8 +659,20 @@ namespace winrt::FFmpegInterop::implementation
 
 		try
 		{
-			// Get the next sample for the stream
-			m_streamDescriptorMap.at(request.StreamDescriptor())->GetSample(request);
+			if (m_cachedClip != nullptr)
+			{
+				GetCachedClipSample(request);
+			}
+			else
+			{
+				// Get the next sample for the stream
+				m_streamDescriptorMap.at(request.StreamDescriptor())->GetSample(request);
+
+				if (m_recordedClip != nullptr)
+				{
+					RecordClipSample(request);
+				}
+			}
 
 			logger.Stop();
 		}
@@ -443,16 +687,40 @@ namespace winrt::FFmpegInterop::implementation
 					sampleProvider->NotifyEOF();
 				}
 
+				if (m_recordedClip != nullptr)
+				{
+					FinishRecordingClip();
+				}
+
 				logger.Stop(); // This is an expected error. No need to log it.
 			}
 			else
 			{
+				m_recordedClip.reset();
+
 				// Notify the MSS that an error occurred
 				m_mss.NotifyError(MediaStreamSourceErrorStatus::Other);
 			}
 		}
 	}
 
+	void FFmpegInteropMSS::OnSampleRendered(_In_ const MediaStreamSource&, _In_ const MediaStreamSourceSampleRenderedEventArgs& args)
+	{
+		auto logger{ FFmpegInteropProvider::OnSampleRendered::Start() };
+
+		const int64_t hnsSampleLag{ args.SampleLag().count() };
+
+		lock_guard<mutex> lock{ m_lock };
+
+		// Let the streams know how late the renderer is so they can catch up
+		for (auto& [streamId, sampleProvider] : m_streamIdMap)
+		{
+			sampleProvider->NotifySampleLag(hnsSampleLag);
+		}
+
+		logger.Stop();
+	}
+
 	void FFmpegInteropMSS::OnSwitchStreamsRequested(_In_ const MediaStreamSource&, _In_ const MediaStreamSourceSwitchStreamsRequestedEventArgs& args)
 	{
 		auto logger{ FFmpegInteropProvider::OnSwitchStreamsRequested::Start() };
@@ -466,6 +734,13 @@ namespace winrt::FFmpegInterop::implementation
 
 		lock_guard<mutex> lock{ m_lock };
 
+		if (m_cachedClip != nullptr)
+		{
+			// A cached clip has a single stream and nothing to select or deselect
+			logger.Stop();
+			return;
+		}
+
 		try
 		{
 			if (oldStreamDescriptor != nullptr)
@@ -504,9 +779,16 @@ namespace winrt::FFmpegInterop::implementation
 		// remote app process is terminated.
 		m_startingRevoker.revoke();
 		m_sampleRequestedRevoker.revoke();
+		m_sampleRenderedRevoker.revoke();
 		m_switchStreamsRequestedRevoker.revoke();
 		m_closedRevoker.revoke();
 
+		// Stop any decode-ahead threads
+		for (auto& [streamId, sampleProvider] : m_streamIdMap)
+		{
+			sampleProvider->Pause();
+		}
+
 		// Release the MSS and file stream
 		// This is critically important to do for the media source app service scenario! The remote app process may be suspended anytime after 
 		// this Closed event is processed. If we don't release the file stream now, then we'll effectively leak the file handle which could 
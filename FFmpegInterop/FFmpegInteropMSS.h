@@ -20,6 +20,7 @@
 
 #include "FFmpegInteropMSS.g.h"
 #include "Reader.h"
+#include "DecodedAudioCache.h"
 
 namespace winrt::FFmpegInterop::implementation
 {
@@ -40,9 +41,17 @@ namespace winrt::FFmpegInterop::implementation
 		void OpenFile(_In_z_ const char* uri, _In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config);
 
 		void InitFFmpegContext(_In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config);
+		void RegisterEventHandlers();
+
+		bool InitFromDecodedAudioCache(_In_ const Windows::Storage::Streams::IRandomAccessStream& fileStream, _In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config);
+		void GetCachedClipSample(_In_ const Windows::Media::Core::MediaStreamSourceSampleRequest& request);
+		void StartRecordingClip();
+		void RecordClipSample(_In_ const Windows::Media::Core::MediaStreamSourceSampleRequest& request);
+		void FinishRecordingClip();
 
 		void OnStarting(_In_ const Windows::Media::Core::MediaStreamSource& sender, _In_ const Windows::Media::Core::MediaStreamSourceStartingEventArgs& args);
 		void OnSampleRequested(_In_ const Windows::Media::Core::MediaStreamSource& sender, _In_ const Windows::Media::Core::MediaStreamSourceSampleRequestedEventArgs& args);
+		void OnSampleRendered(_In_ const Windows::Media::Core::MediaStreamSource& sender, _In_ const Windows::Media::Core::MediaStreamSourceSampleRenderedEventArgs& args);
 		void OnSwitchStreamsRequested(_In_ const Windows::Media::Core::MediaStreamSource& sender, _In_ const Windows::Media::Core::MediaStreamSourceSwitchStreamsRequestedEventArgs& args);
 		void OnClosed(_In_ const Windows::Media::Core::MediaStreamSource& sender, _In_ const Windows::Media::Core::MediaStreamSourceClosedEventArgs& args);
 
@@ -55,8 +64,14 @@ namespace winrt::FFmpegInterop::implementation
 		std::map<Windows::Media::Core::IMediaStreamDescriptor, std::unique_ptr<SampleProvider>> m_streamDescriptorMap;
 		std::map<int, SampleProvider*> m_streamIdMap;
 
+		std::shared_ptr<const DecodedAudioClip> m_cachedClip; // Set if the session plays a clip from the decoded audio cache
+		size_t m_cachedClipSampleIndex{ 0 };
+		bool m_isCachedClipDiscontinuous{ true };
+		std::shared_ptr<DecodedAudioClip> m_recordedClip; // Set while the session records its clip for the decoded audio cache
+
 		Windows::Media::Core::MediaStreamSource::Starting_revoker m_startingRevoker;
 		Windows::Media::Core::MediaStreamSource::SampleRequested_revoker m_sampleRequestedRevoker;
+		Windows::Media::Core::MediaStreamSource::SampleRendered_revoker m_sampleRenderedRevoker;
 		Windows::Media::Core::MediaStreamSource::SwitchStreamsRequested_revoker m_switchStreamsRequestedRevoker;
 		Windows::Media::Core::MediaStreamSource::Closed_revoker m_closedRevoker;
 	};
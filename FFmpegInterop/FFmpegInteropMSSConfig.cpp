@@ -20,7 +20,9 @@
 #include "FFmpegInteropMSSConfig.h"
 #include "FFmpegInteropMSSConfig.g.cpp"
 
+using namespace winrt::Windows::Foundation;
 using namespace winrt::Windows::Foundation::Collections;
+using namespace std;
 
 namespace winrt::FFmpegInterop::implementation
 {
@@ -64,8 +66,191 @@ namespace winrt::FFmpegInterop::implementation
         m_allowedDecodeErrors = allowedDecodeErrors;
     }
 
+    uint32_t FFmpegInteropMSSConfig::DecodeAheadDepth()
+    {
+        return m_decodeAheadDepth;
+    }
+
+    void FFmpegInteropMSSConfig::DecodeAheadDepth(_In_ uint32_t decodeAheadDepth)
+    {
+        m_decodeAheadDepth = decodeAheadDepth;
+    }
+
+    FFmpegInterop::DecoderThreadPriority FFmpegInteropMSSConfig::DecoderThreadPriority()
+    {
+        return m_decoderThreadPriority;
+    }
+
+    void FFmpegInteropMSSConfig::DecoderThreadPriority(_In_ FFmpegInterop::DecoderThreadPriority decoderThreadPriority)
+    {
+        m_decoderThreadPriority = decoderThreadPriority;
+    }
+
+    bool FFmpegInteropMSSConfig::AdaptiveDecodeQuality()
+    {
+        return m_adaptiveDecodeQuality;
+    }
+
+    void FFmpegInteropMSSConfig::AdaptiveDecodeQuality(_In_ bool adaptiveDecodeQuality)
+    {
+        m_adaptiveDecodeQuality = adaptiveDecodeQuality;
+    }
+
+    uint32_t FFmpegInteropMSSConfig::TargetVideoWidth()
+    {
+        return m_targetVideoWidth;
+    }
+
+    void FFmpegInteropMSSConfig::TargetVideoWidth(_In_ uint32_t targetVideoWidth)
+    {
+        m_targetVideoWidth = targetVideoWidth;
+    }
+
+    uint32_t FFmpegInteropMSSConfig::TargetVideoHeight()
+    {
+        return m_targetVideoHeight;
+    }
+
+    void FFmpegInteropMSSConfig::TargetVideoHeight(_In_ uint32_t targetVideoHeight)
+    {
+        m_targetVideoHeight = targetVideoHeight;
+    }
+
+    IVector<hstring> FFmpegInteropMSSConfig::VideoOutputSubtypes()
+    {
+        return m_videoOutputSubtypes;
+    }
+
+    FFmpegInterop::AudioOutputFormat FFmpegInteropMSSConfig::AudioOutputFormat()
+    {
+        return m_audioOutputFormat;
+    }
+
+    void FFmpegInteropMSSConfig::AudioOutputFormat(_In_ FFmpegInterop::AudioOutputFormat audioOutputFormat)
+    {
+        m_audioOutputFormat = audioOutputFormat;
+    }
+
+    uint32_t FFmpegInteropMSSConfig::AudioOutputChannels()
+    {
+        return m_audioOutputChannels;
+    }
+
+    void FFmpegInteropMSSConfig::AudioOutputChannels(_In_ uint32_t audioOutputChannels)
+    {
+        m_audioOutputChannels = audioOutputChannels;
+    }
+
+    uint32_t FFmpegInteropMSSConfig::AudioOutputSampleRate()
+    {
+        return m_audioOutputSampleRate;
+    }
+
+    void FFmpegInteropMSSConfig::AudioOutputSampleRate(_In_ uint32_t audioOutputSampleRate)
+    {
+        m_audioOutputSampleRate = audioOutputSampleRate;
+    }
+
+    FFmpegInterop::AudioBatchPolicy FFmpegInteropMSSConfig::AudioBatchPolicy()
+    {
+        return m_audioBatchPolicy;
+    }
+
+    void FFmpegInteropMSSConfig::AudioBatchPolicy(_In_ FFmpegInterop::AudioBatchPolicy audioBatchPolicy)
+    {
+        m_audioBatchPolicy = audioBatchPolicy;
+    }
+
+    TimeSpan FFmpegInteropMSSConfig::MinAudioSampleDuration()
+    {
+        return m_minAudioSampleDuration;
+    }
+
+    void FFmpegInteropMSSConfig::MinAudioSampleDuration(_In_ const TimeSpan& minAudioSampleDuration)
+    {
+        m_minAudioSampleDuration = minAudioSampleDuration;
+    }
+
+    TimeSpan FFmpegInteropMSSConfig::MaxAudioSampleDuration()
+    {
+        return m_maxAudioSampleDuration;
+    }
+
+    void FFmpegInteropMSSConfig::MaxAudioSampleDuration(_In_ const TimeSpan& maxAudioSampleDuration)
+    {
+        m_maxAudioSampleDuration = maxAudioSampleDuration;
+    }
+
+    pair<int64_t, int64_t> FFmpegInteropMSSConfig::GetAudioSampleDurationRange(_In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config)
+    {
+        const FFmpegInterop::AudioBatchPolicy policy{ config != nullptr ? config.AudioBatchPolicy() : kAudioBatchPolicyDefault };
+        switch (policy)
+        {
+        case FFmpegInterop::AudioBatchPolicy::LowLatency:
+            return { 20 * HNS_PER_SEC / MS_PER_SEC, 20 * HNS_PER_SEC / MS_PER_SEC };
+
+        case FFmpegInterop::AudioBatchPolicy::Balanced:
+            return { 40 * HNS_PER_SEC / MS_PER_SEC, 200 * HNS_PER_SEC / MS_PER_SEC };
+
+        case FFmpegInterop::AudioBatchPolicy::PowerSaver:
+            return { 200 * HNS_PER_SEC / MS_PER_SEC, 1000 * HNS_PER_SEC / MS_PER_SEC };
+
+        case FFmpegInterop::AudioBatchPolicy::Custom:
+            THROW_HR_IF(E_INVALIDARG, config.MinAudioSampleDuration() <= TimeSpan::zero() || config.MaxAudioSampleDuration() < config.MinAudioSampleDuration());
+            return { config.MinAudioSampleDuration().count(), config.MaxAudioSampleDuration().count() };
+
+        default:
+            THROW_HR(E_INVALIDARG);
+        }
+    }
+
+    bool FFmpegInteropMSSConfig::AudioBurstMode()
+    {
+        return m_audioBurstMode;
+    }
+
+    void FFmpegInteropMSSConfig::AudioBurstMode(_In_ bool audioBurstMode)
+    {
+        m_audioBurstMode = audioBurstMode;
+    }
+
+    uint64_t FFmpegInteropMSSConfig::DecodedAudioCacheCapacity()
+    {
+        return m_decodedAudioCacheCapacity;
+    }
+
+    void FFmpegInteropMSSConfig::DecodedAudioCacheCapacity(_In_ uint64_t decodedAudioCacheCapacity)
+    {
+        m_decodedAudioCacheCapacity = decodedAudioCacheCapacity;
+    }
+
+    FFmpegInterop::AudioLevelMeter FFmpegInteropMSSConfig::AudioLevelMeter()
+    {
+        return m_audioLevelMeter;
+    }
+
+    void FFmpegInteropMSSConfig::AudioLevelMeter(_In_ const FFmpegInterop::AudioLevelMeter& audioLevelMeter)
+    {
+        m_audioLevelMeter = audioLevelMeter;
+    }
+
+    bool FFmpegInteropMSSConfig::ExtractAudioCore()
+    {
+        return m_extractAudioCore;
+    }
+
+    void FFmpegInteropMSSConfig::ExtractAudioCore(_In_ bool extractAudioCore)
+    {
+        m_extractAudioCore = extractAudioCore;
+    }
+
     StringMap FFmpegInteropMSSConfig::FFmpegOptions()
     {
         return m_ffmpegOptions;
     }
+
+    StringMap FFmpegInteropMSSConfig::BitstreamFilters()
+    {
+        return m_bitstreamFilters;
+    }
 }
@@ -35,16 +35,72 @@ namespace winrt::FFmpegInterop::implementation
         void ForceVideoDecode(_In_ bool forceVideoDecode);
         uint32_t AllowedDecodeErrors();
         void AllowedDecodeErrors(_In_ uint32_t allowedDecodeErrors);
+        uint32_t DecodeAheadDepth();
+        void DecodeAheadDepth(_In_ uint32_t decodeAheadDepth);
+        FFmpegInterop::DecoderThreadPriority DecoderThreadPriority();
+        void DecoderThreadPriority(_In_ FFmpegInterop::DecoderThreadPriority decoderThreadPriority);
+        bool AdaptiveDecodeQuality();
+        void AdaptiveDecodeQuality(_In_ bool adaptiveDecodeQuality);
+        uint32_t TargetVideoWidth();
+        void TargetVideoWidth(_In_ uint32_t targetVideoWidth);
+        uint32_t TargetVideoHeight();
+        void TargetVideoHeight(_In_ uint32_t targetVideoHeight);
+        Windows::Foundation::Collections::IVector<hstring> VideoOutputSubtypes();
+        FFmpegInterop::AudioOutputFormat AudioOutputFormat();
+        void AudioOutputFormat(_In_ FFmpegInterop::AudioOutputFormat audioOutputFormat);
+        uint32_t AudioOutputChannels();
+        void AudioOutputChannels(_In_ uint32_t audioOutputChannels);
+        uint32_t AudioOutputSampleRate();
+        void AudioOutputSampleRate(_In_ uint32_t audioOutputSampleRate);
+        FFmpegInterop::AudioBatchPolicy AudioBatchPolicy();
+        void AudioBatchPolicy(_In_ FFmpegInterop::AudioBatchPolicy audioBatchPolicy);
+        Windows::Foundation::TimeSpan MinAudioSampleDuration();
+        void MinAudioSampleDuration(_In_ const Windows::Foundation::TimeSpan& minAudioSampleDuration);
+        Windows::Foundation::TimeSpan MaxAudioSampleDuration();
+        void MaxAudioSampleDuration(_In_ const Windows::Foundation::TimeSpan& maxAudioSampleDuration);
+        bool AudioBurstMode();
+        void AudioBurstMode(_In_ bool audioBurstMode);
+        uint64_t DecodedAudioCacheCapacity();
+        void DecodedAudioCacheCapacity(_In_ uint64_t decodedAudioCacheCapacity);
+        FFmpegInterop::AudioLevelMeter AudioLevelMeter();
+        void AudioLevelMeter(_In_ const FFmpegInterop::AudioLevelMeter& audioLevelMeter);
+        bool ExtractAudioCore();
+        void ExtractAudioCore(_In_ bool extractAudioCore);
         Windows::Foundation::Collections::StringMap FFmpegOptions();
+        Windows::Foundation::Collections::StringMap BitstreamFilters();
 
         static constexpr uint32_t kAllowedDecodeErrorsDefault{ 10 };
+        static constexpr uint32_t kDecodeAheadDepthDefault{ 0 };
+        static constexpr FFmpegInterop::DecoderThreadPriority kDecoderThreadPriorityDefault{ FFmpegInterop::DecoderThreadPriority::Normal };
+        static constexpr FFmpegInterop::AudioOutputFormat kAudioOutputFormatDefault{ FFmpegInterop::AudioOutputFormat::Int16 };
+        static constexpr FFmpegInterop::AudioBatchPolicy kAudioBatchPolicyDefault{ FFmpegInterop::AudioBatchPolicy::Balanced };
+
+        // Returns the (minimum, maximum) audio sample duration in hns for the config's batch policy
+        static std::pair<int64_t, int64_t> GetAudioSampleDurationRange(_In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config);
 
     private:
         bool m_isMediaSourceAppService{ false };
         bool m_forceAudioDecode{ false };
         bool m_forceVideoDecode{ false };
         uint32_t m_allowedDecodeErrors{ kAllowedDecodeErrorsDefault };
+        uint32_t m_decodeAheadDepth{ kDecodeAheadDepthDefault };
+        std::atomic<FFmpegInterop::DecoderThreadPriority> m_decoderThreadPriority{ kDecoderThreadPriorityDefault }; // Read by decoders during playback
+        bool m_adaptiveDecodeQuality{ false };
+        uint32_t m_targetVideoWidth{ 0 };
+        uint32_t m_targetVideoHeight{ 0 };
+        Windows::Foundation::Collections::IVector<hstring> m_videoOutputSubtypes{ single_threaded_vector<hstring>() };
+        FFmpegInterop::AudioOutputFormat m_audioOutputFormat{ kAudioOutputFormatDefault };
+        uint32_t m_audioOutputChannels{ 0 };
+        uint32_t m_audioOutputSampleRate{ 0 };
+        FFmpegInterop::AudioBatchPolicy m_audioBatchPolicy{ kAudioBatchPolicyDefault };
+        Windows::Foundation::TimeSpan m_minAudioSampleDuration{ 0 };
+        Windows::Foundation::TimeSpan m_maxAudioSampleDuration{ 0 };
+        bool m_audioBurstMode{ false };
+        uint64_t m_decodedAudioCacheCapacity{ 0 };
+        FFmpegInterop::AudioLevelMeter m_audioLevelMeter{ nullptr };
+        bool m_extractAudioCore{ false };
         Windows::Foundation::Collections::StringMap m_ffmpegOptions;
+        Windows::Foundation::Collections::StringMap m_bitstreamFilters;
     };
 }
 
@@ -27,20 +27,20 @@ using namespace std;
 
 namespace winrt::FFmpegInterop::implementation
 {
-	FLACSampleProvider::FLACSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader) :
-		SampleProvider(formatContext, stream, reader)
+	FLACSampleProvider::FLACSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext) :
+		SampleProvider(formatContext, stream, reader, move(bsfContext))
 	{
-		THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, m_stream->codecpar->extradata_size < FLAC_STREAMINFO_SIZE);
+		THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, m_codecPar->extradata_size < FLAC_STREAMINFO_SIZE);
 
 		// Check if the codec private data includes the FLAC marker and block header before the FLAC stream info
-		if (equal(FLAC_MARKER.begin(), FLAC_MARKER.end(), m_stream->codecpar->extradata))
+		if (equal(FLAC_MARKER.begin(), FLAC_MARKER.end(), m_codecPar->extradata))
 		{
-			THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, static_cast<size_t>(m_stream->codecpar->extradata_size) < FLAC_MARKER.size() + FLAC_STREAMINFO_HEADER.size() + FLAC_STREAMINFO_SIZE);
-			m_flacStreamInfo = m_stream->codecpar->extradata + FLAC_MARKER.size() + FLAC_STREAMINFO_HEADER.size();
+			THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, static_cast<size_t>(m_codecPar->extradata_size) < FLAC_MARKER.size() + FLAC_STREAMINFO_HEADER.size() + FLAC_STREAMINFO_SIZE);
+			m_flacStreamInfo = m_codecPar->extradata + FLAC_MARKER.size() + FLAC_STREAMINFO_HEADER.size();
 		}
 		else
 		{
-			m_flacStreamInfo = m_stream->codecpar->extradata;
+			m_flacStreamInfo = m_codecPar->extradata;
 		}
 
 		// Update the codec parameters based on the stream info. These values may not have been set if FFmpeg wasn't built with the FLAC decoder.
@@ -49,9 +49,9 @@ namespace winrt::FFmpegInterop::implementation
 		bitstreamReader.SkipN(16); // Max block size
 		bitstreamReader.SkipN(24); // Min frame size
 		bitstreamReader.SkipN(24); // Max frame size
-		m_stream->codecpar->sample_rate = static_cast<int>(bitstreamReader.ReadN(20));
-		m_stream->codecpar->ch_layout.nb_channels = static_cast<int>(bitstreamReader.ReadN(3)) + 1;
-		m_stream->codecpar->bits_per_raw_sample = static_cast<int>(bitstreamReader.ReadN(5)) + 1;
+		m_codecPar->sample_rate = static_cast<int>(bitstreamReader.ReadN(20));
+		m_codecPar->ch_layout.nb_channels = static_cast<int>(bitstreamReader.ReadN(3)) + 1;
+		m_codecPar->bits_per_raw_sample = static_cast<int>(bitstreamReader.ReadN(5)) + 1;
 		// Remaining fields left unparsed as they are unneeded at this time
 	}
 
@@ -27,21 +27,21 @@ using namespace std;
 
 namespace winrt::FFmpegInterop::implementation
 {
-	H264SampleProvider::H264SampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader) :
-		NALUSampleProvider(formatContext, stream, reader)
+	H264SampleProvider::H264SampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext) :
+		NALUSampleProvider(formatContext, stream, reader, move(bsfContext))
 	{
 		// Parse codec private data if present
-		if (m_stream->codecpar->extradata != nullptr && m_stream->codecpar->extradata_size > 0)
+		if (m_codecPar->extradata != nullptr && m_codecPar->extradata_size > 0)
 		{
 			// Check the H264 bitstream flavor
-			if (m_stream->codecpar->extradata[0] == 1)
+			if (m_codecPar->extradata[0] == 1)
 			{
 				// avcC config format
 				FFMPEG_INTEROP_TRACE("Stream %d: AVC codec private data", m_stream->index);
 
 				m_isBitstreamAnnexB = false;
 
-				AVCConfigParser parser{ m_stream->codecpar->extradata, static_cast<uint32_t>(m_stream->codecpar->extradata_size) };
+				AVCConfigParser parser{ m_codecPar->extradata, static_cast<uint32_t>(m_codecPar->extradata_size) };
 				m_naluLengthSize = parser.GetNaluLengthSize();
 				tie(m_codecPrivateNaluData, m_codecPrivateNaluLengths) = parser.GetNaluData();
 			}
@@ -50,7 +50,7 @@ namespace winrt::FFmpegInterop::implementation
 				// Annex B format
 				FFMPEG_INTEROP_TRACE("Stream %d: Annex B codec private data", m_stream->index);
 
-				AnnexBParser parser{ m_stream->codecpar->extradata, static_cast<uint32_t>(m_stream->codecpar->extradata_size) };
+				AnnexBParser parser{ m_codecPar->extradata, static_cast<uint32_t>(m_codecPar->extradata_size) };
 				tie(m_codecPrivateNaluData, m_codecPrivateNaluLengths) = parser.GetNaluData();
 			}
 		}
@@ -66,13 +66,29 @@ namespace winrt::FFmpegInterop::implementation
 
 		if (!m_isBitstreamAnnexB)
 		{
-			AVCConfigParser parser{ m_stream->codecpar->extradata, static_cast<uint32_t>(m_stream->codecpar->extradata_size) };
+			AVCConfigParser parser{ m_codecPar->extradata, static_cast<uint32_t>(m_codecPar->extradata_size) };
 			if (parser.HasNoFMOASO())
 			{
 				MediaPropertySet properties{ encProp.Properties() };
 				properties.Insert(MF_MT_VIDEO_H264_NO_FMOASO, PropertyValue::CreateUInt32(true));
 			}
 		}
+
+		// Parse the SPS to describe the decoder configuration
+		if (auto [spsData, spsSize] = FindCodecPrivateNalu(NALU_TYPE_AVC_SPS); spsData != nullptr)
+		{
+			AVCSequenceParameterSet sps{ spsData, spsSize };
+			if (sps.IsComplete())
+			{
+				SetSequenceProperties(encProp, sps.GetInfo());
+			}
+		}
+	}
+
+	bool H264SampleProvider::IsDroppableNalu(_In_reads_(naluSize) const uint8_t* nalu, _In_ uint32_t /*naluSize*/) const noexcept
+	{
+		// Pictures with nal_ref_idc == 0 are never used for inter prediction
+		return (nalu[0] & 0x60) == 0;
 	}
 
 	AVCConfigParser::AVCConfigParser(_In_reads_(dataSize) const uint8_t* data, _In_ uint32_t dataSize) :
@@ -196,7 +212,8 @@ namespace winrt::FFmpegInterop::implementation
 
 	AVCSequenceParameterSet::AVCSequenceParameterSet(_In_reads_(dataSize) const uint8_t* data, _In_ uint32_t dataSize)
 	{
-		BitstreamReader reader{ data, dataSize };
+		const vector<uint8_t> rbsp{ GetRbspData(data, dataSize) };
+		BitstreamReader reader{ rbsp.data(), static_cast<uint32_t>(rbsp.size()) };
 
 		reader.SkipN(8); // NALU header fields
 		m_profile = reader.Read8();
@@ -204,9 +221,202 @@ namespace winrt::FFmpegInterop::implementation
 		m_level = reader.Read8();
 		m_spsId = reader.ReadUExpGolomb();
 
+		// The remaining fields are only used to describe the decoder configuration. Don't fail if they can't be parsed.
+		try
+		{
+			ParseSequenceFields(reader);
+			m_isComplete = true;
+		}
+		CATCH_LOG_MSG("Failed to parse SPS. SPS ID = %u", m_spsId);
+	}
+
+	void AVCSequenceParameterSet::ParseSequenceFields(_Inout_ BitstreamReader& reader)
+	{
+		bool separateColourPlane{ false };
+
+		switch (m_profile)
+		{
+		case 44: // CAVLC 4:4:4 Intra
+		case 83: // Scalable Baseline
+		case 86: // Scalable High
+		case 100: // High
+		case 110: // High 10
+		case 118: // Multiview High
+		case 122: // High 4:2:2
+		case 128: // Stereo High
+		case 134: // MFC High
+		case 135: // MFC Depth High
+		case 138: // Multiview Depth High
+		case 139: // Enhanced Multiview Depth High
+		case 244: // High 4:4:4 Predictive
+			m_info.chromaFormat = reader.ReadUExpGolomb();
+			THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, m_info.chromaFormat > 3);
+
+			if (m_info.chromaFormat == 3)
+			{
+				separateColourPlane = reader.Read1();
+			}
+
+			reader.SkipExpGolomb(); // bit_depth_luma_minus8
+			reader.SkipExpGolomb(); // bit_depth_chroma_minus8
+			reader.SkipN(1); // qpprime_y_zero_transform_bypass_flag
+
+			if (reader.Read1()) // seq_scaling_matrix_present_flag
+			{
+				const uint32_t scalingListCount{ m_info.chromaFormat != 3 ? 8u : 12u };
+				for (uint32_t i{ 0 }; i < scalingListCount; i++)
+				{
+					if (reader.Read1()) // seq_scaling_list_present_flag
+					{
+						SkipScalingList(reader, i < 6 ? 16 : 64);
+					}
+				}
+			}
+
+			break;
+
+		default:
+			break;
+		}
+
+		reader.SkipExpGolomb(); // log2_max_frame_num_minus4
+
+		const uint32_t picOrderCntType{ reader.ReadUExpGolomb() };
+		if (picOrderCntType == 0)
+		{
+			reader.SkipExpGolomb(); // log2_max_pic_order_cnt_lsb_minus4
+		}
+		else if (picOrderCntType == 1)
+		{
+			reader.SkipN(1); // delta_pic_order_always_zero_flag
+			reader.SkipExpGolomb(); // offset_for_non_ref_pic
+			reader.SkipExpGolomb(); // offset_for_top_to_bottom_field
+
+			const uint32_t refFramesInPicOrderCntCycle{ reader.ReadUExpGolomb() };
+			THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, refFramesInPicOrderCntCycle > 255);
+
+			for (uint32_t i{ 0 }; i < refFramesInPicOrderCntCycle; i++)
+			{
+				reader.SkipExpGolomb(); // offset_for_ref_frame
+			}
+		}
+
+		reader.SkipExpGolomb(); // max_num_ref_frames
+		reader.SkipN(1); // gaps_in_frame_num_value_allowed_flag
+
+		const uint32_t picWidthInMbs{ reader.ReadUExpGolomb() + 1 };
+		const uint32_t picHeightInMapUnits{ reader.ReadUExpGolomb() + 1 };
+		const bool frameMbsOnly{ reader.Read1() };
+		if (!frameMbsOnly)
+		{
+			reader.SkipN(1); // mb_adaptive_frame_field_flag
+		}
+		reader.SkipN(1); // direct_8x8_inference_flag
+
+		// Frame cropping offsets are in units of chroma samples (and field rows for interlaced content)
+		const uint32_t frameHeightInMbsMultiplier{ frameMbsOnly ? 1u : 2u };
+		uint32_t cropUnitX{ 1 };
+		uint32_t cropUnitY{ frameHeightInMbsMultiplier };
+		if (!separateColourPlane && m_info.chromaFormat != 0)
+		{
+			cropUnitX = m_info.chromaFormat == 3 ? 1 : 2; // SubWidthC
+			cropUnitY = (m_info.chromaFormat == 1 ? 2 : 1) * frameHeightInMbsMultiplier; // SubHeightC
+		}
+
+		if (reader.Read1()) // frame_cropping_flag
+		{
+			m_info.cropLeft = reader.ReadUExpGolomb() * cropUnitX;
+			m_info.cropRight = reader.ReadUExpGolomb() * cropUnitX;
+			m_info.cropTop = reader.ReadUExpGolomb() * cropUnitY;
+			m_info.cropBottom = reader.ReadUExpGolomb() * cropUnitY;
+		}
+
+		const uint32_t codedWidth{ picWidthInMbs * 16 };
+		const uint32_t codedHeight{ frameHeightInMbsMultiplier * picHeightInMapUnits * 16 };
+		THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, m_info.cropLeft + m_info.cropRight >= codedWidth);
+		THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, m_info.cropTop + m_info.cropBottom >= codedHeight);
+
+		m_info.codedWidth = codedWidth;
+		m_info.codedHeight = codedHeight;
+		m_info.width = codedWidth - m_info.cropLeft - m_info.cropRight;
+		m_info.height = codedHeight - m_info.cropTop - m_info.cropBottom;
+
+		if (reader.Read1()) // vui_parameters_present_flag
+		{
+			ParseVuiParameters(reader);
+		}
+	}
+
+	void AVCSequenceParameterSet::ParseVuiParameters(_Inout_ BitstreamReader& reader)
+	{
+		if (reader.Read1()) // aspect_ratio_info_present_flag
+		{
+			constexpr uint8_t EXTENDED_SAR{ 255 };
+			if (reader.Read8() == EXTENDED_SAR) // aspect_ratio_idc
+			{
+				reader.SkipN(32); // sar_width, sar_height
+			}
+		}
+
+		if (reader.Read1()) // overscan_info_present_flag
+		{
+			reader.SkipN(1); // overscan_appropriate_flag
+		}
+
+		if (reader.Read1()) // video_signal_type_present_flag
+		{
+			reader.SkipN(4); // video_format, video_full_range_flag
+			if (reader.Read1()) // colour_description_present_flag
+			{
+				reader.SkipN(24); // colour_primaries, transfer_characteristics, matrix_coefficients
+			}
+		}
+
+		if (reader.Read1()) // chroma_loc_info_present_flag
+		{
+			reader.SkipExpGolomb(); // chroma_sample_loc_type_top_field
+			reader.SkipExpGolomb(); // chroma_sample_loc_type_bottom_field
+		}
+
+		if (reader.Read1()) // timing_info_present_flag
+		{
+			const uint32_t numUnitsInTick{ reader.Read32() };
+			const uint32_t timeScale{ reader.Read32() };
+			reader.SkipN(1); // fixed_frame_rate_flag
+
+			if (numUnitsInTick != 0 && timeScale != 0)
+			{
+				// Each frame is two ticks
+				int frameRateNum{ 0 };
+				int frameRateDen{ 0 };
+				av_reduce(&frameRateNum, &frameRateDen, timeScale, 2 * static_cast<int64_t>(numUnitsInTick), numeric_limits<int>::max());
+
+				m_info.hasTimingInfo = true;
+				m_info.frameRateNumerator = static_cast<uint32_t>(frameRateNum);
+				m_info.frameRateDenominator = static_cast<uint32_t>(frameRateDen);
+			}
+		}
+
 		// Remaining fields left unparsed as they're unneeded at this time
 	}
 
+	void AVCSequenceParameterSet::SkipScalingList(_Inout_ BitstreamReader& reader, _In_ uint32_t scalingListSize)
+	{
+		int32_t lastScale{ 8 };
+		int32_t nextScale{ 8 };
+
+		for (uint32_t i{ 0 }; i < scalingListSize; i++)
+		{
+			if (nextScale != 0)
+			{
+				const int32_t deltaScale{ reader.ReadSExpGolomb() };
+				nextScale = (lastScale + deltaScale + 256) % 256;
+			}
+
+			lastScale = (nextScale == 0) ? lastScale : nextScale;
+		}
+	}
+
 	AVCPictureParameterSet::AVCPictureParameterSet(_In_reads_(dataSize) const uint8_t* data, _In_ uint32_t dataSize)
 	{
 		BitstreamReader reader{ data, dataSize };
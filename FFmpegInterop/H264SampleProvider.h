@@ -22,13 +22,22 @@
 
 namespace winrt::FFmpegInterop::implementation
 {
+	class BitstreamReader;
+
+	constexpr uint8_t NALU_TYPE_AVC_SPS{ 0x07 };
+
 	class H264SampleProvider :
 		public NALUSampleProvider
 	{
 	public:
-		H264SampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader);
+		H264SampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext);
 
 		void SetEncodingProperties(_Inout_ const Windows::Media::MediaProperties::IMediaEncodingProperties& encProp, _In_ bool setFormatUserData) override;
+
+	protected:
+		uint8_t GetNaluType(_In_ uint8_t naluHeader) const noexcept override { return naluHeader & 0x1F; }
+		bool IsVclNaluType(_In_ uint8_t naluType) const noexcept override { return naluType >= 1 && naluType <= 5; }
+		bool IsDroppableNalu(_In_reads_(naluSize) const uint8_t* nalu, _In_ uint32_t naluSize) const noexcept override;
 	};
 
 	class AVCConfigParser
@@ -69,14 +78,22 @@ namespace winrt::FFmpegInterop::implementation
 		bool GetConstraintSet5() const noexcept { return m_profileCompatibility & 0x04; }
 		uint8_t GetLevel() const noexcept{ return m_level; }
 		uint32_t GetSpsId() const noexcept { return m_spsId; }
+		bool IsComplete() const noexcept { return m_isComplete; }
+		const SequenceParameterSetInfo& GetInfo() const noexcept { return m_info; }
 
 		bool HasNonConstrainedBaseline() const noexcept { return m_profile == FF_PROFILE_H264_BASELINE && !GetConstraintSet1(); }
 
 	private:
+		void ParseSequenceFields(_Inout_ BitstreamReader& reader);
+		void ParseVuiParameters(_Inout_ BitstreamReader& reader);
+		static void SkipScalingList(_Inout_ BitstreamReader& reader, _In_ uint32_t scalingListSize);
+
 		uint8_t m_profile{ 0 };
 		uint8_t m_profileCompatibility{ 0 };
 		uint8_t m_level{ 0 };
 		uint32_t m_spsId{ 0 };
+		bool m_isComplete{ false };
+		SequenceParameterSetInfo m_info;
 	};
 
 	class AVCPictureParameterSet
@@ -18,6 +18,7 @@
 
 #include "pch.h"
 #include "HEVCSampleProvider.h"
+#include "BitstreamReader.h"
 
 using namespace winrt::Windows::Foundation;
 using namespace winrt::Windows::Media::MediaProperties;
@@ -26,21 +27,21 @@ using namespace std;
 
 namespace winrt::FFmpegInterop::implementation
 {
-	HEVCSampleProvider::HEVCSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader) :
-		NALUSampleProvider(formatContext, stream, reader)
+	HEVCSampleProvider::HEVCSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext) :
+		NALUSampleProvider(formatContext, stream, reader, move(bsfContext))
 	{
 		// Parse codec private data if present
-		if (m_stream->codecpar->extradata != nullptr && m_stream->codecpar->extradata_size > 0)
+		if (m_codecPar->extradata != nullptr && m_codecPar->extradata_size > 0)
 		{
 			// Check the HEVC bitstream flavor
-			if (m_stream->codecpar->extradata_size > 3 && (m_stream->codecpar->extradata[0] || m_stream->codecpar->extradata[1] || m_stream->codecpar->extradata[2] > 1))
+			if (m_codecPar->extradata_size > 3 && (m_codecPar->extradata[0] || m_codecPar->extradata[1] || m_codecPar->extradata[2] > 1))
 			{
 				// hvcC config format
 				FFMPEG_INTEROP_TRACE("Stream %d: HEVC codec private data", m_stream->index);
 
 				m_isBitstreamAnnexB = false;
 
-				HEVCConfigParser parser{ m_stream->codecpar->extradata, static_cast<uint32_t>(m_stream->codecpar->extradata_size) };
+				HEVCConfigParser parser{ m_codecPar->extradata, static_cast<uint32_t>(m_codecPar->extradata_size) };
 				m_naluLengthSize = parser.GetNaluLengthSize();
 				tie(m_codecPrivateNaluData, m_codecPrivateNaluLengths) = parser.GetNaluData();
 			}
@@ -49,12 +50,43 @@ namespace winrt::FFmpegInterop::implementation
 				// Annex B format
 				FFMPEG_INTEROP_TRACE("Stream %d: Annex B codec private data", m_stream->index);
 
-				AnnexBParser parser{ m_stream->codecpar->extradata, static_cast<uint32_t>(m_stream->codecpar->extradata_size) };
+				AnnexBParser parser{ m_codecPar->extradata, static_cast<uint32_t>(m_codecPar->extradata_size) };
 				tie(m_codecPrivateNaluData, m_codecPrivateNaluLengths) = parser.GetNaluData();
 			}
 		}
 	}
 
+	void HEVCSampleProvider::SetEncodingProperties(_Inout_ const IMediaEncodingProperties& encProp, _In_ bool setFormatUserData)
+	{
+		NALUSampleProvider::SetEncodingProperties(encProp, setFormatUserData);
+
+		// Parse the SPS to describe the decoder configuration
+		if (auto [spsData, spsSize] = FindCodecPrivateNalu(NALU_TYPE_HEVC_SPS); spsData != nullptr)
+		{
+			HEVCSequenceParameterSet sps{ spsData, spsSize };
+			m_maxSubLayers = sps.GetMaxSubLayers();
+
+			if (sps.IsComplete())
+			{
+				SetSequenceProperties(encProp, sps.GetInfo());
+			}
+		}
+	}
+
+	bool HEVCSampleProvider::IsDroppableNalu(_In_reads_(naluSize) const uint8_t* nalu, _In_ uint32_t naluSize) const noexcept
+	{
+		if (naluSize < 2 || m_maxSubLayers == 0)
+		{
+			return false;
+		}
+
+		// Sub-layer non-reference pictures (TRAIL_N, TSA_N, STSA_N, RADL_N, RASL_N, RSV_VCL_N10/12/14) can still be referenced by
+		// pictures in higher sub-layers, so only drop them from the highest sub-layer
+		const uint8_t naluType{ GetNaluType(nalu[0]) };
+		const uint8_t temporalId{ static_cast<uint8_t>((nalu[1] & 0x07) - 1) };
+		return naluType <= 14 && (naluType % 2) == 0 && temporalId == m_maxSubLayers - 1;
+	}
+
 	HEVCConfigParser::HEVCConfigParser(_In_reads_(dataSize) const uint8_t* data, _In_ uint32_t dataSize) :
 		m_data(data),
 		m_dataSize(dataSize)
@@ -115,4 +147,307 @@ namespace winrt::FFmpegInterop::implementation
 
 		return { naluData, naluLengths };
 	}
+
+	HEVCSequenceParameterSet::HEVCSequenceParameterSet(_In_reads_(dataSize) const uint8_t* data, _In_ uint32_t dataSize)
+	{
+		const vector<uint8_t> rbsp{ GetRbspData(data, dataSize) };
+		BitstreamReader reader{ rbsp.data(), static_cast<uint32_t>(rbsp.size()) };
+
+		reader.SkipN(16); // NALU header fields
+		reader.SkipN(4); // sps_video_parameter_set_id
+		m_maxSubLayers = static_cast<uint8_t>(reader.ReadN(3) + 1);
+		reader.SkipN(1); // sps_temporal_id_nesting_flag
+
+		// The remaining fields are only used to describe the decoder configuration. Don't fail if they can't be parsed.
+		try
+		{
+			ParseProfileTierLevel(reader);
+			ParseSequenceFields(reader);
+			m_isComplete = true;
+
+			// The VUI only adds the frame rate, so keep what we have if it's malformed
+			ParseVuiParameters(reader);
+		}
+		CATCH_LOG_MSG("Failed to parse SPS. SPS ID = %u", m_spsId);
+	}
+
+	void HEVCSequenceParameterSet::ParseProfileTierLevel(_Inout_ BitstreamReader& reader)
+	{
+		reader.SkipN(3); // general_profile_space, general_tier_flag
+		m_profile = static_cast<uint8_t>(reader.ReadN(5));
+		reader.SkipN(32); // general_profile_compatibility_flag[32]
+		reader.SkipN(48); // general source, constraint, and reserved flags
+		m_level = reader.Read8();
+
+		bool subLayerProfilePresent[8]{ };
+		bool subLayerLevelPresent[8]{ };
+		for (uint8_t i{ 0 }; i < m_maxSubLayers - 1; i++)
+		{
+			subLayerProfilePresent[i] = reader.Read1();
+			subLayerLevelPresent[i] = reader.Read1();
+		}
+
+		if (m_maxSubLayers > 1)
+		{
+			reader.SkipN(2 * (9 - m_maxSubLayers)); // reserved_zero_2bits
+		}
+
+		for (uint8_t i{ 0 }; i < m_maxSubLayers - 1; i++)
+		{
+			if (subLayerProfilePresent[i])
+			{
+				reader.SkipN(88); // sub_layer profile fields
+			}
+
+			if (subLayerLevelPresent[i])
+			{
+				reader.SkipN(8); // sub_layer_level_idc
+			}
+		}
+	}
+
+	void HEVCSequenceParameterSet::ParseSequenceFields(_Inout_ BitstreamReader& reader)
+	{
+		m_spsId = reader.ReadUExpGolomb();
+
+		m_info.chromaFormat = reader.ReadUExpGolomb();
+		THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, m_info.chromaFormat > 3);
+
+		bool separateColourPlane{ false };
+		if (m_info.chromaFormat == 3)
+		{
+			separateColourPlane = reader.Read1();
+		}
+
+		const uint32_t codedWidth{ reader.ReadUExpGolomb() };
+		const uint32_t codedHeight{ reader.ReadUExpGolomb() };
+
+		if (reader.Read1()) // conformance_window_flag
+		{
+			// Conformance window offsets are in units of chroma samples
+			uint32_t cropUnitX{ 1 };
+			uint32_t cropUnitY{ 1 };
+			if (!separateColourPlane && m_info.chromaFormat != 0)
+			{
+				cropUnitX = m_info.chromaFormat == 3 ? 1 : 2; // SubWidthC
+				cropUnitY = m_info.chromaFormat == 1 ? 2 : 1; // SubHeightC
+			}
+
+			m_info.cropLeft = reader.ReadUExpGolomb() * cropUnitX;
+			m_info.cropRight = reader.ReadUExpGolomb() * cropUnitX;
+			m_info.cropTop = reader.ReadUExpGolomb() * cropUnitY;
+			m_info.cropBottom = reader.ReadUExpGolomb() * cropUnitY;
+		}
+
+		THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, m_info.cropLeft + m_info.cropRight >= codedWidth);
+		THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, m_info.cropTop + m_info.cropBottom >= codedHeight);
+
+		m_info.codedWidth = codedWidth;
+		m_info.codedHeight = codedHeight;
+		m_info.width = codedWidth - m_info.cropLeft - m_info.cropRight;
+		m_info.height = codedHeight - m_info.cropTop - m_info.cropBottom;
+
+		reader.SkipExpGolomb(); // bit_depth_luma_minus8
+		reader.SkipExpGolomb(); // bit_depth_chroma_minus8
+		m_log2MaxPicOrderCntLsb = reader.ReadUExpGolomb() + 4;
+		THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, m_log2MaxPicOrderCntLsb > 16);
+
+		const bool subLayerOrderingInfoPresent{ reader.Read1() };
+		for (uint8_t i{ subLayerOrderingInfoPresent ? uint8_t{ 0 } : static_cast<uint8_t>(m_maxSubLayers - 1) }; i < m_maxSubLayers; i++)
+		{
+			reader.SkipExpGolomb(); // sps_max_dec_pic_buffering_minus1
+			reader.SkipExpGolomb(); // sps_max_num_reorder_pics
+			reader.SkipExpGolomb(); // sps_max_latency_increase_plus1
+		}
+	}
+
+	void HEVCSequenceParameterSet::ParseVuiParameters(_Inout_ BitstreamReader& reader)
+	{
+		// Skip the coding tool fields that precede the VUI
+		reader.SkipExpGolomb(); // log2_min_luma_coding_block_size_minus3
+		reader.SkipExpGolomb(); // log2_diff_max_min_luma_coding_block_size
+		reader.SkipExpGolomb(); // log2_min_luma_transform_block_size_minus2
+		reader.SkipExpGolomb(); // log2_diff_max_min_luma_transform_block_size
+		reader.SkipExpGolomb(); // max_transform_hierarchy_depth_inter
+		reader.SkipExpGolomb(); // max_transform_hierarchy_depth_intra
+
+		if (reader.Read1()) // scaling_list_enabled_flag
+		{
+			if (reader.Read1()) // sps_scaling_list_data_present_flag
+			{
+				SkipScalingListData(reader);
+			}
+		}
+
+		reader.SkipN(2); // amp_enabled_flag, sample_adaptive_offset_enabled_flag
+
+		if (reader.Read1()) // pcm_enabled_flag
+		{
+			reader.SkipN(8); // pcm_sample_bit_depth_luma_minus1, pcm_sample_bit_depth_chroma_minus1
+			reader.SkipExpGolomb(); // log2_min_pcm_luma_coding_block_size_minus3
+			reader.SkipExpGolomb(); // log2_diff_max_min_pcm_luma_coding_block_size
+			reader.SkipN(1); // pcm_loop_filter_disabled_flag
+		}
+
+		SkipShortTermRefPicSets(reader);
+
+		if (reader.Read1()) // long_term_ref_pics_present_flag
+		{
+			const uint32_t numLongTermRefPics{ reader.ReadUExpGolomb() };
+			THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, numLongTermRefPics > 32);
+
+			for (uint32_t i{ 0 }; i < numLongTermRefPics; i++)
+			{
+				reader.SkipN(m_log2MaxPicOrderCntLsb); // lt_ref_pic_poc_lsb_sps
+				reader.SkipN(1); // used_by_curr_pic_lt_sps_flag
+			}
+		}
+
+		reader.SkipN(2); // sps_temporal_mvp_enabled_flag, strong_intra_smoothing_enabled_flag
+
+		if (!reader.Read1()) // vui_parameters_present_flag
+		{
+			return;
+		}
+
+		if (reader.Read1()) // aspect_ratio_info_present_flag
+		{
+			constexpr uint8_t EXTENDED_SAR{ 255 };
+			if (reader.Read8() == EXTENDED_SAR) // aspect_ratio_idc
+			{
+				reader.SkipN(32); // sar_width, sar_height
+			}
+		}
+
+		if (reader.Read1()) // overscan_info_present_flag
+		{
+			reader.SkipN(1); // overscan_appropriate_flag
+		}
+
+		if (reader.Read1()) // video_signal_type_present_flag
+		{
+			reader.SkipN(4); // video_format, video_full_range_flag
+			if (reader.Read1()) // colour_description_present_flag
+			{
+				reader.SkipN(24); // colour_primaries, transfer_characteristics, matrix_coeffs
+			}
+		}
+
+		if (reader.Read1()) // chroma_loc_info_present_flag
+		{
+			reader.SkipExpGolomb(); // chroma_sample_loc_type_top_field
+			reader.SkipExpGolomb(); // chroma_sample_loc_type_bottom_field
+		}
+
+		reader.SkipN(3); // neutral_chroma_indication_flag, field_seq_flag, frame_field_info_present_flag
+
+		if (reader.Read1()) // default_display_window_flag
+		{
+			reader.SkipExpGolomb(); // def_disp_win_left_offset
+			reader.SkipExpGolomb(); // def_disp_win_right_offset
+			reader.SkipExpGolomb(); // def_disp_win_top_offset
+			reader.SkipExpGolomb(); // def_disp_win_bottom_offset
+		}
+
+		if (reader.Read1()) // vui_timing_info_present_flag
+		{
+			const uint32_t numUnitsInTick{ reader.Read32() };
+			const uint32_t timeScale{ reader.Read32() };
+
+			if (numUnitsInTick != 0 && timeScale != 0)
+			{
+				// Unlike H.264, each frame is one tick
+				int frameRateNum{ 0 };
+				int frameRateDen{ 0 };
+				av_reduce(&frameRateNum, &frameRateDen, timeScale, numUnitsInTick, numeric_limits<int>::max());
+
+				m_info.hasTimingInfo = true;
+				m_info.frameRateNumerator = static_cast<uint32_t>(frameRateNum);
+				m_info.frameRateDenominator = static_cast<uint32_t>(frameRateDen);
+			}
+		}
+
+		// Remaining fields left unparsed as they're unneeded at this time
+	}
+
+	void HEVCSequenceParameterSet::SkipScalingListData(_Inout_ BitstreamReader& reader)
+	{
+		for (uint32_t sizeId{ 0 }; sizeId < 4; sizeId++)
+		{
+			for (uint32_t matrixId{ 0 }; matrixId < 6; matrixId += (sizeId == 3) ? 3 : 1)
+			{
+				if (!reader.Read1()) // scaling_list_pred_mode_flag
+				{
+					reader.SkipExpGolomb(); // scaling_list_pred_matrix_id_delta
+				}
+				else
+				{
+					const uint32_t coefNum{ min(64u, 1u << (4 + (sizeId << 1))) };
+					if (sizeId > 1)
+					{
+						reader.SkipExpGolomb(); // scaling_list_dc_coef_minus8
+					}
+
+					for (uint32_t i{ 0 }; i < coefNum; i++)
+					{
+						reader.SkipExpGolomb(); // scaling_list_delta_coef
+					}
+				}
+			}
+		}
+	}
+
+	void HEVCSequenceParameterSet::SkipShortTermRefPicSets(_Inout_ BitstreamReader& reader)
+	{
+		constexpr uint32_t MAX_SHORT_TERM_REF_PIC_SETS{ 64 };
+		constexpr uint32_t MAX_DELTA_POCS{ 32 };
+
+		const uint32_t numShortTermRefPicSets{ reader.ReadUExpGolomb() };
+		THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, numShortTermRefPicSets > MAX_SHORT_TERM_REF_PIC_SETS);
+
+		// Predicted sets are coded relative to the previous set, so track how many delta POCs each set has
+		uint32_t prevNumDeltaPocs{ 0 };
+		for (uint32_t i{ 0 }; i < numShortTermRefPicSets; i++)
+		{
+			uint32_t numDeltaPocs{ 0 };
+
+			if (i != 0 && reader.Read1()) // inter_ref_pic_set_prediction_flag
+			{
+				reader.SkipN(1); // delta_rps_sign
+				reader.SkipExpGolomb(); // abs_delta_rps_minus1
+
+				for (uint32_t j{ 0 }; j <= prevNumDeltaPocs; j++)
+				{
+					bool useDelta{ true };
+					const bool usedByCurrPic{ reader.Read1() };
+					if (!usedByCurrPic)
+					{
+						useDelta = reader.Read1();
+					}
+
+					if (usedByCurrPic || useDelta)
+					{
+						numDeltaPocs++;
+					}
+				}
+			}
+			else
+			{
+				const uint32_t numNegativePics{ reader.ReadUExpGolomb() };
+				const uint32_t numPositivePics{ reader.ReadUExpGolomb() };
+				THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, numNegativePics > MAX_DELTA_POCS || numPositivePics > MAX_DELTA_POCS);
+
+				for (uint32_t j{ 0 }; j < numNegativePics + numPositivePics; j++)
+				{
+					reader.SkipExpGolomb(); // delta_poc_s0_minus1 / delta_poc_s1_minus1
+					reader.SkipN(1); // used_by_curr_pic_s0_flag / used_by_curr_pic_s1_flag
+				}
+
+				numDeltaPocs = numNegativePics + numPositivePics;
+			}
+
+			THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, numDeltaPocs > MAX_DELTA_POCS);
+			prevNumDeltaPocs = numDeltaPocs;
+		}
+	}
 }
@@ -22,6 +22,8 @@
 
 namespace winrt::FFmpegInterop::implementation
 {
+	class BitstreamReader;
+
 	constexpr uint8_t NALU_TYPE_HEVC_VPS{ 0x20 };
 	constexpr uint8_t NALU_TYPE_HEVC_SPS{ 0x21 };
 	constexpr uint8_t NALU_TYPE_HEVC_PPS{ 0x22 };
@@ -30,7 +32,17 @@ namespace winrt::FFmpegInterop::implementation
 		public NALUSampleProvider
 	{
 	public:
-		HEVCSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader);
+		HEVCSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext);
+
+		void SetEncodingProperties(_Inout_ const Windows::Media::MediaProperties::IMediaEncodingProperties& encProp, _In_ bool setFormatUserData) override;
+
+	protected:
+		uint8_t GetNaluType(_In_ uint8_t naluHeader) const noexcept override { return (naluHeader >> 1) & 0x3F; }
+		bool IsVclNaluType(_In_ uint8_t naluType) const noexcept override { return naluType <= 31; }
+		bool IsDroppableNalu(_In_reads_(naluSize) const uint8_t* nalu, _In_ uint32_t naluSize) const noexcept override;
+
+	private:
+		uint8_t m_maxSubLayers{ 0 }; // 0 if unknown
 	};
 
 	class HEVCConfigParser
@@ -47,4 +59,32 @@ namespace winrt::FFmpegInterop::implementation
 		const uint8_t* m_data{ nullptr };
 		const uint32_t m_dataSize{ 0 };
 	};
+
+	class HEVCSequenceParameterSet
+	{
+	public:
+		HEVCSequenceParameterSet(_In_reads_(dataSize) const uint8_t* data, _In_ uint32_t dataSize);
+
+		uint8_t GetMaxSubLayers() const noexcept { return m_maxSubLayers; }
+		uint8_t GetProfile() const noexcept { return m_profile; }
+		uint8_t GetLevel() const noexcept { return m_level; }
+		uint32_t GetSpsId() const noexcept { return m_spsId; }
+		bool IsComplete() const noexcept { return m_isComplete; }
+		const SequenceParameterSetInfo& GetInfo() const noexcept { return m_info; }
+
+	private:
+		void ParseProfileTierLevel(_Inout_ BitstreamReader& reader);
+		void ParseSequenceFields(_Inout_ BitstreamReader& reader);
+		void ParseVuiParameters(_Inout_ BitstreamReader& reader);
+		static void SkipScalingListData(_Inout_ BitstreamReader& reader);
+		static void SkipShortTermRefPicSets(_Inout_ BitstreamReader& reader);
+
+		uint8_t m_maxSubLayers{ 1 };
+		uint8_t m_profile{ 0 };
+		uint8_t m_level{ 0 };
+		uint32_t m_spsId{ 0 };
+		uint32_t m_log2MaxPicOrderCntLsb{ 0 };
+		bool m_isComplete{ false };
+		SequenceParameterSetInfo m_info;
+	};
 }
@@ -25,8 +25,8 @@ using namespace std;
 
 namespace winrt::FFmpegInterop::implementation
 {
-	MPEGSampleProvider::MPEGSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader) :
-		SampleProvider(formatContext, stream, reader)
+	MPEGSampleProvider::MPEGSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext) :
+		SampleProvider(formatContext, stream, reader, move(bsfContext))
 	{
 
 	}
@@ -35,7 +35,7 @@ namespace winrt::FFmpegInterop::implementation
 	{
 		SampleProvider::SetEncodingProperties(encProp, setFormatUserData);
 
-		const AVCodecParameters* codecPar{ m_stream->codecpar };
+		const AVCodecParameters* codecPar{ m_codecPar };
 
 		if (codecPar->extradata != nullptr && codecPar->extradata_size > 0)
 		{
@@ -23,6 +23,7 @@ using namespace winrt::Windows::Foundation;
 using namespace winrt::Windows::Media::MediaProperties;
 using namespace winrt::Windows::Storage::Streams;
 using namespace std;
+using namespace std::chrono;
 
 namespace winrt::FFmpegInterop::implementation
 {
@@ -78,8 +79,30 @@ namespace winrt::FFmpegInterop::implementation
 		return naluLength;
 	}
 
-	NALUSampleProvider::NALUSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader) :
-		SampleProvider(formatContext, stream, reader)
+	vector<uint8_t> GetRbspData(_In_reads_(dataSize) const uint8_t* data, _In_ uint32_t dataSize)
+	{
+		// Strip the emulation prevention bytes (0x000003 -> 0x0000) so the NALU payload can be parsed bit by bit
+		vector<uint8_t> rbsp;
+		rbsp.reserve(dataSize);
+
+		uint32_t zeroCount{ 0 };
+		for (uint32_t i{ 0 }; i < dataSize; i++)
+		{
+			if (zeroCount >= 2 && data[i] == 0x03)
+			{
+				zeroCount = 0;
+				continue;
+			}
+
+			zeroCount = (data[i] == 0x00) ? zeroCount + 1 : 0;
+			rbsp.push_back(data[i]);
+		}
+
+		return rbsp;
+	}
+
+	NALUSampleProvider::NALUSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext) :
+		SampleProvider(formatContext, stream, reader, move(bsfContext))
 	{
 
 	}
@@ -89,10 +112,10 @@ namespace winrt::FFmpegInterop::implementation
 		SampleProvider::SetEncodingProperties(encProp, setFormatUserData);
 
 		VideoEncodingProperties videoEncProp{ encProp.as<VideoEncodingProperties>() };
-		videoEncProp.ProfileId(m_stream->codecpar->profile);
+		videoEncProp.ProfileId(m_codecPar->profile);
 
 		MediaPropertySet videoProp{ videoEncProp.Properties() };
-		videoProp.Insert(MF_MT_MPEG2_LEVEL, PropertyValue::CreateUInt32(static_cast<uint32_t>(m_stream->codecpar->level)));
+		videoProp.Insert(MF_MT_MPEG2_LEVEL, PropertyValue::CreateUInt32(static_cast<uint32_t>(m_codecPar->level)));
 		videoProp.Insert(MF_NALU_LENGTH_SET, PropertyValue::CreateUInt32(static_cast<uint32_t>(true)));
 
 		if (!m_codecPrivateNaluData.empty())
@@ -101,11 +124,99 @@ namespace winrt::FFmpegInterop::implementation
 		}
 	}
 
+	void NALUSampleProvider::NotifySampleLag(_In_ int64_t hnsSampleLag) noexcept
+	{
+		m_sampleLag = hnsSampleLag;
+		m_sampleLagTime = steady_clock::now();
+	}
+
+	void NALUSampleProvider::Flush() noexcept
+	{
+		SampleProvider::Flush();
+
+		// Lateness measured before the flush doesn't apply to the new position
+		ResetLatenessTracking();
+		m_sampleLagTime = { };
+	}
+
+	tuple<const uint8_t*, uint32_t> NALUSampleProvider::FindCodecPrivateNalu(_In_ uint8_t naluType) const noexcept
+	{
+		// The codec private NALU data is always stored in Annex B format
+		uint32_t pos{ 0 };
+		for (uint32_t naluLength : m_codecPrivateNaluLengths)
+		{
+			if (naluLength > sizeof(NALU_START_CODE) && pos + naluLength <= m_codecPrivateNaluData.size())
+			{
+				const uint8_t* nalu{ m_codecPrivateNaluData.data() + pos + sizeof(NALU_START_CODE) };
+				if (GetNaluType(nalu[0]) == naluType)
+				{
+					return { nalu, naluLength - static_cast<uint32_t>(sizeof(NALU_START_CODE)) };
+				}
+			}
+
+			pos += naluLength;
+		}
+
+		return { nullptr, 0 };
+	}
+
+	void NALUSampleProvider::SetSequenceProperties(_Inout_ const IMediaEncodingProperties& encProp, _In_ const SequenceParameterSetInfo& spsInfo)
+	{
+		FFMPEG_INTEROP_TRACE("Stream %d: SPS Coded Size = %ux%u, Width = %u, Height = %u",
+			m_stream->index, spsInfo.codedWidth, spsInfo.codedHeight, spsInfo.width, spsInfo.height);
+
+		VideoEncodingProperties videoEncProp{ encProp.as<VideoEncodingProperties>() };
+		MediaPropertySet videoProp{ videoEncProp.Properties() };
+
+		// A cropped frame is sized to the coded picture with the cropping window as its aperture. Otherwise fill in the frame size and rate if the container didn't provide them.
+		const bool isCropped{ spsInfo.cropLeft != 0 || spsInfo.cropRight != 0 || spsInfo.cropTop != 0 || spsInfo.cropBottom != 0 };
+		if (isCropped)
+		{
+			// FFmpeg reports the cropped size, but the aperture must lie within the decoded frame
+			videoEncProp.Width(spsInfo.codedWidth);
+			videoEncProp.Height(spsInfo.codedHeight);
+		}
+		else if (videoEncProp.Width() == 0 || videoEncProp.Height() == 0)
+		{
+			videoEncProp.Width(spsInfo.width);
+			videoEncProp.Height(spsInfo.height);
+		}
+
+		if (spsInfo.hasTimingInfo && (m_stream->avg_frame_rate.num == 0 || m_stream->avg_frame_rate.den == 0))
+		{
+			MediaRatio frameRate{ videoEncProp.FrameRate() };
+			frameRate.Numerator(spsInfo.frameRateNumerator);
+			frameRate.Denominator(spsInfo.frameRateDenominator);
+		}
+
+		// Describe the cropping window so the decoder output can be displayed without an extra copy
+		if (isCropped)
+		{
+			MFVideoArea displayAperture{ };
+			displayAperture.OffsetX.value = static_cast<short>(spsInfo.cropLeft);
+			displayAperture.OffsetY.value = static_cast<short>(spsInfo.cropTop);
+			displayAperture.Area.cx = static_cast<LONG>(spsInfo.width);
+			displayAperture.Area.cy = static_cast<LONG>(spsInfo.height);
+
+			const uint8_t* displayApertureBuf{ reinterpret_cast<const uint8_t*>(&displayAperture) };
+			videoProp.Insert(MF_MT_MINIMUM_DISPLAY_APERTURE, PropertyValue::CreateUInt8Array({ displayApertureBuf, displayApertureBuf + sizeof(displayAperture) }));
+		}
+	}
+
 	tuple<IBuffer, int64_t, int64_t, vector<pair<GUID, Windows::Foundation::IInspectable>>, vector<pair<GUID, Windows::Foundation::IInspectable>>> NALUSampleProvider::GetSampleData()
 	{
 		// Get the next sample
 		AVPacket_ptr packet{ GetPacket() };
 
+		// If we're behind, drop non-reference pictures until the next reference picture so the decoder doesn't decode frames
+		// that will only be dropped by the renderer
+		UpdateCatchUpState(GetLateness());
+		while (m_isCatchingUp && IsDroppablePacket(packet.get()))
+		{
+			m_droppedPacketCount++;
+			packet = GetPacket();
+		}
+
 		const int64_t pts{ packet->pts };
 		const int64_t dur{ packet->duration };
 		const bool isKeyFrame{ (packet->flags & AV_PKT_FLAG_KEY) != 0 };
@@ -227,6 +338,79 @@ namespace winrt::FFmpegInterop::implementation
 		}
 	}
 
+	bool NALUSampleProvider::IsDroppablePacket(_In_ const AVPacket* packet) const
+	{
+		if ((packet->flags & AV_PKT_FLAG_KEY) != 0)
+		{
+			return false;
+		}
+
+		// The packet can only be dropped if it has picture data and none of it is used as a reference
+		bool hasVclNalu{ false };
+
+		const uint8_t naluPrefixLength{ m_isBitstreamAnnexB ? sizeof(NALU_START_CODE) : m_naluLengthSize };
+		for (uint32_t i{ 0 }; i + naluPrefixLength <= static_cast<uint32_t>(packet->size);)
+		{
+			uint32_t naluLength{ 0 };
+			if (m_isBitstreamAnnexB)
+			{
+				naluLength = GetAnnexBNaluLength(packet->data + i, packet->size - i);
+			}
+			else
+			{
+				naluLength = GetAVCNaluLength(packet->data + i, packet->size - i, m_naluLengthSize);
+			}
+
+			const uint8_t* nalu{ packet->data + i + naluPrefixLength };
+			if (naluLength > 0 && IsVclNaluType(GetNaluType(nalu[0])))
+			{
+				if (!IsDroppableNalu(nalu, naluLength))
+				{
+					return false;
+				}
+
+				hasVclNalu = true;
+			}
+
+			i += naluPrefixLength + naluLength;
+		}
+
+		return hasVclNalu;
+	}
+
+	int64_t NALUSampleProvider::GetLateness() const noexcept
+	{
+		// Only the renderer knows the playback rate, as its lag is measured against the presentation clock. The request cadence
+		// can't tell slow motion apart from falling behind, so without a recent measurement assume we're on time.
+		if (steady_clock::now() - m_sampleLagTime < SAMPLE_LAG_LIFETIME)
+		{
+			return m_sampleLag;
+		}
+
+		return 0;
+	}
+
+	void NALUSampleProvider::UpdateCatchUpState(_In_ int64_t hnsLateness) noexcept
+	{
+		if (!m_isCatchingUp && hnsLateness > CATCH_UP_START_LATENESS)
+		{
+			FFMPEG_INTEROP_TRACE("Stream %d: Late by %I64d hns. Dropping non-reference pictures.", m_stream->index, hnsLateness);
+			m_isCatchingUp = true;
+		}
+		else if (m_isCatchingUp && hnsLateness < CATCH_UP_STOP_LATENESS)
+		{
+			FFMPEG_INTEROP_TRACE("Stream %d: Caught up. Dropped %u packets.", m_stream->index, m_droppedPacketCount);
+			m_isCatchingUp = false;
+			m_droppedPacketCount = 0;
+		}
+	}
+
+	void NALUSampleProvider::ResetLatenessTracking() noexcept
+	{
+		m_isCatchingUp = false;
+		m_droppedPacketCount = 0;
+	}
+
 	AnnexBParser::AnnexBParser(_In_reads_(dataSize) const uint8_t* data, _In_ uint32_t dataSize) :
 		m_data(data),
 		m_dataSize(dataSize)
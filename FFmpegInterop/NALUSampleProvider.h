@@ -27,18 +27,44 @@ namespace winrt::FFmpegInterop::implementation
 
 	uint32_t GetAnnexBNaluLength(_In_reads_(dataSize) const uint8_t* data, _In_ uint32_t dataSize);
 	uint32_t GetAVCNaluLength(_In_reads_(dataSize) const uint8_t* data, _In_ uint32_t dataSize, _In_ uint8_t naluLengthSize);
+	std::vector<uint8_t> GetRbspData(_In_reads_(dataSize) const uint8_t* data, _In_ uint32_t dataSize);
+
+	// Decoder configuration parsed from an H.264/HEVC sequence parameter set
+	struct SequenceParameterSetInfo
+	{
+		uint32_t codedWidth{ 0 }; // Decoded width in luma samples
+		uint32_t codedHeight{ 0 }; // Decoded height in luma samples
+		uint32_t width{ 0 }; // Cropped width in luma samples
+		uint32_t height{ 0 }; // Cropped height in luma samples
+		uint32_t cropLeft{ 0 };
+		uint32_t cropRight{ 0 };
+		uint32_t cropTop{ 0 };
+		uint32_t cropBottom{ 0 };
+		uint32_t chromaFormat{ 1 }; // 0 = monochrome, 1 = 4:2:0, 2 = 4:2:2, 3 = 4:4:4. Determines the units of the crop offsets.
+		bool hasTimingInfo{ false };
+		uint32_t frameRateNumerator{ 0 };
+		uint32_t frameRateDenominator{ 0 };
+	};
 
 	class NALUSampleProvider :
 		public SampleProvider
 	{
 	public:
-		NALUSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader);
+		NALUSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext);
 
 		void SetEncodingProperties(_Inout_ const Windows::Media::MediaProperties::IMediaEncodingProperties& encProp, _In_ bool setFormatUserData) override;
+		void NotifySampleLag(_In_ int64_t hnsSampleLag) noexcept override;
 
 	protected:
+		void Flush() noexcept override;
 		std::tuple<Windows::Storage::Streams::IBuffer, int64_t, int64_t, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>> GetSampleData() override;
 
+		virtual uint8_t GetNaluType(_In_ uint8_t naluHeader) const noexcept = 0;
+		virtual bool IsVclNaluType(_In_ uint8_t naluType) const noexcept = 0;
+		virtual bool IsDroppableNalu(_In_reads_(naluSize) const uint8_t* nalu, _In_ uint32_t naluSize) const noexcept = 0;
+		std::tuple<const uint8_t*, uint32_t> FindCodecPrivateNalu(_In_ uint8_t naluType) const noexcept;
+		void SetSequenceProperties(_Inout_ const Windows::Media::MediaProperties::IMediaEncodingProperties& encProp, _In_ const SequenceParameterSetInfo& spsInfo);
+
 		bool m_isBitstreamAnnexB{ true };
 		uint8_t m_naluLengthSize{ 0 }; // Only valid when bitstream is *not* Annex B
 		std::vector<uint8_t> m_codecPrivateNaluData;
@@ -47,7 +73,21 @@ namespace winrt::FFmpegInterop::implementation
 	private:
 		static constexpr size_t MAX_NALU_NUM_SUPPORTED{ 512 };
 
+		// Lateness thresholds for dropping non-reference pictures. Catch-up ends at a lower threshold to avoid toggling every sample.
+		static constexpr int64_t CATCH_UP_START_LATENESS{ 100 * HNS_PER_SEC / 1000 }; // hns
+		static constexpr int64_t CATCH_UP_STOP_LATENESS{ 20 * HNS_PER_SEC / 1000 }; // hns
+		static constexpr std::chrono::milliseconds SAMPLE_LAG_LIFETIME{ 1000 };
+
 		std::tuple<Windows::Storage::Streams::IBuffer, std::vector<uint32_t>> TransformSample(_Inout_ AVPacket_ptr packet, _In_ bool isKeyFrame);
+		bool IsDroppablePacket(_In_ const AVPacket* packet) const;
+		int64_t GetLateness() const noexcept;
+		void UpdateCatchUpState(_In_ int64_t hnsLateness) noexcept;
+		void ResetLatenessTracking() noexcept;
+
+		bool m_isCatchingUp{ false };
+		uint32_t m_droppedPacketCount{ 0 };
+		int64_t m_sampleLag{ 0 }; // hns
+		std::chrono::steady_clock::time_point m_sampleLagTime;
 	};
 
 	class AnnexBParser
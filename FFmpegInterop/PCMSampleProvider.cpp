@@ -0,0 +1,214 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "PCMSampleProvider.h"
+#include "AudioConversion.h"
+#include "FFmpegInteropMSSConfig.h"
+
+using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Media::Core;
+using namespace winrt::Windows::Media::MediaProperties;
+using namespace winrt::Windows::Storage::Streams;
+using namespace std;
+
+namespace winrt::FFmpegInterop::implementation
+{
+	PCMSampleProvider::PCMSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext, _In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config) :
+		SampleProvider(formatContext, stream, reader, move(bsfContext)),
+		m_batcher(stream->index, FFmpegInteropMSSConfig::GetAudioSampleDurationRange(config))
+	{
+		switch (m_codecPar->codec_id)
+		{
+		case AV_CODEC_ID_PCM_U8:
+			m_inputBytesPerSample = 1;
+			break;
+
+		case AV_CODEC_ID_PCM_S16LE:
+			m_inputBytesPerSample = 2;
+			break;
+
+		case AV_CODEC_ID_PCM_S16BE:
+			m_inputBytesPerSample = 2;
+			m_conversion = Conversion::ByteSwap16;
+			break;
+
+		case AV_CODEC_ID_PCM_S24LE:
+			m_inputBytesPerSample = 3;
+			break;
+
+		case AV_CODEC_ID_PCM_S24BE:
+			m_inputBytesPerSample = 3;
+			m_conversion = Conversion::ByteSwap24;
+			break;
+
+		case AV_CODEC_ID_PCM_S32LE:
+		case AV_CODEC_ID_PCM_F32LE:
+			m_inputBytesPerSample = 4;
+			break;
+
+		case AV_CODEC_ID_PCM_S32BE:
+		case AV_CODEC_ID_PCM_F32BE:
+			m_inputBytesPerSample = 4;
+			m_conversion = Conversion::ByteSwap32;
+			break;
+
+		case AV_CODEC_ID_PCM_F64LE:
+			m_inputBytesPerSample = 8;
+			m_conversion = Conversion::F64ToF32;
+			break;
+
+		case AV_CODEC_ID_PCM_F64BE:
+			m_inputBytesPerSample = 8;
+			m_conversion = Conversion::F64BEToF32;
+			break;
+
+		default:
+			WINRT_ASSERT(false);
+			THROW_HR(MF_E_INVALIDMEDIATYPE);
+		}
+
+		m_outputBytesPerSample = (m_conversion == Conversion::F64ToF32 || m_conversion == Conversion::F64BEToF32) ? sizeof(float) : m_inputBytesPerSample;
+
+		THROW_HR_IF(MF_E_INVALIDMEDIATYPE, m_codecPar->ch_layout.nb_channels <= 0 || m_codecPar->sample_rate <= 0);
+		m_channels = static_cast<uint32_t>(m_codecPar->ch_layout.nb_channels);
+		m_sampleRate = m_codecPar->sample_rate;
+	}
+
+	void PCMSampleProvider::SetEncodingProperties(_Inout_ const IMediaEncodingProperties& encProp, _In_ bool setFormatUserData)
+	{
+		SampleProvider::SetEncodingProperties(encProp, setFormatUserData);
+
+		// Describe the output format, which may differ from the coded format
+		IAudioEncodingProperties audioEncProp{ encProp.as<IAudioEncodingProperties>() };
+		const uint32_t blockAlign{ m_outputBytesPerSample * m_channels };
+		audioEncProp.BitsPerSample(m_outputBytesPerSample * BITS_PER_BYTE);
+		audioEncProp.Bitrate(blockAlign * m_sampleRate * BITS_PER_BYTE);
+
+		MediaPropertySet properties{ audioEncProp.Properties() };
+		properties.Insert(MF_MT_AUDIO_BLOCK_ALIGNMENT, PropertyValue::CreateUInt32(blockAlign));
+		properties.Insert(MF_MT_AUDIO_AVG_BYTES_PER_SECOND, PropertyValue::CreateUInt32(blockAlign * m_sampleRate));
+	}
+
+	void PCMSampleProvider::GetSample(_Inout_ const MediaStreamSourceSampleRequest& request)
+	{
+		m_batcher.OnSampleRequested();
+		SampleProvider::GetSample(request);
+	}
+
+	void PCMSampleProvider::Flush() noexcept
+	{
+		SampleProvider::Flush();
+		m_batcher.Reset();
+	}
+
+	tuple<IBuffer, int64_t, int64_t, vector<pair<GUID, Windows::Foundation::IInspectable>>, vector<pair<GUID, Windows::Foundation::IInspectable>>> PCMSampleProvider::GetSampleData()
+	{
+		const size_t inputFrameSize{ static_cast<size_t>(m_inputBytesPerSample) * m_channels };
+		const size_t targetFrameCount{ static_cast<size_t>(av_rescale(m_batcher.GetTargetDuration(), m_sampleRate, HNS_PER_SEC)) };
+
+		AVPacket_ptr packet{ GetPacket() };
+		const int64_t pts{ packet->pts };
+		size_t frameCount{ static_cast<size_t>(packet->size) / inputFrameSize };
+
+		// Containers often use very small PCM packets. Batch them up to the target duration so each one doesn't become an MF sample.
+		vector<AVPacket_ptr> packets;
+		packets.push_back(move(packet));
+
+		while (frameCount < targetFrameCount)
+		{
+			AVPacket_ptr nextPacket{ TryGetPacket() };
+			if (nextPacket == nullptr)
+			{
+				break;
+			}
+
+			// Don't hide timestamp gaps inside a sample
+			if (pts != AV_NOPTS_VALUE && nextPacket->pts != AV_NOPTS_VALUE)
+			{
+				const int64_t expectedPts{ pts + av_rescale_q(static_cast<int64_t>(frameCount), AVRational{ 1, m_sampleRate }, m_stream->time_base) };
+				if (llabs(nextPacket->pts - expectedPts) > 1)
+				{
+					ReturnPacket(move(nextPacket));
+					break;
+				}
+			}
+
+			frameCount += static_cast<size_t>(nextPacket->size) / inputFrameSize;
+			packets.push_back(move(nextPacket));
+		}
+
+		const int64_t dur{ av_rescale_q(static_cast<int64_t>(frameCount), AVRational{ 1, m_sampleRate }, m_stream->time_base) };
+
+		vector<pair<GUID, Windows::Foundation::IInspectable>> properties;
+		properties.emplace_back(MFSampleExtension_CleanPoint, PropertyValue::CreateUInt32(true));
+
+		if (packets.size() == 1 && m_conversion == Conversion::None)
+		{
+			// Nothing to batch or convert so pass the packet through without a copy
+			return { make<FFmpegInteropBuffer>(move(packets.front())), pts, dur, move(properties), { } };
+		}
+
+		// Convert straight into the output buffer
+		const size_t outputSize{ frameCount * m_outputBytesPerSample * m_channels };
+		THROW_HR_IF(MF_E_INVALID_FILE_FORMAT, outputSize > numeric_limits<uint32_t>::max());
+
+		AVBlob_ptr outputBuf{ av_malloc(outputSize) };
+		THROW_IF_NULL_ALLOC(outputBuf);
+
+		uint8_t* dst{ static_cast<uint8_t*>(outputBuf.get()) };
+		for (const AVPacket_ptr& batchPacket : packets)
+		{
+			const size_t sampleCount{ static_cast<size_t>(batchPacket->size) / inputFrameSize * m_channels };
+			ConvertSamples(dst, batchPacket->data, sampleCount);
+			dst += sampleCount * m_outputBytesPerSample;
+		}
+
+		return { make<FFmpegInteropBuffer>(move(outputBuf), static_cast<uint32_t>(outputSize)), pts, dur, move(properties), { } };
+	}
+
+	void PCMSampleProvider::ConvertSamples(_Out_ uint8_t* dst, _In_ const uint8_t* src, _In_ size_t sampleCount) const noexcept
+	{
+		switch (m_conversion)
+		{
+		case Conversion::None:
+			memcpy(dst, src, sampleCount * m_inputBytesPerSample);
+			break;
+
+		case Conversion::ByteSwap16:
+			ByteSwap16(dst, src, sampleCount);
+			break;
+
+		case Conversion::ByteSwap24:
+			ByteSwap24(dst, src, sampleCount);
+			break;
+
+		case Conversion::ByteSwap32:
+			ByteSwap32(dst, src, sampleCount);
+			break;
+
+		case Conversion::F64ToF32:
+			ConvertF64ToF32(reinterpret_cast<float*>(dst), src, sampleCount);
+			break;
+
+		case Conversion::F64BEToF32:
+			ConvertF64BEToF32(reinterpret_cast<float*>(dst), src, sampleCount);
+			break;
+		}
+	}
+}
@@ -0,0 +1,59 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+#include "SampleProvider.h"
+#include "AudioSampleBatcher.h"
+
+namespace winrt::FFmpegInterop::implementation
+{
+	class PCMSampleProvider :
+		public SampleProvider
+	{
+	public:
+		PCMSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext, _In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config);
+
+		void SetEncodingProperties(_Inout_ const Windows::Media::MediaProperties::IMediaEncodingProperties& encProp, _In_ bool setFormatUserData) override;
+		void GetSample(_Inout_ const Windows::Media::Core::MediaStreamSourceSampleRequest& request) override;
+
+	protected:
+		void Flush() noexcept override;
+		std::tuple<Windows::Storage::Streams::IBuffer, int64_t, int64_t, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>> GetSampleData() override;
+
+	private:
+		enum class Conversion
+		{
+			None,
+			ByteSwap16,
+			ByteSwap24,
+			ByteSwap32,
+			F64ToF32,
+			F64BEToF32
+		};
+
+		void ConvertSamples(_Out_ uint8_t* dst, _In_ const uint8_t* src, _In_ size_t sampleCount) const noexcept;
+
+		Conversion m_conversion{ Conversion::None };
+		uint32_t m_inputBytesPerSample{ 0 };
+		uint32_t m_outputBytesPerSample{ 0 };
+		uint32_t m_channels{ 0 };
+		int m_sampleRate{ 0 };
+		AudioSampleBatcher m_batcher;
+	};
+}
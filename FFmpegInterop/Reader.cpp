@@ -33,6 +33,8 @@ namespace winrt::FFmpegInterop::implementation
 
 	void Reader::ReadPacket()
 	{
+		lock_guard<recursive_mutex> lock{ m_lock };
+
 		AVPacket_ptr packet{ av_packet_alloc() };
 		THROW_IF_NULL_ALLOC(packet);
 
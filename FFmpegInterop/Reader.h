@@ -29,7 +29,11 @@ namespace winrt::FFmpegInterop::implementation
 
 		void ReadPacket();
 
+		// Guards the demuxer and the sample providers' packet queues, which decode-ahead threads access concurrently with the MSS
+		std::unique_lock<std::recursive_mutex> Lock() { return std::unique_lock<std::recursive_mutex>{ m_lock }; }
+
 	private:
+		std::recursive_mutex m_lock;
 		AVFormatContext* m_formatContext{ nullptr };
 		const std::map<int, SampleProvider*>& m_streamIdMap;
 	};
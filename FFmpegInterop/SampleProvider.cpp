@@ -28,9 +28,11 @@ using namespace std;
 
 namespace winrt::FFmpegInterop::implementation
 {
-	SampleProvider::SampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader) :
+	SampleProvider::SampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext) :
 		m_stream(stream),
-		m_reader(reader)
+		m_codecPar(bsfContext != nullptr ? bsfContext->par_out : stream->codecpar),
+		m_reader(reader),
+		m_bsfContext(move(bsfContext))
 	{
 		if (formatContext->start_time != AV_NOPTS_VALUE)
 		{
@@ -41,7 +43,7 @@ namespace winrt::FFmpegInterop::implementation
 
 	void SampleProvider::SetEncodingProperties(_Inout_ const IMediaEncodingProperties& encProp, _In_ bool setFormatUserData)
 	{
-		const AVCodecParameters* codecPar{ m_stream->codecpar };
+		const AVCodecParameters* codecPar{ m_codecPar };
 
 		switch (codecPar->codec_type)
 		{
@@ -230,7 +232,7 @@ namespace winrt::FFmpegInterop::implementation
 				properties.Insert(MF_MT_VIDEO_NOMINAL_RANGE, PropertyValue::CreateUInt32(nominalRange));
 			}
 
-			const AVPacketSideData* sideData{ av_packet_side_data_get(m_stream->codecpar->coded_side_data, m_stream->codecpar->nb_coded_side_data, AV_PKT_DATA_CONTENT_LIGHT_LEVEL) };
+			const AVPacketSideData* sideData{ av_packet_side_data_get(m_codecPar->coded_side_data, m_codecPar->nb_coded_side_data, AV_PKT_DATA_CONTENT_LIGHT_LEVEL) };
 			if (sideData != nullptr)
 			{
 				WINRT_ASSERT(sideData->size == sizeof(AVContentLightMetadata));
@@ -240,7 +242,7 @@ namespace winrt::FFmpegInterop::implementation
 				properties.Insert(MF_MT_MAX_FRAME_AVERAGE_LUMINANCE_LEVEL, PropertyValue::CreateUInt32(contentLightMetadata->MaxFALL));
 			}
 
-			sideData = av_packet_side_data_get(m_stream->codecpar->coded_side_data, m_stream->codecpar->nb_coded_side_data, AV_PKT_DATA_MASTERING_DISPLAY_METADATA);
+			sideData = av_packet_side_data_get(m_codecPar->coded_side_data, m_codecPar->nb_coded_side_data, AV_PKT_DATA_MASTERING_DISPLAY_METADATA);
 			if (sideData != nullptr)
 			{
 				WINRT_ASSERT(sideData->size == sizeof(AVMasteringDisplayMetadata));
@@ -301,6 +303,8 @@ namespace winrt::FFmpegInterop::implementation
 	{
 		FFMPEG_INTEROP_TRACE("Stream %d: Selected", m_stream->index);
 
+		auto lock{ m_reader.Lock() };
+
 		WINRT_ASSERT(!m_isSelected);
 		m_isSelected = true;
 		m_stream->discard = AVDISCARD_DEFAULT;
@@ -310,9 +314,14 @@ namespace winrt::FFmpegInterop::implementation
 	{
 		FFMPEG_INTEROP_TRACE("Stream %d: Deselected", m_stream->index);
 
-		WINRT_ASSERT(m_isSelected);
-		m_isSelected = false;
-		m_stream->discard = AVDISCARD_ALL;
+		{
+			auto lock{ m_reader.Lock() };
+
+			WINRT_ASSERT(m_isSelected);
+			m_isSelected = false;
+			m_stream->discard = AVDISCARD_ALL;
+		}
+
 		Flush();
 	}
 
@@ -325,6 +334,15 @@ namespace winrt::FFmpegInterop::implementation
 
 	void SampleProvider::NotifyEOF() noexcept
 	{
+		auto lock{ m_reader.Lock() };
+
+		// Flush any packets buffered by the bitstream filter
+		try
+		{
+			DrainBitstreamFilter();
+		}
+		CATCH_LOG();
+
 		// We've reached EOF so no more packets will be read.
 		// If there's no packets in the queue this stream is now EOS.
 		if (!m_isEOS && m_packetQueue.empty())
@@ -340,40 +358,121 @@ namespace winrt::FFmpegInterop::implementation
 
 	void SampleProvider::Flush() noexcept
 	{
+		auto lock{ m_reader.Lock() };
+
 		m_packetQueue.clear();
 		m_isDiscontinuous = true;
+
+		if (m_bsfContext != nullptr)
+		{
+			av_bsf_flush(m_bsfContext.get());
+			m_isBitstreamFilterDrained = false;
+		}
 	}
 
 	void SampleProvider::QueuePacket(_In_ AVPacket_ptr packet)
 	{
 		if (m_isSelected)
 		{
-			m_packetQueue.push_back(move(packet));
+			if (m_bsfContext != nullptr)
+			{
+				// The filter takes ownership of the packet's buffer reference, so it's only copied if a filter rewrites the data
+				const int result{ av_bsf_send_packet(m_bsfContext.get(), packet.get()) };
+				if (result < 0)
+				{
+					// This runs while reading packets for any stream, so a packet the filter rejects is dropped instead of failing the read
+					LOG_HR_MSG(averror_to_hresult(result), "Stream %d: Bitstream filter rejected a packet", m_stream->index);
+					return;
+				}
+
+				ReceiveFilteredPackets();
+			}
+			else
+			{
+				m_packetQueue.push_back(move(packet));
+			}
 		}
 	}
 
-	void SampleProvider::GetSample(_Inout_ const MediaStreamSourceSampleRequest& request)
+	AVPacket_ptr SampleProvider::TryGetPacket()
 	{
-		FFMPEG_INTEROP_TRACE("Stream %d: Sample requested", m_stream->index);
+		// Returns null at EOF instead of throwing so callers can finish a partially filled sample
+		try
+		{
+			return GetPacket();
+		}
+		catch (...)
+		{
+			if (to_hresult() != MF_E_END_OF_STREAM)
+			{
+				throw;
+			}
 
-		// Make sure this stream is selected
-		THROW_HR_IF(MF_E_INVALIDREQUEST, !m_isSelected);
+			return nullptr;
+		}
+	}
 
-		// Get the sample data, timestamp, duration, and properties
-		auto [buf, pts, dur, properties, formatChanges] = GetSampleData();
+	void SampleProvider::ReturnPacket(_In_ AVPacket_ptr packet)
+	{
+		auto lock{ m_reader.Lock() };
 
-		// Make sure the PTS is set
-		if (pts == AV_NOPTS_VALUE)
+		m_packetQueue.push_front(move(packet));
+	}
+
+	bool SampleProvider::HasPacket()
+	{
+		auto lock{ m_reader.Lock() };
+
+		return !m_packetQueue.empty();
+	}
+
+	void SampleProvider::ReceiveFilteredPackets()
+	{
+		while (true)
 		{
-			pts = m_nextSamplePts;
+			AVPacket_ptr packet{ av_packet_alloc() };
+			THROW_IF_NULL_ALLOC(packet);
+
+			const int result{ av_bsf_receive_packet(m_bsfContext.get(), packet.get()) };
+			if (result == AVERROR(EAGAIN) || result == AVERROR_EOF)
+			{
+				break;
+			}
+			else if (result < 0)
+			{
+				// Most filters process packets here rather than when they're sent. Drop the packet the same way.
+				LOG_HR_MSG(averror_to_hresult(result), "Stream %d: Bitstream filter failed to process a packet", m_stream->index);
+				break;
+			}
+
+			av_packet_rescale_ts(packet.get(), m_bsfContext->time_base_out, m_stream->time_base);
+			m_packetQueue.push_back(move(packet));
 		}
+	}
 
-		// Calculate the PTS for the next sample
-		m_nextSamplePts = pts + dur;
+	bool SampleProvider::DrainBitstreamFilter()
+	{
+		if (m_bsfContext == nullptr || m_isBitstreamFilterDrained || !m_isSelected)
+		{
+			return false;
+		}
 
-		// Convert time base from FFmpeg to MF
-		pts = ConvertFromAVTime(pts - m_startOffset, m_stream->time_base, HNS_PER_SEC);
-		dur = ConvertFromAVTime(dur, m_stream->time_base, HNS_PER_SEC);
+		FFMPEG_INTEROP_TRACE("Stream %d: Draining bitstream filter", m_stream->index);
+
+		m_isBitstreamFilterDrained = true;
+		THROW_HR_IF_FFMPEG_FAILED(av_bsf_send_packet(m_bsfContext.get(), nullptr));
+
+		const size_t queueSize{ m_packetQueue.size() };
+		ReceiveFilteredPackets();
+
+		return m_packetQueue.size() > queueSize;
+	}
+
+	void SampleProvider::GetSample(_Inout_ const MediaStreamSourceSampleRequest& request)
+	{
+		FFMPEG_INTEROP_TRACE("Stream %d: Sample requested", m_stream->index);
+
+		auto [buf, pts, dur, properties, formatChanges] = ReadSample();
 
 		// Create the sample
 		MediaStreamSample sample{ MediaStreamSample::CreateFromBuffer(buf, static_cast<TimeSpan>(pts)) };
@@ -399,7 +498,7 @@ namespace winrt::FFmpegInterop::implementation
 			IMediaStreamDescriptor streamDescriptor{ request.StreamDescriptor() };
 			IMediaEncodingProperties encProp{ nullptr };
 
-			switch (m_stream->codecpar->codec_type)
+			switch (m_codecPar->codec_type)
 			{
 			case AVMEDIA_TYPE_AUDIO:
 				encProp = streamDescriptor.as<IAudioStreamDescriptor>().EncodingProperties();
@@ -431,6 +530,30 @@ namespace winrt::FFmpegInterop::implementation
 			m_stream->index, sample.Timestamp().count(), sample.Duration().count());
 	}
 
+	tuple<IBuffer, int64_t, int64_t, vector<pair<GUID, Windows::Foundation::IInspectable>>, vector<pair<GUID, Windows::Foundation::IInspectable>>> SampleProvider::ReadSample()
+	{
+		// Make sure this stream is selected
+		THROW_HR_IF(MF_E_INVALIDREQUEST, !m_isSelected);
+
+		// Get the sample data, timestamp, duration, and properties
+		auto [buf, pts, dur, properties, formatChanges] = GetSampleData();
+
+		// Make sure the PTS is set
+		if (pts == AV_NOPTS_VALUE)
+		{
+			pts = m_nextSamplePts;
+		}
+
+		// Calculate the PTS for the next sample
+		m_nextSamplePts = pts + dur;
+
+		// Convert time base from FFmpeg to MF
+		pts = ConvertFromAVTime(pts - m_startOffset, m_stream->time_base, HNS_PER_SEC);
+		dur = ConvertFromAVTime(dur, m_stream->time_base, HNS_PER_SEC);
+
+		return { move(buf), pts, dur, move(properties), move(formatChanges) };
+	}
+
 	tuple<IBuffer, int64_t, int64_t, vector<pair<GUID, Windows::Foundation::IInspectable>>, vector<pair<GUID, Windows::Foundation::IInspectable>>> SampleProvider::GetSampleData()
 	{
 		AVPacket_ptr packet{ GetPacket() };
@@ -451,10 +574,23 @@ namespace winrt::FFmpegInterop::implementation
 
 	AVPacket_ptr SampleProvider::GetPacket()
 	{
+		auto lock{ m_reader.Lock() };
+
 		// Continue reading until there is an appropriate packet in the stream
 		while (m_packetQueue.empty())
 		{
-			m_reader.ReadPacket();
+			try
+			{
+				m_reader.ReadPacket();
+			}
+			catch (...)
+			{
+				// At EOF, continue with any packets still buffered by the bitstream filter
+				if (to_hresult() != MF_E_END_OF_STREAM || !DrainBitstreamFilter())
+				{
+					throw;
+				}
+			}
 		}
 
 		AVPacket_ptr packet{ move(m_packetQueue.front()) };
@@ -25,7 +25,7 @@ namespace winrt::FFmpegInterop::implementation
 	class SampleProvider
 	{
 	public:
-		SampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader);
+		SampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext = nullptr);
 
 		virtual ~SampleProvider() = default;
 
@@ -35,22 +35,36 @@ namespace winrt::FFmpegInterop::implementation
 		void Deselect() noexcept;
 		void OnSeek(_In_ int64_t hnsSeekTime) noexcept;
 		virtual void NotifyEOF() noexcept;
+		virtual void NotifySampleLag(_In_ int64_t /*hnsSampleLag*/) noexcept { }
+		virtual void NotifyAudioOnly() noexcept { }
+		virtual void Pause() noexcept { }
 		virtual void GetSample(_Inout_ const Windows::Media::Core::MediaStreamSourceSampleRequest& request);
+
+		// Gets the next sample's data, timestamp (hns), duration (hns), properties, and format changes without a MSS request
+		std::tuple<Windows::Storage::Streams::IBuffer, int64_t, int64_t, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>> ReadSample();
 		virtual void QueuePacket(_In_ AVPacket_ptr packet);
+		int GetStreamIndex() const noexcept { return m_stream->index; }
 
 	protected:
 		AVPacket_ptr GetPacket();
-		bool HasPacket() const noexcept { return !m_packetQueue.empty(); }
+		AVPacket_ptr TryGetPacket();
+		void ReturnPacket(_In_ AVPacket_ptr packet);
+		void ReceiveFilteredPackets();
+		bool DrainBitstreamFilter();
+		bool HasPacket();
 
 		virtual void Flush() noexcept;
 		virtual std::tuple<Windows::Storage::Streams::IBuffer, int64_t, int64_t, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>> GetSampleData();
 
 		AVStream* m_stream;
+		AVCodecParameters* m_codecPar; // The stream's parameters as the bitstream filter outputs them. The demuxer's are left untouched.
 		Reader& m_reader;
 		bool m_isSelected{ false };
 		bool m_isEOS{ false };
 		bool m_isDiscontinuous{ true };
 		std::deque<AVPacket_ptr> m_packetQueue;
+		AVBSFContext_ptr m_bsfContext;
+		bool m_isBitstreamFilterDrained{ false };
 		int64_t m_startOffset{ 0 }; // AVStream::time_base units
 		int64_t m_nextSamplePts{ 0 }; // AVStream::time_base units
 	};
@@ -26,6 +26,7 @@
 #include "H264SampleProvider.h"
 #include "HEVCSampleProvider.h"
 #include "MPEGSampleProvider.h"
+#include "PCMSampleProvider.h"
 #include "SubtitleSampleProvider.h"
 #include "UncompressedAudioSampleProvider.h"
 #include "UncompressedVideoSampleProvider.h"
@@ -68,6 +69,70 @@ namespace
 		return CreateEncProp<TimedMetadataEncodingProperties>(subtype);
 	}
 
+	AVStream* FindEmbeddedAC3Stream(_In_ const AVFormatContext* formatContext, _In_ const AVStream* trueHDStream)
+	{
+		// Blu-ray TrueHD streams interleave an AC-3 stream in the same PID. FFmpeg exposes it as a separate stream with the same ID.
+		for (unsigned int i{ static_cast<unsigned int>(trueHDStream->index) + 1 }; i < formatContext->nb_streams; i++)
+		{
+			AVStream* stream{ formatContext->streams[i] };
+			if (stream->id == trueHDStream->id && stream->codecpar->codec_id == AV_CODEC_ID_AC3)
+			{
+				return stream;
+			}
+		}
+
+		return nullptr;
+	}
+
+	bool IsBluRayPrimaryAudioStream(_In_ const AVFormatContext* formatContext, _In_ const AVStream* stream)
+	{
+		// Blu-ray M2TS files prefix each 188 byte TS packet with a 4 byte timestamp, and put primary audio on PIDs 0x1100-0x111F.
+		// Secondary audio (PIDs 0x1A00-0x1A1F) and broadcast streams use E-AC-3 without an AC-3 core.
+		constexpr int64_t m2tsPacketSize{ 192 };
+		constexpr int primaryAudioFirstPid{ 0x1100 };
+		constexpr int primaryAudioLastPid{ 0x111F };
+
+		if (strcmp(formatContext->iformat->name, "mpegts") != 0)
+		{
+			return false;
+		}
+
+		int64_t packetSize{ 0 };
+		if (av_opt_get_int(formatContext->priv_data, "ts_packetsize", 0, &packetSize) < 0 || packetSize != m2tsPacketSize)
+		{
+			return false;
+		}
+
+		return stream->id >= primaryAudioFirstPid && stream->id <= primaryAudioLastPid;
+	}
+
+	void SetAudioCoreParameters(_Inout_ AVCodecParameters* codecPar, _In_ AVCodecID coreCodecId, _In_ int coreProfile, _In_ int64_t maxCoreBitrate)
+	{
+		// The core filters pass the HD stream's parameters through unchanged, so describe the core from the limits of its format.
+		// A DTS or AC-3 core carries at most 5.1 channels at 48 kHz. Higher sample rates are extensions on top of a core running
+		// at the base rate of the same family.
+		codecPar->codec_id = coreCodecId;
+		codecPar->profile = coreProfile;
+
+		while (codecPar->sample_rate > 48000)
+		{
+			codecPar->sample_rate /= 2;
+		}
+
+		if (codecPar->ch_layout.nb_channels > 6)
+		{
+			// Extra channels are only carried in the extension. The core is a 5.1 downmix, with the LFE if the stream has one.
+			const bool hasLfe{ codecPar->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC ||
+				av_channel_layout_index_from_channel(&codecPar->ch_layout, AV_CHAN_LOW_FREQUENCY) >= 0 };
+
+			av_channel_layout_uninit(&codecPar->ch_layout);
+			THROW_HR_IF_FFMPEG_FAILED(av_channel_layout_from_mask(&codecPar->ch_layout, hasLfe ? AV_CH_LAYOUT_5POINT1 : AV_CH_LAYOUT_5POINT0));
+		}
+
+		// The core is part of the stream, so it can't exceed the stream's bitrate either
+		codecPar->bit_rate = codecPar->bit_rate > 0 ? min(codecPar->bit_rate, maxCoreBitrate) : maxCoreBitrate;
+	}
+
 	void SetStreamDescriptorProperties(_In_ const AVStream* stream, _Inout_ const IMediaStreamDescriptor& streamDescriptor)
 	{
 		const AVDictionaryEntry* titleTag{ av_dict_get(stream->metadata, "title", nullptr, 0) };
@@ -93,7 +158,11 @@ namespace winrt::FFmpegInterop::implementation
 		AudioEncodingProperties audioEncProp{ nullptr };
 		bool setFormatUserData{ false };
 
-		AVCodecID codecId{ stream->codecpar->codec_id };
+		// Set up the bitstream filter first as it may change the codec parameters
+		AVBSFContext_ptr bsfContext{ CreateBitstreamFilter(stream, config) };
+		const AVCodecParameters* codecPar{ bsfContext != nullptr ? bsfContext->par_out : stream->codecpar };
+
+		AVCodecID codecId{ codecPar->codec_id };
 		FFMPEG_INTEROP_TRACE("Stream %d: New audio stream. AVCodec Name = %hs", stream->index, avcodec_get_name(codecId));
 
 		if (config != nullptr && config.ForceAudioDecode())
@@ -102,68 +171,100 @@ namespace winrt::FFmpegInterop::implementation
 			codecId = AV_CODEC_ID_NONE;
 		}
 
+		// Configured bitstream filters take precedence over core extraction
+		const bool extractAudioCore{ config != nullptr && config.ExtractAudioCore() && bsfContext == nullptr };
+
 		switch (codecId)
 		{
 		case AV_CODEC_ID_AAC:
-			if (stream->codecpar->extradata_size == 0)
+			if (codecPar->extradata_size == 0)
 			{
-				audioEncProp = AudioEncodingProperties::CreateAacAdts(stream->codecpar->sample_rate, stream->codecpar->ch_layout.nb_channels, static_cast<uint32_t>(stream->codecpar->bit_rate));
+				audioEncProp = AudioEncodingProperties::CreateAacAdts(codecPar->sample_rate, codecPar->ch_layout.nb_channels, static_cast<uint32_t>(codecPar->bit_rate));
 			}
 			else
 			{
-				audioEncProp = AudioEncodingProperties::CreateAac(stream->codecpar->sample_rate, stream->codecpar->ch_layout.nb_channels, static_cast<uint32_t>(stream->codecpar->bit_rate));
+				audioEncProp = AudioEncodingProperties::CreateAac(codecPar->sample_rate, codecPar->ch_layout.nb_channels, static_cast<uint32_t>(codecPar->bit_rate));
 			}
 
-			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_AC3:
 			audioEncProp = CreateAudioEncProp(MFAudioFormat_Dolby_AC3);
-			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_ALAC:
 			audioEncProp = CreateAudioEncProp(MFAudioFormat_ALAC);
-			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			setFormatUserData = true;
 			break;
 
 		case AV_CODEC_ID_DTS:
-			audioEncProp = CreateAudioEncProp(MFAudioFormat_DTS_HD);
-			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			// DTS Express doesn't have a core
+			if (extractAudioCore && codecPar->profile != FF_PROFILE_DTS_EXPRESS)
+			{
+				FFMPEG_INTEROP_TRACE("Stream %d: Extracting DTS core", stream->index);
+				constexpr int64_t maxDtsCoreBitrate{ 1536000 }; // bps
+				bsfContext = CreateBitstreamFilter(stream, "dca_core");
+				SetAudioCoreParameters(bsfContext->par_out, AV_CODEC_ID_DTS, FF_PROFILE_DTS, maxDtsCoreBitrate);
+				audioEncProp = CreateAudioEncProp(MFAudioFormat_DTS);
+			}
+			else
+			{
+				audioEncProp = CreateAudioEncProp(MFAudioFormat_DTS_HD);
+			}
+
+			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_EAC3:
-			audioEncProp = CreateAudioEncProp(MFAudioFormat_Dolby_DDPlus);
-			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			// Only Blu-ray primary audio is guaranteed to carry an AC-3 core for compatibility. The core filter drops every
+			// packet of a stream without one, so everything else stays E-AC-3.
+			if (extractAudioCore && IsBluRayPrimaryAudioStream(formatContext, stream))
+			{
+				FFMPEG_INTEROP_TRACE("Stream %d: Extracting AC-3 core", stream->index);
+				constexpr int64_t maxAC3Bitrate{ 640000 }; // bps
+				bsfContext = CreateBitstreamFilter(stream, "eac3_core");
+				SetAudioCoreParameters(bsfContext->par_out, AV_CODEC_ID_AC3, FF_PROFILE_UNKNOWN, maxAC3Bitrate);
+				audioEncProp = CreateAudioEncProp(MFAudioFormat_Dolby_AC3);
+			}
+			else
+			{
+				audioEncProp = CreateAudioEncProp(MFAudioFormat_Dolby_DDPlus);
+			}
+
+			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_FLAC:
 			audioEncProp = CreateAudioEncProp(MFAudioFormat_FLAC);
-			audioSampleProvider = make_unique<FLACSampleProvider>(formatContext, stream, reader);
+			audioSampleProvider = make_unique<FLACSampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_MP1:
 		case AV_CODEC_ID_MP2:
 			audioEncProp = CreateAudioEncProp(MFAudioFormat_MPEG);
-			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_MP3:
-			audioEncProp = AudioEncodingProperties::CreateMp3(stream->codecpar->sample_rate, stream->codecpar->ch_layout.nb_channels, static_cast<uint32_t>(stream->codecpar->bit_rate));
-			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			audioEncProp = AudioEncodingProperties::CreateMp3(codecPar->sample_rate, codecPar->ch_layout.nb_channels, static_cast<uint32_t>(codecPar->bit_rate));
+			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_OPUS:
 			audioEncProp = CreateAudioEncProp(MFAudioFormat_Opus);
-			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			setFormatUserData = true;
 			break;
 
+		case AV_CODEC_ID_PCM_F32BE:
 		case AV_CODEC_ID_PCM_F32LE:
+		case AV_CODEC_ID_PCM_F64BE:
 		case AV_CODEC_ID_PCM_F64LE:
 			audioEncProp = CreateAudioEncProp(MFAudioFormat_Float);
-			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			audioSampleProvider = make_unique<PCMSampleProvider>(formatContext, stream, reader, move(bsfContext), config);
 			break;
 
 		case AV_CODEC_ID_PCM_S16BE:
@@ -174,12 +275,23 @@ namespace winrt::FFmpegInterop::implementation
 		case AV_CODEC_ID_PCM_S32LE:
 		case AV_CODEC_ID_PCM_U8:
 			audioEncProp = CreateAudioEncProp(MFAudioFormat_PCM);
-			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			audioSampleProvider = make_unique<PCMSampleProvider>(formatContext, stream, reader, move(bsfContext), config);
 			break;
 
 		case AV_CODEC_ID_TRUEHD:
-			audioEncProp = CreateAudioEncProp(MEDIASUBTYPE_DOLBY_TRUEHD);
-			audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			if (AVStream* ac3Stream{ extractAudioCore ? FindEmbeddedAC3Stream(formatContext, stream) : nullptr }; ac3Stream != nullptr)
+			{
+				// Back this stream with the embedded AC-3 stream's packets
+				FFMPEG_INTEROP_TRACE("Stream %d: Using embedded AC-3 stream %d", stream->index, ac3Stream->index);
+				ac3Stream->discard = AVDISCARD_ALL; // Discard all samples until this stream is selected
+				audioEncProp = CreateAudioEncProp(MFAudioFormat_Dolby_AC3);
+				audioSampleProvider = make_unique<SampleProvider>(formatContext, ac3Stream, reader, move(bsfContext));
+			}
+			else
+			{
+				audioEncProp = CreateAudioEncProp(MEDIASUBTYPE_DOLBY_TRUEHD);
+				audioSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader, move(bsfContext));
+			}
 			break;
 
 		case AV_CODEC_ID_PCM_MULAW:
@@ -189,13 +301,14 @@ namespace winrt::FFmpegInterop::implementation
 		case AV_CODEC_ID_WMAV2:
 		case AV_CODEC_ID_WMAVOICE:
 			audioEncProp = AudioEncodingProperties::AudioEncodingProperties();
-			audioSampleProvider = make_unique<ACMSampleProvider>(formatContext, stream, reader);
+			audioSampleProvider = make_unique<ACMSampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		default:
+			// The sample provider replaces the subtype and sample size with the configured output format
 			constexpr uint32_t bitsPerSample{ 16 };
-			audioEncProp = AudioEncodingProperties::CreatePcm(stream->codecpar->sample_rate, stream->codecpar->ch_layout.nb_channels, bitsPerSample);
-			audioSampleProvider = make_unique<UncompressedAudioSampleProvider>(formatContext, stream, reader, config != nullptr ? config.AllowedDecodeErrors() : FFmpegInteropMSSConfig::kAllowedDecodeErrorsDefault);
+			audioEncProp = AudioEncodingProperties::CreatePcm(codecPar->sample_rate, codecPar->ch_layout.nb_channels, bitsPerSample);
+			audioSampleProvider = make_unique<UncompressedAudioSampleProvider>(formatContext, stream, reader, move(bsfContext), config);
 			break;
 		}
 
@@ -215,7 +328,11 @@ namespace winrt::FFmpegInterop::implementation
 		VideoEncodingProperties videoEncProp{ nullptr };
 		bool setFormatUserData{ false };
 
-		AVCodecID codecId{ stream->codecpar->codec_id };
+		// Set up the bitstream filter first as it may change the codec parameters
+		AVBSFContext_ptr bsfContext{ CreateBitstreamFilter(stream, config) };
+		const AVCodecParameters* codecPar{ bsfContext != nullptr ? bsfContext->par_out : stream->codecpar };
+
+		AVCodecID codecId{ codecPar->codec_id };
 		FFMPEG_INTEROP_TRACE("Stream %d: New video stream. AVCodec Name = %hs", stream->index, avcodec_get_name(codecId));
 
 		if (config != nullptr && config.ForceVideoDecode())
@@ -228,53 +345,53 @@ namespace winrt::FFmpegInterop::implementation
 		{
 		case AV_CODEC_ID_AV1:
 			videoEncProp = CreateVideoEncProp(MFVideoFormat_AV1);
-			videoSampleProvider = make_unique<AV1SampleProvider>(formatContext, stream, reader);
+			videoSampleProvider = make_unique<AV1SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_H264:
 			videoEncProp = CreateVideoEncProp(MFVideoFormat_H264);
-			videoSampleProvider = make_unique<H264SampleProvider>(formatContext, stream, reader);
+			videoSampleProvider = make_unique<H264SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_HEVC:
 			videoEncProp = CreateVideoEncProp(MFVideoFormat_HEVC);
-			videoSampleProvider = make_unique<HEVCSampleProvider>(formatContext, stream, reader);
+			videoSampleProvider = make_unique<HEVCSampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_MJPEG:
 			videoEncProp = CreateVideoEncProp(MFVideoFormat_MJPG);
-			videoSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			videoSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_MPEG1VIDEO:
 			videoEncProp = CreateVideoEncProp(MFVideoFormat_MPG1);
-			videoSampleProvider = make_unique<MPEGSampleProvider>(formatContext, stream, reader);
+			videoSampleProvider = make_unique<MPEGSampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_MPEG2VIDEO:
 			videoEncProp = CreateVideoEncProp(MFVideoFormat_MPEG2);
-			videoSampleProvider = make_unique<MPEGSampleProvider>(formatContext, stream, reader);
+			videoSampleProvider = make_unique<MPEGSampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_MPEG4:
 			videoEncProp = CreateVideoEncProp(MFVideoFormat_MP4V);
-			videoSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			videoSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			setFormatUserData = true;
 			break;
 
 		case AV_CODEC_ID_MSMPEG4V3:
 			videoEncProp = CreateVideoEncProp(MFVideoFormat_MP43);
-			videoSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			videoSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_VP8:
 			videoEncProp = CreateVideoEncProp(MFVideoFormat_VP80);
-			videoSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			videoSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_VP9:
 			videoEncProp = CreateVideoEncProp(MFVideoFormat_VP90);
-			videoSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader);
+			videoSampleProvider = make_unique<SampleProvider>(formatContext, stream, reader, move(bsfContext));
 			break;
 
 		case AV_CODEC_ID_DVVIDEO:
@@ -286,13 +403,14 @@ namespace winrt::FFmpegInterop::implementation
 		case AV_CODEC_ID_WMV2:
 		case AV_CODEC_ID_WMV3:
 			videoEncProp = VideoEncodingProperties::VideoEncodingProperties();
-			videoSampleProvider = make_unique<VFWSampleProvider>(formatContext, stream, reader);
+			videoSampleProvider = make_unique<VFWSampleProvider>(formatContext, stream, reader, move(bsfContext));
 			setFormatUserData = true;
 			break;
 
 		default:
-			videoEncProp = VideoEncodingProperties::CreateUncompressed(MediaEncodingSubtypes::Nv12(), stream->codecpar->width, stream->codecpar->height);
-			videoSampleProvider = make_unique<UncompressedVideoSampleProvider>(formatContext, stream, reader, config != nullptr ? config.AllowedDecodeErrors() : FFmpegInteropMSSConfig::kAllowedDecodeErrorsDefault);
+			// The sample provider replaces the subtype with the output format it negotiates
+			videoEncProp = VideoEncodingProperties::CreateUncompressed(MediaEncodingSubtypes::Nv12(), codecPar->width, codecPar->height);
+			videoSampleProvider = make_unique<UncompressedVideoSampleProvider>(formatContext, stream, reader, move(bsfContext), config);
 			break;
 		}
 
@@ -354,4 +472,40 @@ namespace winrt::FFmpegInterop::implementation
 
 		return { move(subtitleSampleProvider), move(subtitleStreamDescriptor) };
 	}
+
+	AVBSFContext_ptr StreamFactory::CreateBitstreamFilter(_In_ const AVStream* stream, _In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config)
+	{
+		if (config == nullptr)
+		{
+			return nullptr;
+		}
+
+		// Bitstream filters are configured per codec as a filter chain, e.g. "h264" -> "filter_units=remove_types=6|12"
+		const hstring codecName{ to_hstring(avcodec_get_name(stream->codecpar->codec_id)) };
+		const IReference<hstring> filters{ config.BitstreamFilters().TryLookup(codecName) };
+		if (filters == nullptr)
+		{
+			return nullptr;
+		}
+
+		return CreateBitstreamFilter(stream, to_string(filters.Value()).c_str());
+	}
+
+	AVBSFContext_ptr StreamFactory::CreateBitstreamFilter(_In_ const AVStream* stream, _In_z_ const char* filters)
+	{
+		FFMPEG_INTEROP_TRACE("Stream %d: Bitstream filters = %hs", stream->index, filters);
+
+		AVBSFContext_ptr bsfContext;
+		{
+			AVBSFContext* bsfContextRaw{ nullptr };
+			THROW_HR_IF_FFMPEG_FAILED(av_bsf_list_parse_str(filters, &bsfContextRaw));
+			bsfContext.reset(bsfContextRaw);
+		}
+
+		THROW_HR_IF_FFMPEG_FAILED(avcodec_parameters_copy(bsfContext->par_in, stream->codecpar));
+		bsfContext->time_base_in = stream->time_base;
+		THROW_HR_IF_FFMPEG_FAILED(av_bsf_init(bsfContext.get()));
+
+		return bsfContext;
+	}
 }
@@ -37,5 +37,8 @@ namespace winrt::FFmpegInterop::implementation
 
 	private:
 		StreamFactory() = delete;
+
+		static AVBSFContext_ptr CreateBitstreamFilter(_In_ const AVStream* stream, _In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config);
+		static AVBSFContext_ptr CreateBitstreamFilter(_In_ const AVStream* stream, _In_z_ const char* filters);
 	};
 }
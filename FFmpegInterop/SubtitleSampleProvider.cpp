@@ -32,6 +32,8 @@ namespace winrt::FFmpegInterop::implementation
 
 	void SubtitleSampleProvider::NotifyEOF() noexcept
 	{
+		auto lock{ m_reader.Lock() };
+
 		SampleProvider::NotifyEOF();
 
 		// If we're at EOS now, complete any deferred sample request
@@ -47,6 +49,8 @@ namespace winrt::FFmpegInterop::implementation
 
 	void SubtitleSampleProvider::Flush() noexcept
 	{
+		auto lock{ m_reader.Lock() };
+
 		SampleProvider::Flush();
 
 		// Drop any outstanding sample request
@@ -61,6 +65,10 @@ namespace winrt::FFmpegInterop::implementation
 
 	void SubtitleSampleProvider::QueuePacket(_In_ AVPacket_ptr packet)
 	{
+		// Packets are read on decode-ahead threads as well as the MSS thread, so the deferred request may be filled
+		// on either. The reader lock is already held by Reader::ReadPacket() and serializes this with GetSample() and Flush().
+		auto lock{ m_reader.Lock() };
+
 		SampleProvider::QueuePacket(move(packet));
 
 		// Check if there's an outstanding sample request
@@ -78,6 +86,9 @@ namespace winrt::FFmpegInterop::implementation
 
 	void SubtitleSampleProvider::GetSample(_Inout_ const MediaStreamSourceSampleRequest& request)
 	{
+		// Hold the reader lock so a packet can't be queued between checking for one and deferring the request
+		auto lock{ m_reader.Lock() };
+
 		if (HasPacket())
 		{
 			SampleProvider::GetSample(request);
@@ -36,6 +36,7 @@ namespace winrt::FFmpegInterop::implementation
 		void Flush() noexcept override;
 
 	private:
+		// Guarded by the reader lock
 		Windows::Media::Core::MediaStreamSourceSampleRequest m_sampleRequest{ nullptr };
 		Windows::Media::Core::MediaStreamSourceSampleRequestDeferral m_sampleRequestDeferral{ nullptr };
 	};
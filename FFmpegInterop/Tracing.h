@@ -46,8 +46,25 @@ namespace winrt::FFmpegInterop::implementation
 		DEFINE_TRACELOGGING_ACTIVITY(InitializeFromUri);
 		DEFINE_TRACELOGGING_ACTIVITY(OnStarting);
 		DEFINE_TRACELOGGING_ACTIVITY(OnSampleRequested);
+		DEFINE_TRACELOGGING_ACTIVITY(OnSampleRendered);
 		DEFINE_TRACELOGGING_ACTIVITY(OnSwitchStreamsRequested);
 		DEFINE_TRACELOGGING_ACTIVITY(OnClosed);
+
+		// FFmpegInteropAudioScanner
+		DEFINE_TRACELOGGING_ACTIVITY(ScanAudio);
+
+		// UncompressedVideoSampleProvider
+		DEFINE_TRACELOGGING_EVENT_PARAM3(DecodeQualityChanged, int32_t, StreamIndex, int32_t, DecodeQuality, double, DecodeLoad);
+
+		// UncompressedSampleProvider
+		DEFINE_TRACELOGGING_EVENT_PARAM2(AudioBurstStarted, int32_t, StreamIndex, int64_t, BufferedDuration);
+		DEFINE_TRACELOGGING_EVENT_PARAM3(AudioBurstCompleted, int32_t, StreamIndex, int64_t, BufferedDuration, int64_t, CpuTime);
+
+		// AudioSampleBatcher
+		DEFINE_TRACELOGGING_EVENT_PARAM3(AudioBatchDurationChanged, int32_t, StreamIndex, int64_t, TargetDuration, int64_t, RequestInterval);
+
+		// UncompressedAudioSampleProvider, UncompressedVideoSampleProvider
+		DEFINE_TRACELOGGING_EVENT_PARAM4(ConversionCacheLookup, int32_t, StreamIndex, bool, IsHit, uint32_t, HitCount, uint32_t, MissCount);
 	};
 
 // Strip path from __FILE__
@@ -18,35 +18,121 @@
 
 #include "pch.h"
 #include "UncompressedAudioSampleProvider.h"
+#include "AudioConversion.h"
+#include "FFmpegInteropMSSConfig.h"
 
 using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Media::Core;
 using namespace winrt::Windows::Media::MediaProperties;
 using namespace winrt::Windows::Storage::Streams;
 using namespace std;
 
 namespace winrt::FFmpegInterop::implementation
 {
-	UncompressedAudioSampleProvider::UncompressedAudioSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_ uint32_t allowedDecodeErrors) :
-		UncompressedSampleProvider(formatContext, stream, reader, allowedDecodeErrors),
-		m_minAudioSampleDur(ConvertToAVTime(MIN_AUDIO_SAMPLE_DUR_MS, MS_PER_SEC, m_stream->time_base)),
+	UncompressedAudioSampleProvider::UncompressedAudioSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext, _In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config) :
+		UncompressedSampleProvider(formatContext, stream, reader, move(bsfContext), config),
+		m_batcher(m_stream->index, FFmpegInteropMSSConfig::GetAudioSampleDurationRange(config)),
 		m_inputSampleFormat(m_codecContext->sample_fmt),
+		m_outputSampleFormat(GetOutputSampleFormat(config != nullptr ? config.AudioOutputFormat() : FFmpegInteropMSSConfig::kAudioOutputFormatDefault)),
 		m_channelLayout(m_codecContext->ch_layout),
-		m_sampleRate(m_codecContext->sample_rate)
+		m_sampleRate(m_codecContext->sample_rate),
+		m_targetChannels(config != nullptr ? static_cast<int>(config.AudioOutputChannels()) : 0),
+		m_targetSampleRate(config != nullptr ? static_cast<int>(config.AudioOutputSampleRate()) : 0),
+		m_outputBuffers(m_stream->index)
 	{
-		if (m_sampleRate != AV_SAMPLE_FMT_S16)
+		if (config != nullptr && config.AudioLevelMeter() != nullptr)
+		{
+			m_levelMeter.copy_from(get_self<AudioLevelMeter>(config.AudioLevelMeter()));
+		}
+
+		InitConversion();
+	}
+
+	UncompressedAudioSampleProvider::~UncompressedAudioSampleProvider()
+	{
+		StopDecodeAhead();
+	}
+
+	AVSampleFormat UncompressedAudioSampleProvider::GetOutputSampleFormat(_In_ FFmpegInterop::AudioOutputFormat outputFormat)
+	{
+		switch (outputFormat)
+		{
+		case FFmpegInterop::AudioOutputFormat::Int16:
+			return AV_SAMPLE_FMT_S16;
+
+		case FFmpegInterop::AudioOutputFormat::Int24In32:
+			// 24 valid bits in a 32-bit container
+			return AV_SAMPLE_FMT_S32;
+
+		case FFmpegInterop::AudioOutputFormat::Float32:
+			return AV_SAMPLE_FMT_FLT;
+
+		default:
+			THROW_HR(E_INVALIDARG);
+		}
+	}
+
+	void UncompressedAudioSampleProvider::InitConversion()
+	{
+		// Downmix to the target channel count and resample to the target rate, if set. Upmixing wouldn't add anything.
+		if (m_targetChannels > 0 && m_targetChannels < m_channelLayout.nb_channels)
+		{
+			m_outputChannelLayout = AVChannelLayoutWrapper{ m_targetChannels };
+		}
+		else
+		{
+			m_outputChannelLayout = m_channelLayout;
+		}
+
+		m_outputSampleRate = m_targetSampleRate > 0 ? m_targetSampleRate : m_sampleRate;
+
+		// Native samples are output as is. Common formats only need to be interleaved and/or converted sample by sample,
+		// which the dedicated kernels do much faster than swresample. Most decoders output FLTP, which makes float output
+		// a pure interleave. Downmixing and resampling are left to swresample.
+		const bool isRemixNeeded{ av_channel_layout_compare(&m_channelLayout, &m_outputChannelLayout) != 0 || m_sampleRate != m_outputSampleRate };
+		if (!isRemixNeeded &&
+			(m_inputSampleFormat == m_outputSampleFormat || IsInterleavedConversionSupported(m_inputSampleFormat, m_outputSampleFormat, m_channelLayout.nb_channels)))
+		{
+			CacheResampler();
+		}
+		else
 		{
 			InitResampler();
 		}
+
+		// Size output buffers to hold a full compacted sample, plus the frame that takes it past the minimum duration
+		const int64_t minSampleCount{ av_rescale_rnd(m_batcher.GetMaxDuration(), m_outputSampleRate, HNS_PER_SEC, AV_ROUND_UP) };
+		const int64_t maxFrameSize{ av_rescale_rnd(max(m_codecContext->frame_size, DEFAULT_FRAME_SIZE), m_outputSampleRate, m_sampleRate, AV_ROUND_UP) };
+		const size_t blockAlign{ static_cast<size_t>(m_outputChannelLayout.nb_channels) * av_get_bytes_per_sample(m_outputSampleFormat) };
+		const size_t bufferSize{ static_cast<size_t>(minSampleCount + maxFrameSize) * blockAlign };
+
+		if (bufferSize != m_outputBuffers.GetBufferSize())
+		{
+			m_outputBuffers.Init(bufferSize);
+		}
 	}
 
 	void UncompressedAudioSampleProvider::InitResampler()
 	{
+		CacheResampler();
+
+		m_resamplerKey = { m_inputSampleFormat, m_channelLayout, m_sampleRate };
+
+		optional<SwrContext_ptr> cachedSwrContext{ m_resamplerCache.Take(m_resamplerKey) };
+		FFmpegInteropProvider::ConversionCacheLookup(m_stream->index, cachedSwrContext.has_value(), m_resamplerCache.GetHitCount(), m_resamplerCache.GetMissCount());
+
+		if (cachedSwrContext.has_value())
+		{
+			m_swrContext = move(*cachedSwrContext);
+			return;
+		}
+
 		SwrContext* swrContext{ m_swrContext.release() };
 		THROW_HR_IF_FFMPEG_FAILED(swr_alloc_set_opts2(
 			&swrContext,
-			&m_channelLayout,
-			AV_SAMPLE_FMT_S16,
-			m_sampleRate,
+			&m_outputChannelLayout,
+			m_outputSampleFormat,
+			m_outputSampleRate,
 			&m_channelLayout,
 			m_inputSampleFormat,
 			m_sampleRate,
@@ -57,49 +143,141 @@ namespace winrt::FFmpegInterop::implementation
 		THROW_HR_IF_FFMPEG_FAILED(swr_init(m_swrContext.get()));
 	}
 
+	void UncompressedAudioSampleProvider::CacheResampler()
+	{
+		// Keep the current resampler in case the stream switches back to this format (e.g. adaptive streams)
+		if (m_swrContext != nullptr)
+		{
+			m_resamplerCache.Put(m_resamplerKey, move(m_swrContext));
+		}
+	}
+
+	void UncompressedAudioSampleProvider::PublishLevels(_In_ int64_t pts, _In_ int64_t dur, _In_ const vector<float>& peak, _In_ const vector<double>& sumOfSquares, _In_ int64_t sampleCount)
+	{
+		// Timestamp the levels the same way the sample will be
+		if (pts == AV_NOPTS_VALUE)
+		{
+			pts = m_nextLevelsPts;
+		}
+
+		m_nextLevelsPts = pts + dur;
+
+		vector<float> rms(sumOfSquares.size());
+		for (size_t channel{ 0 }; channel < rms.size(); channel++)
+		{
+			rms[channel] = static_cast<float>(sqrt(sumOfSquares[channel] / sampleCount));
+		}
+
+		m_levelMeter->Publish(
+			ConvertFromAVTime(pts - m_startOffset, m_stream->time_base, HNS_PER_SEC),
+			ConvertFromAVTime(dur, m_stream->time_base, HNS_PER_SEC),
+			static_cast<int>(peak.size()),
+			peak.data(),
+			rms.data());
+	}
+
 	void UncompressedAudioSampleProvider::SetEncodingProperties(_Inout_ const IMediaEncodingProperties& encProp, _In_ bool /*setFormatUserData*/)
 	{
 		// We intentionally don't call SampleProvider::SetEncodingProperties() here as
 		// it would set encoding properties with values for the compressed audio type.
 
+		// Describe the output sample format
+		AudioEncodingProperties audioEncProp{ encProp.as<AudioEncodingProperties>() };
+		const uint32_t bitsPerSample{ static_cast<uint32_t>(av_get_bytes_per_sample(m_outputSampleFormat)) * 8 };
+		const uint32_t blockAlign{ static_cast<uint32_t>(m_outputChannelLayout.nb_channels) * bitsPerSample / 8 };
+		audioEncProp.Subtype(to_hstring(m_outputSampleFormat == AV_SAMPLE_FMT_FLT ? MFAudioFormat_Float : MFAudioFormat_PCM));
+		audioEncProp.SampleRate(static_cast<uint32_t>(m_outputSampleRate));
+		audioEncProp.ChannelCount(static_cast<uint32_t>(m_outputChannelLayout.nb_channels));
+		audioEncProp.BitsPerSample(bitsPerSample);
+		audioEncProp.Bitrate(static_cast<uint32_t>(m_outputSampleRate) * blockAlign * 8);
+
 		MediaPropertySet properties{ encProp.Properties() };
 		properties.Insert(MF_MT_COMPRESSED, PropertyValue::CreateUInt32(false));
+		properties.Insert(MF_MT_AUDIO_BLOCK_ALIGNMENT, PropertyValue::CreateUInt32(blockAlign));
+		properties.Insert(MF_MT_AUDIO_AVG_BYTES_PER_SECOND, PropertyValue::CreateUInt32(static_cast<uint32_t>(m_outputSampleRate) * blockAlign));
+
+		if (m_outputSampleFormat == AV_SAMPLE_FMT_S32)
+		{
+			properties.Insert(MF_MT_AUDIO_VALID_BITS_PER_SAMPLE, PropertyValue::CreateUInt32(24));
+		}
 
-		if (m_channelLayout.order == AV_CHANNEL_ORDER_NATIVE)
+		if (m_outputChannelLayout.order == AV_CHANNEL_ORDER_NATIVE)
 		{
-			properties.Insert(MF_MT_AUDIO_CHANNEL_MASK, PropertyValue::CreateUInt32(static_cast<uint32_t>(m_channelLayout.u.mask)));
+			properties.Insert(MF_MT_AUDIO_CHANNEL_MASK, PropertyValue::CreateUInt32(static_cast<uint32_t>(m_outputChannelLayout.u.mask)));
 		}
-		else if (m_channelLayout.order != AV_CHANNEL_ORDER_UNSPEC)
+		else if (m_outputChannelLayout.order != AV_CHANNEL_ORDER_UNSPEC)
 		{
 			// We don't currently support other channel orders
 			THROW_HR(MF_E_INVALIDMEDIATYPE);
 		}
 	}
 
+	void UncompressedAudioSampleProvider::GetSample(_Inout_ const MediaStreamSourceSampleRequest& request)
+	{
+		m_batcher.OnSampleRequested();
+		UncompressedSampleProvider::GetSample(request);
+	}
+
 	void UncompressedAudioSampleProvider::Flush() noexcept
 	{
 		UncompressedSampleProvider::Flush();
+		m_batcher.Reset();
+
+		if (m_swrContext != nullptr)
+		{
+			// Drop samples the resampler is holding back from before the flush
+			LOG_HR_IF(E_FAIL, swr_init(m_swrContext.get()) < 0);
+		}
 
 		m_lastDecodeFailed = false;
 		m_formatChangeFrame.reset();
+
+		if (m_levelMeter != nullptr)
+		{
+			m_levelMeter->Reset();
+		}
 	}
 
-	tuple<IBuffer, int64_t, int64_t, vector<pair<GUID, Windows::Foundation::IInspectable>>, vector<pair<GUID, Windows::Foundation::IInspectable>>> UncompressedAudioSampleProvider::GetSampleData()
+	tuple<IBuffer, int64_t, int64_t, vector<pair<GUID, Windows::Foundation::IInspectable>>, vector<pair<GUID, Windows::Foundation::IInspectable>>> UncompressedAudioSampleProvider::DecodeSampleData()
 	{
 		// Decode samples until we reach the minimum sample duration threshold or EOS
 		IBuffer sampleBuf{ nullptr };
 		int64_t pts{ -1 };
 		int64_t dur{ 0 };
+		const int64_t minSampleDur{ ConvertToAVTime(m_batcher.GetTargetDuration(), HNS_PER_SEC, m_stream->time_base) };
 		vector<pair<GUID, Windows::Foundation::IInspectable>> formatChanges;
 		bool firstDecodedSample{ true };
 		uint32_t decodeErrors{ 0 };
-		vector<uint8_t> compactedSampleBuf;
+		AVBufferRef_ptr outputBuf;
+		uint32_t outputSize{ 0 };
+
+		// Levels of the output samples, measured while they're still in cache
+		vector<float> levelPeak;
+		vector<double> levelSumOfSquares;
+		int64_t levelSampleCount{ 0 };
+		const auto measureLevels{ [&](_In_ const uint8_t* data, _In_ int sampleCount)
+		{
+			if (m_levelMeter == nullptr)
+			{
+				return;
+			}
+
+			if (levelPeak.empty())
+			{
+				// The output channel count is settled by now, since format changes are only applied to the first frame
+				levelPeak.resize(m_outputChannelLayout.nb_channels);
+				levelSumOfSquares.resize(m_outputChannelLayout.nb_channels);
+			}
+
+			AccumulateLevels(levelPeak.data(), levelSumOfSquares.data(), data, m_outputSampleFormat, m_outputChannelLayout.nb_channels, sampleCount);
+			levelSampleCount += sampleCount;
+		} };
 
 		// Check if we had a decode error on the last GetSampleData() call
 		if (m_lastDecodeFailed)
 		{
 			decodeErrors++;
-			m_isDiscontinuous = true;
+			m_isDecodeDiscontinuous = true;
 			m_lastDecodeFailed = false;
 		}
 
@@ -118,19 +296,48 @@ namespace winrt::FFmpegInterop::implementation
 				switch (hr)
 				{
 				case MF_E_END_OF_STREAM:
-					// We've reached EOF
-					if (firstDecodedSample)
+				{
+					// We've reached EOF. Drain the samples the resampler is still holding back so the end of the stream isn't cut off.
+					// The resampler is empty afterwards, so this only adds samples the first time EOF is reached.
+					if (m_swrContext != nullptr)
 					{
-						// Nothing more to do
-						throw;
+						const int maxDrainedSampleCount{ swr_get_out_samples(m_swrContext.get(), 0) };
+						THROW_HR_IF_FFMPEG_FAILED(maxDrainedSampleCount);
+
+						if (maxDrainedSampleCount > 0)
+						{
+							const uint32_t blockAlign{ static_cast<uint32_t>(m_outputChannelLayout.nb_channels * av_get_bytes_per_sample(m_outputSampleFormat)) };
+							m_outputBuffers.Reserve(outputBuf, outputSize, static_cast<size_t>(maxDrainedSampleCount) * blockAlign);
+							uint8_t* outputData{ outputBuf->data + outputSize };
+
+							const int drainedSampleCount{ swr_convert(m_swrContext.get(), &outputData, maxDrainedSampleCount, nullptr, 0) };
+							THROW_HR_IF_FFMPEG_FAILED(drainedSampleCount);
+
+							FFMPEG_INTEROP_TRACE("Stream %d: Drained resampler at EOF. Sample count = %d", m_stream->index, drainedSampleCount);
+
+							measureLevels(outputData, drainedSampleCount);
+							outputSize += static_cast<uint32_t>(drainedSampleCount) * blockAlign;
+
+							if (firstDecodedSample && drainedSampleCount > 0)
+							{
+								// The drained samples make up a sample of their own. The durations of the earlier samples already
+								// include them, so this sample follows on from those and only needs a duration of its own.
+								pts = AV_NOPTS_VALUE;
+								dur = ConvertToAVTime(drainedSampleCount, m_outputSampleRate, m_stream->time_base);
+							}
+						}
 					}
-					else
+
+					if (outputSize == 0)
 					{
-						// Return the decoded sample data we have
-						sampleBuf = make<FFmpegInteropBuffer>(move(compactedSampleBuf));
+						// Nothing more to do
+						throw;
 					}
 
+					// Return the decoded sample data we have
+					sampleBuf = make<FFmpegInteropBuffer>(move(outputBuf), outputSize);
 					break;
+				}
 
 				case E_OUTOFMEMORY:
 					// Always treat as fatal error
@@ -146,14 +353,14 @@ namespace winrt::FFmpegInterop::implementation
 
 						if (firstDecodedSample)
 						{
-							m_isDiscontinuous = true;
+							m_isDecodeDiscontinuous = true;
 						}
 						else
 						{
 							m_lastDecodeFailed = true;
 
 							// Return the decoded sample data we have
-							sampleBuf = make<FFmpegInteropBuffer>(move(compactedSampleBuf));
+							sampleBuf = make<FFmpegInteropBuffer>(move(outputBuf), outputSize);
 						}
 					}
 					else
@@ -183,57 +390,45 @@ namespace winrt::FFmpegInterop::implementation
 			{
 				if (firstDecodedSample)
 				{
-					// Get the list of format changes
-					if (m_inputSampleFormat != frame->format)
+					if (frame->ch_layout.order != AV_CHANNEL_ORDER_NATIVE && frame->ch_layout.order != AV_CHANNEL_ORDER_UNSPEC)
 					{
-						m_inputSampleFormat = static_cast<AVSampleFormat>(frame->format);
+						// We don't currently support other channel orders
+						THROW_HR(MF_E_INVALIDMEDIATYPE);
 					}
 
-					if (av_channel_layout_compare(&m_channelLayout, &frame->ch_layout) != 0)
+					m_inputSampleFormat = static_cast<AVSampleFormat>(frame->format);
+					m_channelLayout = frame->ch_layout;
+					m_sampleRate = frame->sample_rate;
+
+					const AVChannelLayoutWrapper oldOutputChannelLayout{ m_outputChannelLayout };
+					const int oldOutputSampleRate{ m_outputSampleRate };
+
+					InitConversion();
+
+					// Get the list of format changes. The output format only changes if the target doesn't pin it.
+					const uint32_t blockAlign{ static_cast<uint32_t>(m_outputChannelLayout.nb_channels * av_get_bytes_per_sample(m_outputSampleFormat)) };
+					if (av_channel_layout_compare(&oldOutputChannelLayout, &m_outputChannelLayout) != 0)
 					{
-						if (frame->ch_layout.order == AV_CHANNEL_ORDER_NATIVE)
-						{
-							formatChanges.emplace_back(MF_MT_AUDIO_CHANNEL_MASK, PropertyValue::CreateUInt32(static_cast<uint32_t>(frame->ch_layout.u.mask)));
-						}
-						else if (frame->ch_layout.order != AV_CHANNEL_ORDER_UNSPEC)
+						if (m_outputChannelLayout.order == AV_CHANNEL_ORDER_NATIVE)
 						{
-							// We don't currently support other channel orders
-							THROW_HR(MF_E_INVALIDMEDIATYPE);
+							formatChanges.emplace_back(MF_MT_AUDIO_CHANNEL_MASK, PropertyValue::CreateUInt32(static_cast<uint32_t>(m_outputChannelLayout.u.mask)));
 						}
 
-						if (m_channelLayout.nb_channels != frame->ch_layout.nb_channels)
+						if (oldOutputChannelLayout.nb_channels != m_outputChannelLayout.nb_channels)
 						{
-							formatChanges.emplace_back(MF_MT_AUDIO_NUM_CHANNELS, PropertyValue::CreateUInt32(frame->ch_layout.nb_channels));
-							formatChanges.emplace_back(MF_MT_AUDIO_BLOCK_ALIGNMENT, 
-								PropertyValue::CreateUInt32(frame->ch_layout.nb_channels * av_get_bytes_per_sample(AV_SAMPLE_FMT_S16)));
-							formatChanges.emplace_back(MF_MT_AUDIO_AVG_BYTES_PER_SECOND, 
-								PropertyValue::CreateUInt32(frame->sample_rate * frame->ch_layout.nb_channels * av_get_bytes_per_sample(AV_SAMPLE_FMT_S16)));
+							formatChanges.emplace_back(MF_MT_AUDIO_NUM_CHANNELS, PropertyValue::CreateUInt32(m_outputChannelLayout.nb_channels));
+							formatChanges.emplace_back(MF_MT_AUDIO_BLOCK_ALIGNMENT, PropertyValue::CreateUInt32(blockAlign));
 						}
-						
-						m_channelLayout = frame->ch_layout;
 					}
 
-					if (m_sampleRate != frame->sample_rate)
+					if (oldOutputSampleRate != m_outputSampleRate)
 					{
-						formatChanges.emplace_back(MF_MT_AUDIO_SAMPLES_PER_SECOND, PropertyValue::CreateUInt32(frame->sample_rate));
-						if (none_of(formatChanges.begin(), formatChanges.end(), 
-									[](const auto& val) { return val.first == MF_MT_AUDIO_SAMPLES_PER_SECOND; }))
-						{
-							formatChanges.emplace_back(MF_MT_AUDIO_AVG_BYTES_PER_SECOND,
-								PropertyValue::CreateUInt32(frame->sample_rate * frame->ch_layout.nb_channels * av_get_bytes_per_sample(AV_SAMPLE_FMT_S16)));
-						}
-
-						m_sampleRate = frame->sample_rate;
+						formatChanges.emplace_back(MF_MT_AUDIO_SAMPLES_PER_SECOND, PropertyValue::CreateUInt32(m_outputSampleRate));
 					}
 
-					//  Check if the resampler is needed
-					if (m_inputSampleFormat != AV_SAMPLE_FMT_S16)
+					if (oldOutputChannelLayout.nb_channels != m_outputChannelLayout.nb_channels || oldOutputSampleRate != m_outputSampleRate)
 					{
-						InitResampler();
-					}
-					else
-					{
-						m_swrContext.reset();
+						formatChanges.emplace_back(MF_MT_AUDIO_AVG_BYTES_PER_SECOND, PropertyValue::CreateUInt32(static_cast<uint32_t>(m_outputSampleRate) * blockAlign));
 					}
 				}
 				else
@@ -241,66 +436,78 @@ namespace winrt::FFmpegInterop::implementation
 					// We already have compacted samples in the old format. Return the decoded sample data
 					// we have and wait until the next sample request to trigger the format change.
 					m_formatChangeFrame = move(frame);
-					sampleBuf = make<FFmpegInteropBuffer>(move(compactedSampleBuf));
+					sampleBuf = make<FFmpegInteropBuffer>(move(outputBuf), outputSize);
 					break;
 				}
 			}
 
-			IBuffer curSampleBuf{ nullptr };
-			int curSampleCount{ 0 };
-
-			if (m_swrContext == nullptr)
+			// Update pts and dur
+			if (firstDecodedSample)
 			{
-				// Uncompressed frame is already in the desired output format
-				curSampleBuf = make<FFmpegInteropBuffer>(frame->buf[0]);
-				curSampleCount = frame->nb_samples;
+				pts = frame->pts;
 			}
-			else
-			{
-				// Resample uncompressed frame to desired output format
-				uint8_t* buf{ nullptr };
-				int bufSize{ av_samples_alloc(&buf, nullptr, frame->ch_layout.nb_channels, frame->nb_samples, AV_SAMPLE_FMT_S16, 0) };
-				THROW_HR_IF_FFMPEG_FAILED(bufSize);
 
-				int resampledSamplesCount{ swr_convert(m_swrContext.get(), &buf, frame->nb_samples, const_cast<const uint8_t**>(frame->extended_data), frame->nb_samples) };
-				AVBlob_ptr resampledData{ exchange(buf, nullptr) };
-				THROW_HR_IF_FFMPEG_FAILED(resampledSamplesCount);
+			dur += ConvertToAVTime(frame->nb_samples, m_codecContext->sample_rate, m_stream->time_base);
+
+			const bool minSampleDurMet{ dur >= minSampleDur };
+			const uint32_t blockAlign{ static_cast<uint32_t>(m_outputChannelLayout.nb_channels * av_get_bytes_per_sample(m_outputSampleFormat)) };
 
-				const uint32_t resampledDataSize{ static_cast<uint32_t>(resampledSamplesCount) * frame->ch_layout.nb_channels * av_get_bytes_per_sample(AV_SAMPLE_FMT_S16) };
-				WINRT_ASSERT(resampledDataSize <= static_cast<uint32_t>(bufSize));
+			if (firstDecodedSample && minSampleDurMet && m_swrContext == nullptr && m_inputSampleFormat == m_outputSampleFormat)
+			{
+				// Uncompressed frame is long enough on its own and already in the desired output format.
+				// The frame's buffer may be larger than its samples.
+				AVFrame_ptr frameRef{ av_frame_clone(frame.get()) };
+				THROW_IF_NULL_ALLOC(frameRef);
 
-				curSampleBuf = make<FFmpegInteropBuffer>(move(resampledData), resampledDataSize);
-				curSampleCount = resampledSamplesCount;
+				measureLevels(frame->data[0], frame->nb_samples);
+				sampleBuf = make<FFmpegInteropBuffer>(move(frameRef), static_cast<uint32_t>(frame->nb_samples) * blockAlign);
+				break;
 			}
 
-			// Update pts and dur
-			if (firstDecodedSample)
+			// Convert the uncompressed frame to the desired output format straight into the output buffer
+			if (m_swrContext != nullptr)
 			{
-				pts = frame->pts;
-			}
+				// Resampling may output more samples than it's given
+				const int maxResampledSampleCount{ swr_get_out_samples(m_swrContext.get(), frame->nb_samples) };
+				THROW_HR_IF_FFMPEG_FAILED(maxResampledSampleCount);
 
-			dur += ConvertToAVTime(curSampleCount, m_codecContext->sample_rate, m_stream->time_base);
+				m_outputBuffers.Reserve(outputBuf, outputSize, static_cast<size_t>(maxResampledSampleCount) * blockAlign);
+				uint8_t* outputData{ outputBuf->data + outputSize };
 
-			const bool minSampleDurMet{ dur >= m_minAudioSampleDur };
+				const int resampledSampleCount{ swr_convert(m_swrContext.get(), &outputData, maxResampledSampleCount, const_cast<const uint8_t**>(frame->extended_data), frame->nb_samples) };
+				THROW_HR_IF_FFMPEG_FAILED(resampledSampleCount);
 
-			// Copy the current sample data to the compacted sample buffer if needed
-			if (!firstDecodedSample || !minSampleDurMet)
-			{
-				compactedSampleBuf.insert(compactedSampleBuf.end(), curSampleBuf.data(), curSampleBuf.data() + curSampleBuf.Length());
+				measureLevels(outputData, resampledSampleCount);
+				outputSize += static_cast<uint32_t>(resampledSampleCount) * blockAlign;
 			}
-
-			// Check if we've reached the minimum sample duration threshold
-			if (minSampleDurMet)
+			else
 			{
-				if (firstDecodedSample)
+				m_outputBuffers.Reserve(outputBuf, outputSize, static_cast<size_t>(frame->nb_samples) * blockAlign);
+				uint8_t* outputData{ outputBuf->data + outputSize };
+
+				if (m_inputSampleFormat == m_outputSampleFormat)
 				{
-					sampleBuf = move(curSampleBuf);
+					memcpy(outputData, frame->data[0], static_cast<size_t>(frame->nb_samples) * blockAlign);
 				}
 				else
 				{
-					sampleBuf = make<FFmpegInteropBuffer>(move(compactedSampleBuf));
+					ConvertToInterleaved(
+						outputData,
+						m_outputSampleFormat,
+						frame->extended_data,
+						m_inputSampleFormat,
+						frame->ch_layout.nb_channels,
+						frame->nb_samples);
 				}
 
+				measureLevels(outputData, frame->nb_samples);
+				outputSize += static_cast<uint32_t>(frame->nb_samples) * blockAlign;
+			}
+
+			// Check if we've reached the minimum sample duration threshold
+			if (minSampleDurMet)
+			{
+				sampleBuf = make<FFmpegInteropBuffer>(move(outputBuf), outputSize);
 				break;
 			}
 			else
@@ -313,6 +520,11 @@ namespace winrt::FFmpegInterop::implementation
 			}
 		}
 
+		if (levelSampleCount > 0)
+		{
+			PublishLevels(pts, dur, levelPeak, levelSumOfSquares, levelSampleCount);
+		}
+
 		return { move(sampleBuf), pts, dur, { }, move(formatChanges) };
 	}
 }
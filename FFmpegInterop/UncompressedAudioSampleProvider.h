@@ -18,6 +18,10 @@
 
 #pragma once
 #include "UncompressedSampleProvider.h"
+#include "ConversionCache.h"
+#include "AudioSampleBatcher.h"
+#include "AudioOutputBufferPool.h"
+#include "AudioLevelMeter.h"
 
 namespace winrt::FFmpegInterop::implementation
 {
@@ -25,28 +29,64 @@ namespace winrt::FFmpegInterop::implementation
 		public UncompressedSampleProvider
 	{
 	public:
-		UncompressedAudioSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_ uint32_t allowedDecodeErrors);
+		UncompressedAudioSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext, _In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config);
+		~UncompressedAudioSampleProvider() override;
 
 		void SetEncodingProperties(_Inout_ const Windows::Media::MediaProperties::IMediaEncodingProperties& encProp, _In_ bool setFormatUserData) override;
+		void GetSample(_Inout_ const Windows::Media::Core::MediaStreamSourceSampleRequest& request) override;
 
 	protected:
 		void Flush() noexcept override;
-		std::tuple<Windows::Storage::Streams::IBuffer, int64_t, int64_t, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>> GetSampleData() override;
+		std::tuple<Windows::Storage::Streams::IBuffer, int64_t, int64_t, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>> DecodeSampleData() override;
 
 	private:
+		// Identifies the resampler needed to convert frames
+		struct ResamplerKey
+		{
+			AVSampleFormat inputSampleFormat{ AV_SAMPLE_FMT_NONE };
+			AVChannelLayoutWrapper channelLayout;
+			int sampleRate{ 0 };
+
+			bool operator==(const ResamplerKey& other) const noexcept
+			{
+				return inputSampleFormat == other.inputSampleFormat &&
+					av_channel_layout_compare(&channelLayout, &other.channelLayout) == 0 &&
+					sampleRate == other.sampleRate;
+			}
+		};
+
+		static AVSampleFormat GetOutputSampleFormat(_In_ FFmpegInterop::AudioOutputFormat outputFormat);
+
+		void InitConversion();
 		void InitResampler();
+		void CacheResampler();
+		void PublishLevels(_In_ int64_t pts, _In_ int64_t dur, _In_ const std::vector<float>& peak, _In_ const std::vector<double>& sumOfSquares, _In_ int64_t sampleCount);
 
-		// Minimum duration (in ms) for uncompressed audio samples. 
+		// Sets the minimum duration for uncompressed audio samples.
 		// We'll compact shorter decoded audio samples until this threshold is reached.
-		static constexpr int64_t MIN_AUDIO_SAMPLE_DUR_MS{ 200 };
-		int64_t m_minAudioSampleDur{ 0 };
+		AudioSampleBatcher m_batcher;
+
+		// Number of samples per frame to plan output buffers for when the codec doesn't have a fixed frame size
+		static constexpr int DEFAULT_FRAME_SIZE{ 2048 };
 
 		AVSampleFormat m_inputSampleFormat{ AV_SAMPLE_FMT_NONE };
+		AVSampleFormat m_outputSampleFormat{ AV_SAMPLE_FMT_S16 };
 		AVChannelLayoutWrapper m_channelLayout;
 		int m_sampleRate{ 0 };
+		int m_targetChannels{ 0 };
+		int m_targetSampleRate{ 0 };
+		AVChannelLayoutWrapper m_outputChannelLayout;
+		int m_outputSampleRate{ 0 };
 		AVFrame_ptr m_formatChangeFrame;
 		SwrContext_ptr m_swrContext;
+		ResamplerKey m_resamplerKey;
+		ConversionCache<ResamplerKey, SwrContext_ptr> m_resamplerCache;
+		AudioOutputBufferPool m_outputBuffers;
 
 		bool m_lastDecodeFailed{ false };
+
+		// Measures the levels of output samples as they're converted, if the app asked for them
+		com_ptr<AudioLevelMeter> m_levelMeter;
+		int64_t m_nextLevelsPts{ 0 }; // AVStream::time_base units
 	};
 }
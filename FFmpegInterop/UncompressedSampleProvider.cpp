@@ -18,42 +18,309 @@
 
 #include "pch.h"
 #include "UncompressedSampleProvider.h"
+#include "FFmpegInteropMSSConfig.h"
 
+using namespace winrt::Windows::Foundation;
 using namespace winrt::Windows::Storage::Streams;
 using namespace std;
 
+namespace
+{
+	// Returns the CPU time (in hns) the calling thread has used
+	int64_t GetCurrentThreadCpuTime() noexcept
+	{
+		FILETIME creationTime{ };
+		FILETIME exitTime{ };
+		FILETIME kernelTime{ };
+		FILETIME userTime{ };
+		if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+		{
+			return 0;
+		}
+
+		const auto toHns{ [](_In_ const FILETIME& time) { return (static_cast<int64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime; } };
+		return toHns(kernelTime) + toHns(userTime);
+	}
+}
+
 namespace winrt::FFmpegInterop::implementation
 {
-	UncompressedSampleProvider::UncompressedSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_ uint32_t allowedDecodeErrors) :
-		SampleProvider(formatContext, stream, reader),
-		m_allowedDecodeErrors(allowedDecodeErrors)
+	UncompressedSampleProvider::UncompressedSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext, _In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config) :
+		SampleProvider(formatContext, stream, reader, move(bsfContext)),
+		m_config(config),
+		m_allowedDecodeErrors(config != nullptr ? config.AllowedDecodeErrors() : FFmpegInteropMSSConfig::kAllowedDecodeErrorsDefault),
+		m_decodeAheadDepth(config != nullptr ? config.DecodeAheadDepth() : FFmpegInteropMSSConfig::kDecodeAheadDepthDefault),
+		m_isBurstModeAllowed(config != nullptr && config.AudioBurstMode())
 	{
 		// Create a new decoding context
-		const AVCodec* codec{ avcodec_find_decoder(stream->codecpar->codec_id) };
+		const AVCodec* codec{ avcodec_find_decoder(m_codecPar->codec_id) };
 		THROW_HR_IF_NULL(MF_E_INVALIDMEDIATYPE, codec);
 
 		m_codecContext.reset(avcodec_alloc_context3(codec));
 		THROW_IF_NULL_ALLOC(m_codecContext);
-		THROW_HR_IF_FFMPEG_FAILED(avcodec_parameters_to_context(m_codecContext.get(), stream->codecpar));
+		THROW_HR_IF_FFMPEG_FAILED(avcodec_parameters_to_context(m_codecContext.get(), m_codecPar));
+
+		if (m_codecContext->codec_type == AVMEDIA_TYPE_VIDEO && codec->max_lowres > 0 && config != nullptr)
+		{
+			// If the output is going to be scaled down anyway, have the decoder skip the detail that would be thrown away
+			const auto [outputWidth, outputHeight] { ScaleToFit(m_codecContext->width, m_codecContext->height, config.TargetVideoWidth(), config.TargetVideoHeight()) };
+
+			int lowres{ 0 };
+			while (lowres < codec->max_lowres &&
+				(m_codecContext->width >> (lowres + 1)) >= outputWidth &&
+				(m_codecContext->height >> (lowres + 1)) >= outputHeight)
+			{
+				lowres++;
+			}
+
+			FFMPEG_INTEROP_TRACE("Stream %d: Lowres = %d", m_stream->index, lowres);
+			m_codecContext->lowres = lowres;
+		}
+
+		if (m_codecContext->codec_type == AVMEDIA_TYPE_AUDIO && codec->priv_class != nullptr && config != nullptr &&
+			config.AudioOutputChannels() > 0 && config.AudioOutputChannels() <= 2 &&
+			config.AudioOutputChannels() < static_cast<uint32_t>(m_codecContext->ch_layout.nb_channels) &&
+			av_opt_find(m_codecContext->priv_data, "downmix", nullptr, 0, 0) != nullptr)
+		{
+			// Decoders that can downmix to mono/stereo (e.g. AC-3, DTS) do it with the stream's own mix levels.
+			// Anything else is downmixed by the resampler.
+			const AVChannelLayoutWrapper downmixLayout{ static_cast<int>(config.AudioOutputChannels()) };
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_chlayout(m_codecContext->priv_data, "downmix", &downmixLayout, 0));
+
+			FFMPEG_INTEROP_TRACE("Stream %d: Decoder downmix to %d channels", m_stream->index, downmixLayout.nb_channels);
+		}
 
-		const unsigned int threadCount{ std::thread::hardware_concurrency() };
-		if (threadCount > 0)
+		// Take a share of the process-wide decoder thread budget
+		if (config != nullptr)
+		{
+			m_decoderThreadPriority = config.DecoderThreadPriority();
+		}
+
+		m_decoderThreads = DecoderThreadScheduler::Allocate(m_codecContext.get(), m_decoderThreadPriority);
+		m_nextPriorityCheck = chrono::steady_clock::now() + PRIORITY_CHECK_INTERVAL;
+
+		m_openThreadCount = m_decoderThreads.GetThreadCount();
+		m_codecContext->thread_count = m_openThreadCount;
+		if (m_codecContext->thread_count > 1)
 		{
-			m_codecContext->thread_count = threadCount;
 			m_codecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
 		}
 
 		THROW_HR_IF_FFMPEG_FAILED(avcodec_open2(m_codecContext.get(), codec, nullptr));
 	}
 
+	UncompressedSampleProvider::~UncompressedSampleProvider()
+	{
+		StopDecodeAhead();
+	}
+
+	void UncompressedSampleProvider::Pause() noexcept
+	{
+		// The decode-ahead thread reads packets, so it must be stopped before the demuxer is repositioned.
+		// It's restarted by the next sample request.
+		StopDecodeAhead();
+	}
+
+	void UncompressedSampleProvider::NotifyAudioOnly() noexcept
+	{
+		if (!m_isBurstModeAllowed || m_codecContext->codec_type != AVMEDIA_TYPE_AUDIO)
+		{
+			return;
+		}
+
+		// Decode several seconds at a time on the decode-ahead thread and serve samples from memory in between,
+		// so the CPU can race to idle instead of waking up for every sample
+		FFMPEG_INTEROP_TRACE("Stream %d: Enabling burst mode", m_stream->index);
+
+		m_isBurstModeEnabled = true;
+		m_burstHighWatermark = ConvertToAVTime(BURST_HIGH_WATERMARK_MS, MS_PER_SEC, m_stream->time_base);
+		m_burstLowWatermark = ConvertToAVTime(BURST_LOW_WATERMARK_MS, MS_PER_SEC, m_stream->time_base);
+	}
+
 	void UncompressedSampleProvider::Flush() noexcept
 	{
+		// Stop the decode-ahead thread and discard its samples before flushing the decoder it uses
+		StopDecodeAhead();
+
 		SampleProvider::Flush();
 
 		avcodec_flush_buffers(m_codecContext.get());
+		m_reopenPacket.reset();
 		m_sendInput = true;
 	}
 
+	tuple<IBuffer, int64_t, int64_t, vector<pair<GUID, Windows::Foundation::IInspectable>>, vector<pair<GUID, Windows::Foundation::IInspectable>>> UncompressedSampleProvider::GetSampleData()
+	{
+		if (m_decodeAheadDepth == 0 && !m_isBurstModeEnabled)
+		{
+			auto sampleData{ DecodeSampleData() };
+			m_isDiscontinuous |= exchange(m_isDecodeDiscontinuous, false);
+
+			return sampleData;
+		}
+
+		if (!m_decodeAheadThread.joinable())
+		{
+			FFMPEG_INTEROP_TRACE("Stream %d: Starting decode-ahead. Depth = %u, Burst Mode = %d", m_stream->index, m_decodeAheadDepth, m_isBurstModeEnabled);
+			m_decodeAheadThread = thread{ &UncompressedSampleProvider::DecodeAheadWorker, this };
+		}
+
+		// Wait for the next decoded sample
+		unique_lock<mutex> lock{ m_decodeAheadLock };
+		m_decodeAheadCondition.wait(lock, [this]() { return !m_decodedSamples.empty(); });
+
+		DecodedSample decodedSample{ move(m_decodedSamples.front()) };
+		m_decodedSamples.pop_front();
+		m_decodedDuration -= get<2>(decodedSample.data);
+
+		// Only wake the decode-ahead thread if it has work to do. Between bursts it sleeps until the buffer
+		// drains to the low watermark, so waking it on every request would defeat burst mode.
+		const bool isDecodeAheadNeeded{ m_isBurstModeEnabled ?
+			m_isBursting || m_decodedDuration < m_burstLowWatermark :
+			m_decodedSamples.size() < m_decodeAheadDepth };
+
+		lock.unlock();
+
+		if (isDecodeAheadNeeded)
+		{
+			m_decodeAheadCondition.notify_all();
+		}
+
+		if (decodedSample.error != nullptr)
+		{
+			// The decode-ahead thread exits after an error. Join it so the next request starts a new one.
+			StopDecodeAhead();
+			rethrow_exception(decodedSample.error);
+		}
+
+		m_isDiscontinuous |= decodedSample.isDiscontinuous;
+
+		return move(decodedSample.data);
+	}
+
+	void UncompressedSampleProvider::StopDecodeAhead() noexcept
+	{
+		if (!m_decodeAheadThread.joinable())
+		{
+			return;
+		}
+
+		FFMPEG_INTEROP_TRACE("Stream %d: Stopping decode-ahead", m_stream->index);
+
+		{
+			lock_guard<mutex> lock{ m_decodeAheadLock };
+			m_stopDecodeAhead = true;
+		}
+
+		m_decodeAheadCondition.notify_all();
+		m_decodeAheadThread.join();
+
+		m_stopDecodeAhead = false;
+		m_decodedSamples.clear();
+		m_decodedDuration = 0;
+		m_isBursting = true;
+		m_burstStartCpuTime = 0; // The next decode-ahead thread starts with no CPU time
+		m_isDecodeDiscontinuous = false;
+	}
+
+	bool UncompressedSampleProvider::IsDecodeAheadNeeded() noexcept
+	{
+		if (!m_isBurstModeEnabled)
+		{
+			return m_decodedSamples.size() < m_decodeAheadDepth;
+		}
+
+		// Decode up to the high watermark, then stay idle until playback drains the buffer to the low watermark.
+		// This runs on the decode-ahead thread, so the CPU time is the thread's own.
+		if (m_isBursting)
+		{
+			if (m_decodedDuration < m_burstHighWatermark)
+			{
+				return true;
+			}
+
+			m_isBursting = false;
+			FFmpegInteropProvider::AudioBurstCompleted(m_stream->index, ConvertFromAVTime(m_decodedDuration, m_stream->time_base, HNS_PER_SEC),
+				GetCurrentThreadCpuTime() - m_burstStartCpuTime);
+
+			return false;
+		}
+
+		if (m_decodedDuration < m_burstLowWatermark)
+		{
+			m_isBursting = true;
+			m_burstStartCpuTime = GetCurrentThreadCpuTime();
+			FFmpegInteropProvider::AudioBurstStarted(m_stream->index, ConvertFromAVTime(m_decodedDuration, m_stream->time_base, HNS_PER_SEC));
+
+			return true;
+		}
+
+		return false;
+	}
+
+	void UncompressedSampleProvider::DecodeAheadWorker() noexcept
+	{
+		[[maybe_unused]] wil::ThreadErrorContext errorContext; // Enable WIL's thread error cache for averror_to_hresult()
+
+		// Report how often this thread was woken and how much CPU it used when it exits. This goes through av_log
+		// so apps see it in FFmpegInteropLogging.Log as well as in traces.
+		uint32_t wakeupCount{ 0 };
+		auto reportUsage{ wil::scope_exit([this, &wakeupCount]()
+			{
+				av_log(nullptr, AV_LOG_VERBOSE, "Stream %d: Decode-ahead thread exiting. Wakeups = %u, CPU Time = %lld hns\n",
+					m_stream->index, wakeupCount, static_cast<long long>(GetCurrentThreadCpuTime()));
+			}) };
+
+		try
+		{
+			// Decoded samples are WinRT objects, so this thread needs to be in the MTA
+			THROW_IF_FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+			auto coUninitialize{ wil::scope_exit([]() { CoUninitialize(); }) };
+
+			while (true)
+			{
+				{
+					unique_lock<mutex> lock{ m_decodeAheadLock };
+					while (!m_stopDecodeAhead && !IsDecodeAheadNeeded())
+					{
+						m_decodeAheadCondition.wait(lock);
+						wakeupCount++;
+					}
+
+					if (m_stopDecodeAhead)
+					{
+						return;
+					}
+				}
+
+				DecodedSample decodedSample;
+				decodedSample.data = DecodeSampleData();
+				decodedSample.isDiscontinuous = exchange(m_isDecodeDiscontinuous, false);
+
+				{
+					lock_guard<mutex> lock{ m_decodeAheadLock };
+					m_decodedDuration += get<2>(decodedSample.data);
+					m_decodedSamples.push_back(move(decodedSample));
+				}
+
+				m_decodeAheadCondition.notify_all();
+			}
+		}
+		catch (...)
+		{
+			// Hand the error (including EOS) to the MSS thread and exit
+			DecodedSample decodedSample;
+			decodedSample.error = current_exception();
+
+			{
+				lock_guard<mutex> lock{ m_decodeAheadLock };
+				m_decodedSamples.push_back(move(decodedSample));
+			}
+
+			m_decodeAheadCondition.notify_all();
+		}
+	}
+
 	AVFrame_ptr UncompressedSampleProvider::GetFrame()
 	{
 		// Allocate a frame
@@ -84,6 +351,18 @@ namespace winrt::FFmpegInterop::implementation
 					}
 				}
 
+				UpdateDecoderThreadPriority();
+
+				if (IsDecoderReopenNeeded(packet.get()))
+				{
+					// Drain the decoder so it can be reopened with its new thread allocation before this key frame.
+					// The packet is held back and the null packet left in its place starts draining.
+					FFMPEG_INTEROP_TRACE("Stream %d: Draining decoder to change thread count from %d to %d",
+						m_stream->index, m_openThreadCount, m_decoderThreads.GetThreadCount());
+
+					m_reopenPacket = move(packet);
+				}
+
 				THROW_HR_IF_FFMPEG_FAILED(avcodec_send_packet(m_codecContext.get(), packet.get()));
 				m_sendInput = false;
 			}
@@ -97,10 +376,86 @@ namespace winrt::FFmpegInterop::implementation
 				m_sendInput = true;
 				continue;
 			}
+			else if (decodeResult == AVERROR_EOF && m_reopenPacket != nullptr)
+			{
+				// The decoder is drained. Reopen it and resume decoding from the held back key frame.
+				ReopenDecoder();
+
+				THROW_HR_IF_FFMPEG_FAILED(avcodec_send_packet(m_codecContext.get(), m_reopenPacket.get()));
+				m_reopenPacket.reset();
+				continue;
+			}
 			THROW_HR_IF_FFMPEG_FAILED(decodeResult);
 
 			FFMPEG_INTEROP_TRACE("Stream %d: Frame decoded", m_stream->index);
 			return frame;
 		}
 	}
+
+	void UncompressedSampleProvider::ReopenDecoder()
+	{
+		const int threadCount{ m_decoderThreads.GetThreadCount() };
+		FFMPEG_INTEROP_TRACE("Stream %d: Reopening decoder with %d threads", m_stream->index, threadCount);
+
+		// Start from the parameters of the open decoder, which may differ from the stream's (e.g. after a bitstream filter)
+		AVCodecParameters_ptr codecParams{ avcodec_parameters_alloc() };
+		THROW_IF_NULL_ALLOC(codecParams);
+		THROW_HR_IF_FFMPEG_FAILED(avcodec_parameters_from_context(codecParams.get(), m_codecContext.get()));
+
+		AVCodecContext_ptr codecContext{ avcodec_alloc_context3(m_codecContext->codec) };
+		THROW_IF_NULL_ALLOC(codecContext);
+		THROW_HR_IF_FFMPEG_FAILED(avcodec_parameters_to_context(codecContext.get(), codecParams.get()));
+
+		// Carry over the settings made on the open decoder
+		codecContext->lowres = m_codecContext->lowres;
+		codecContext->opaque = m_codecContext->opaque;
+		codecContext->get_buffer2 = m_codecContext->get_buffer2;
+		codecContext->skip_loop_filter = m_codecContext->skip_loop_filter;
+		codecContext->skip_idct = m_codecContext->skip_idct;
+		codecContext->skip_frame = m_codecContext->skip_frame;
+
+		codecContext->thread_count = threadCount;
+		if (threadCount > 1)
+		{
+			codecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+		}
+
+		THROW_HR_IF_FFMPEG_FAILED(avcodec_open2(codecContext.get(), m_codecContext->codec, nullptr));
+
+		m_codecContext = move(codecContext);
+		m_openThreadCount = threadCount;
+	}
+
+	void UncompressedSampleProvider::UpdateDecoderThreadPriority()
+	{
+		// The app can change the priority during playback (e.g. as a preview scrolls into view), which rebalances the
+		// thread budget of every decoder in the process
+		if (m_config == nullptr)
+		{
+			return;
+		}
+
+		const auto now{ chrono::steady_clock::now() };
+		if (now < m_nextPriorityCheck)
+		{
+			return;
+		}
+
+		m_nextPriorityCheck = now + PRIORITY_CHECK_INTERVAL;
+
+		const FFmpegInterop::DecoderThreadPriority priority{ m_config.DecoderThreadPriority() };
+		if (priority != m_decoderThreadPriority)
+		{
+			FFMPEG_INTEROP_TRACE("Stream %d: Decoder thread priority changed to %d", m_stream->index, static_cast<int>(priority));
+
+			m_decoderThreadPriority = priority;
+			m_decoderThreads.SetPriority(priority);
+		}
+	}
+
+	bool UncompressedSampleProvider::IsDecoderReopenNeeded(_In_ const AVPacket* packet) const noexcept
+	{
+		// Decoding can only restart cleanly at a key frame
+		return packet != nullptr && (packet->flags & AV_PKT_FLAG_KEY) != 0 && m_decoderThreads.GetThreadCount() != m_openThreadCount;
+	}
 }
@@ -19,6 +19,8 @@
 #pragma once
 
 #include "SampleProvider.h"
+#include "DecoderThreadScheduler.h"
+#include "FFmpegInteropMSSConfig.h"
 
 namespace winrt::FFmpegInterop::implementation
 {
@@ -26,15 +28,71 @@ namespace winrt::FFmpegInterop::implementation
 		public SampleProvider
 	{
 	public:
-		UncompressedSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_ uint32_t allowedDecodeErrors);
+		UncompressedSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext, _In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config);
+		~UncompressedSampleProvider() override;
+
+		void Pause() noexcept override;
+		void NotifyAudioOnly() noexcept override;
 
 	protected:
 		void Flush() noexcept override;
+		std::tuple<Windows::Storage::Streams::IBuffer, int64_t, int64_t, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>> GetSampleData() final;
+
+		// Decodes and converts the next sample. This runs on the decode-ahead thread if decode-ahead is enabled.
+		virtual std::tuple<Windows::Storage::Streams::IBuffer, int64_t, int64_t, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>> DecodeSampleData() = 0;
 
 		AVFrame_ptr GetFrame();
 
+		// Recreates the decoder with the current thread allocation. This can only be done when the decoder is drained.
+		void ReopenDecoder();
+
+		// Derived classes must call this from their destructor since the decode-ahead thread calls DecodeSampleData()
+		void StopDecodeAhead() noexcept;
+
+		DecoderThreadScheduler::Allocation m_decoderThreads;
 		AVCodecContext_ptr m_codecContext;
 		bool m_sendInput{ true };
 		uint32_t m_allowedDecodeErrors{ 0 };
+		bool m_isDecodeDiscontinuous{ false }; // Set by DecodeSampleData() instead of m_isDiscontinuous, which belongs to the MSS thread
+
+	private:
+		struct DecodedSample
+		{
+			std::tuple<Windows::Storage::Streams::IBuffer, int64_t, int64_t, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>> data;
+			bool isDiscontinuous{ false };
+			std::exception_ptr error;
+		};
+
+		void DecodeAheadWorker() noexcept;
+		bool IsDecodeAheadNeeded() noexcept;
+		void UpdateDecoderThreadPriority();
+		bool IsDecoderReopenNeeded(_In_ const AVPacket* packet) const noexcept;
+
+		// Buffered duration (in ms) that burst mode decodes up to, and lets playback drain to before waking up again
+		static constexpr int64_t BURST_HIGH_WATERMARK_MS{ 5000 };
+		static constexpr int64_t BURST_LOW_WATERMARK_MS{ 1000 };
+
+		// How often the config's decoder thread priority is checked for changes
+		static constexpr std::chrono::milliseconds PRIORITY_CHECK_INTERVAL{ 250 };
+
+		FFmpegInterop::FFmpegInteropMSSConfig m_config{ nullptr };
+		int m_openThreadCount{ 1 }; // Thread count the decoder was opened with
+		FFmpegInterop::DecoderThreadPriority m_decoderThreadPriority{ FFmpegInteropMSSConfig::kDecoderThreadPriorityDefault };
+		std::chrono::steady_clock::time_point m_nextPriorityCheck;
+		AVPacket_ptr m_reopenPacket; // Key frame held back while the decoder is drained to be reopened
+
+		uint32_t m_decodeAheadDepth{ 0 };
+		bool m_isBurstModeAllowed{ false };
+		bool m_isBurstModeEnabled{ false };
+		bool m_isBursting{ true };
+		int64_t m_burstHighWatermark{ 0 }; // AVStream::time_base units
+		int64_t m_burstLowWatermark{ 0 }; // AVStream::time_base units
+		int64_t m_burstStartCpuTime{ 0 }; // hns
+		int64_t m_decodedDuration{ 0 }; // AVStream::time_base units
+		std::thread m_decodeAheadThread;
+		std::mutex m_decodeAheadLock;
+		std::condition_variable m_decodeAheadCondition;
+		std::deque<DecodedSample> m_decodedSamples;
+		bool m_stopDecodeAhead{ false };
 	};
 }
@@ -18,6 +18,8 @@
 
 #include "pch.h"
 #include "UncompressedVideoSampleProvider.h"
+#include "FFmpegInteropMSSConfig.h"
+#include "VideoConversion.h"
 
 using namespace winrt::Windows::Foundation;
 using namespace winrt::Windows::Media::Core;
@@ -25,50 +27,297 @@ using namespace winrt::Windows::Media::MediaProperties;
 using namespace winrt::Windows::Storage::Streams;
 using namespace std;
 
+namespace
+{
+	struct OutputFormat
+	{
+		AVPixelFormat format;
+		const GUID& subtype;
+		const wchar_t* name; // As returned by MediaEncodingSubtypes
+	};
+
+	// Output formats with an equivalent MF subtype
+	const OutputFormat OUTPUT_FORMATS[]
+	{
+		{ AV_PIX_FMT_NV12, MFVideoFormat_NV12, L"NV12" },
+		{ AV_PIX_FMT_P010LE, MFVideoFormat_P010, L"P010" },
+		{ AV_PIX_FMT_P016LE, MFVideoFormat_P016, L"P016" },
+		{ AV_PIX_FMT_YUV420P, MFVideoFormat_IYUV, L"IYUV" },
+		{ AV_PIX_FMT_YUYV422, MFVideoFormat_YUY2, L"YUY2" },
+		{ AV_PIX_FMT_VUYA, MFVideoFormat_AYUV, L"AYUV" },
+		{ AV_PIX_FMT_BGRA, MFVideoFormat_ARGB32, L"BGRA8" },
+		{ AV_PIX_FMT_BGR0, MFVideoFormat_RGB32, L"RGB32" },
+	};
+}
+
 namespace winrt::FFmpegInterop::implementation
 {
-	UncompressedVideoSampleProvider::UncompressedVideoSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_ uint32_t allowedDecodeErrors) :
-		UncompressedSampleProvider(formatContext, stream, reader, allowedDecodeErrors),
-		m_outputWidth(m_codecContext->width),
-		m_outputHeight(m_codecContext->height)
+	UncompressedVideoSampleProvider::UncompressedVideoSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext, _In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config) :
+		UncompressedSampleProvider(formatContext, stream, reader, move(bsfContext), config),
+		m_targetWidth(config != nullptr ? config.TargetVideoWidth() : 0),
+		m_targetHeight(config != nullptr ? config.TargetVideoHeight() : 0),
+		m_frameWidth(m_codecContext->width),
+		m_frameHeight(m_codecContext->height),
+		m_isAdaptiveDecodeQualityEnabled(config != nullptr && config.AdaptiveDecodeQuality())
 	{
-		if (m_codecContext->pix_fmt != AV_PIX_FMT_NV12)
+		if (config != nullptr)
 		{
-			InitScaler();
+			for (const hstring& subtype : config.VideoOutputSubtypes())
+			{
+				m_preferredFormats.push_back(GetOutputFormat(subtype));
+			}
 		}
+
+		m_outputFormat = SelectOutputFormat(m_codecContext->pix_fmt);
+		tie(m_outputWidth, m_outputHeight) = ScaleToFit(m_frameWidth, m_frameHeight, m_targetWidth, m_targetHeight);
+
+		InitConversion();
+
+		// Decoders that support custom buffers can decode straight into output buffers
+		if ((m_codecContext->codec->capabilities & AV_CODEC_CAP_DR1) != 0)
+		{
+			m_codecContext->opaque = this;
+			m_codecContext->get_buffer2 = GetBuffer;
+		}
+	}
+
+	UncompressedVideoSampleProvider::~UncompressedVideoSampleProvider()
+	{
+		StopDecodeAhead();
+
+		// Wait for decoder threads, which may still be allocating buffers from this provider
+		avcodec_flush_buffers(m_codecContext.get());
 	}
 
-	void UncompressedVideoSampleProvider::InitScaler()
+	int UncompressedVideoSampleProvider::GetBuffer(_In_ AVCodecContext* codecContext, _Inout_ AVFrame* frame, _In_ int flags) noexcept
 	{
-		// Setup software scaler to convert the pixel format to NV12
-		m_swsContext.reset(sws_getContext(
-			m_outputWidth,
-			m_outputHeight,
-			m_codecContext->pix_fmt,
-			m_outputWidth,
-			m_outputHeight,
-			AV_PIX_FMT_NV12,
-			SWS_BICUBIC,
-			nullptr,
-			nullptr,
-			nullptr));
-		THROW_IF_NULL_ALLOC(m_swsContext);
+		UncompressedVideoSampleProvider* provider{ static_cast<UncompressedVideoSampleProvider*>(codecContext->opaque) };
 
-		THROW_HR_IF_FFMPEG_FAILED(av_image_fill_linesizes(m_lineSizes, AV_PIX_FMT_NV12, m_outputWidth));
+		{
+			lock_guard<mutex> lock{ provider->m_bufferPoolLock };
 
-		// Create a buffer pool
-		const int requiredBufferSize{ av_image_get_buffer_size(AV_PIX_FMT_NV12, m_outputWidth, m_outputHeight, 1) };
-		THROW_HR_IF_FFMPEG_FAILED(requiredBufferSize);
+			// Only frames that are output as is and fit in the buffer layout described to MF can use output buffers
+			if (provider->m_conversion == Conversion::None &&
+				frame->format == provider->m_outputFormat &&
+				frame->width <= provider->m_bufferWidth &&
+				frame->height <= provider->m_bufferHeight)
+			{
+				AVBufferRef* bufferRef{ av_buffer_pool_get(provider->m_bufferPool.get()) };
+				if (bufferRef != nullptr)
+				{
+					frame->buf[0] = bufferRef;
+					av_image_fill_pointers(frame->data, provider->m_outputFormat, provider->m_bufferHeight, bufferRef->data, provider->m_lineSizes);
+					copy(begin(provider->m_lineSizes), end(provider->m_lineSizes), frame->linesize);
+					frame->extended_data = frame->data;
 
-		m_bufferPool.reset(av_buffer_pool_init(requiredBufferSize, nullptr));
+					return 0;
+				}
+			}
+		}
+
+		return avcodec_default_get_buffer2(codecContext, frame, flags);
+	}
+
+	AVPixelFormat UncompressedVideoSampleProvider::GetOutputFormat(_In_ const hstring& subtype)
+	{
+		// Subtypes can be given by name or as a GUID string
+		for (const OutputFormat& outputFormat : OUTPUT_FORMATS)
+		{
+			if (_wcsicmp(subtype.c_str(), outputFormat.name) == 0 || _wcsicmp(subtype.c_str(), to_hstring(outputFormat.subtype).c_str()) == 0)
+			{
+				return outputFormat.format;
+			}
+		}
+
+		THROW_HR_MSG(MF_E_INVALIDMEDIATYPE, "Unsupported video output subtype: %ls", subtype.c_str());
+	}
+
+	GUID UncompressedVideoSampleProvider::GetOutputSubtype(_In_ AVPixelFormat format)
+	{
+		for (const OutputFormat& outputFormat : OUTPUT_FORMATS)
+		{
+			if (outputFormat.format == format)
+			{
+				return outputFormat.subtype;
+			}
+		}
+
+		THROW_HR(MF_E_INVALIDMEDIATYPE);
+	}
+
+	AVPixelFormat UncompressedVideoSampleProvider::SelectOutputFormat(_In_ AVPixelFormat format) const
+	{
+		const AVPixFmtDescriptor* desc{ av_pix_fmt_desc_get(format) };
+
+		if (m_preferredFormats.empty())
+		{
+			// Output high bit depth YUV as P010/P016 so that precision isn't lost converting to NV12
+			if (desc != nullptr && (desc->flags & AV_PIX_FMT_FLAG_RGB) == 0 && desc->nb_components >= 3 && desc->comp[0].depth > 8)
+			{
+				return desc->comp[0].depth <= 10 ? AV_PIX_FMT_P010LE : AV_PIX_FMT_P016LE;
+			}
+
+			return AV_PIX_FMT_NV12;
+		}
+
+		// Frames already in a preferred format don't need to be converted at all
+		if (find(m_preferredFormats.begin(), m_preferredFormats.end(), format) != m_preferredFormats.end())
+		{
+			return format;
+		}
+
+		// Otherwise convert to the preferred format that loses the least information (e.g. alpha or bit depth)
+		vector<AVPixelFormat> formats{ m_preferredFormats };
+		formats.push_back(AV_PIX_FMT_NONE);
+
+		const bool hasAlpha{ desc != nullptr && (desc->flags & AV_PIX_FMT_FLAG_ALPHA) != 0 };
+		const AVPixelFormat outputFormat{ avcodec_find_best_pix_fmt_of_list(formats.data(), format, hasAlpha, nullptr) };
+
+		return outputFormat != AV_PIX_FMT_NONE ? outputFormat : m_preferredFormats.front();
+	}
+
+	void UncompressedVideoSampleProvider::InitConversion()
+	{
+		lock_guard<mutex> lock{ m_bufferPoolLock };
+
+		const bool isDownscaling{ m_outputWidth != m_frameWidth || m_outputHeight != m_frameHeight };
+
+		// Split the conversion of large frames into slices, using no more threads than the decoder is given.
+		// The decoder's share can change during playback, so the converters check it for each frame.
+		const int64_t outputPixelCount{ static_cast<int64_t>(m_outputWidth) * m_outputHeight };
+		m_maxSliceCount = static_cast<int>(clamp<int64_t>(outputPixelCount / MIN_SLICE_PIXEL_COUNT, 1, MAX_SLICE_COUNT));
+
+		// Common planar YUV formats only need their chroma planes interleaved (and possibly subsampled or shifted),
+		// which the dedicated converters do much faster than a generic swscale pass.
+		if (!isDownscaling && m_codecContext->pix_fmt == m_outputFormat)
+		{
+			m_conversion = Conversion::None;
+		}
+		else if (!isDownscaling && m_outputFormat == AV_PIX_FMT_NV12 && IsNV12ConversionSupported(m_codecContext->pix_fmt))
+		{
+			m_conversion = Conversion::NV12Converter;
+		}
+		else if (!isDownscaling && IsP01xConversionSupported(m_codecContext->pix_fmt, m_outputFormat))
+		{
+			m_conversion = Conversion::P01xConverter;
+		}
+		else
+		{
+			m_conversion = Conversion::Scaler;
+		}
+
+		FFMPEG_INTEROP_TRACE("Stream %d: Decoder Format = %hs, Output Format = %hs, Conversion = %d",
+			m_stream->index, av_get_pix_fmt_name(m_codecContext->pix_fmt), av_get_pix_fmt_name(m_outputFormat), static_cast<int>(m_conversion));
+
+		if (m_conversion == Conversion::None)
+		{
+			// Lay out buffers the way the decoder needs them, so that it can decode straight into them.
+			// The padding is described to MF through the stride and display aperture.
+			int width{ max(m_frameWidth, AV_CEIL_RSHIFT(m_codecContext->coded_width, m_codecContext->lowres)) };
+			int height{ max(m_frameHeight, AV_CEIL_RSHIFT(m_codecContext->coded_height, m_codecContext->lowres)) };
+			int lineSizeAlignment[AV_NUM_DATA_POINTERS]{ };
+			avcodec_align_dimensions2(m_codecContext.get(), &width, &height, lineSizeAlignment);
+
+			m_bufferWidth = FFALIGN(width, BUFFER_WIDTH_ALIGNMENT);
+			m_bufferHeight = FFALIGN(height, 2);
+		}
+		else
+		{
+			m_bufferWidth = m_outputWidth;
+			m_bufferHeight = m_outputHeight;
+		}
+
+		THROW_HR_IF_FFMPEG_FAILED(av_image_fill_linesizes(m_lineSizes, m_outputFormat, m_bufferWidth));
+
+		uint8_t* data[4]{ };
+		m_bufferSize = av_image_fill_pointers(data, m_outputFormat, m_bufferHeight, nullptr, m_lineSizes);
+		THROW_HR_IF_FFMPEG_FAILED(m_bufferSize);
+
+		// Keep the current contexts in case the stream switches back to this format (e.g. adaptive streams)
+		if (m_bufferPool != nullptr)
+		{
+			m_conversionCache.Put(m_conversionKey, { move(m_swsContext), move(m_bufferPool) });
+		}
+
+		m_conversionKey = { m_codecContext->pix_fmt, m_frameWidth, m_frameHeight, m_outputFormat, m_outputWidth, m_outputHeight, m_bufferWidth, m_bufferHeight };
+
+		optional<ConversionContexts> cachedContexts{ m_conversionCache.Take(m_conversionKey) };
+		FFmpegInteropProvider::ConversionCacheLookup(m_stream->index, cachedContexts.has_value(), m_conversionCache.GetHitCount(), m_conversionCache.GetMissCount());
+
+		if (cachedContexts.has_value())
+		{
+			m_swsContext = move(cachedContexts->swsContext);
+			m_bufferPool = move(cachedContexts->bufferPool);
+			return;
+		}
+
+		if (m_conversion == Conversion::Scaler)
+		{
+			// Setup software scaler to convert the pixel format to the output format and scale to the output size in a single pass.
+			// The scaler creates a context per slice thread internally.
+			m_swsContext.reset(sws_alloc_context());
+			THROW_IF_NULL_ALLOC(m_swsContext);
+
+			SwsContext* swsContext{ m_swsContext.get() };
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_int(swsContext, "srcw", m_frameWidth, 0));
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_int(swsContext, "srch", m_frameHeight, 0));
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_pixel_fmt(swsContext, "src_format", m_codecContext->pix_fmt, 0));
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_int(swsContext, "dstw", m_outputWidth, 0));
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_int(swsContext, "dsth", m_outputHeight, 0));
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_pixel_fmt(swsContext, "dst_format", m_outputFormat, 0));
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_int(swsContext, "sws_flags", isDownscaling ? SWS_BILINEAR : SWS_BICUBIC, 0));
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_int(swsContext, "threads", min(m_maxSliceCount, m_decoderThreads.GetThreadCount()), 0));
+			THROW_HR_IF_FFMPEG_FAILED(sws_init_context(swsContext, nullptr, nullptr));
+		}
+
+		// Create a buffer pool. Decoders may read past the end of the image, so leave as much slack after it as the
+		// default buffers would have after each of their planes.
+		const size_t planeCount{ static_cast<size_t>(av_pix_fmt_count_planes(m_outputFormat)) };
+		m_bufferPool.reset(av_buffer_pool_init(static_cast<size_t>(m_bufferSize) + planeCount * BUFFER_PLANE_PADDING + AV_INPUT_BUFFER_PADDING_SIZE, nullptr));
 		THROW_IF_NULL_ALLOC(m_bufferPool);
 	}
 
+	bool UncompressedVideoSampleProvider::IsZeroCopyFrame(_In_ const AVFrame* frame) const noexcept
+	{
+		// The frame can be passed on as is if its planes are in a single buffer with the layout described to MF
+		if (m_conversion != Conversion::None || frame->format != m_outputFormat || frame->buf[0] == nullptr || frame->buf[1] != nullptr)
+		{
+			return false;
+		}
+
+		uint8_t* data[4]{ };
+		av_image_fill_pointers(data, m_outputFormat, m_bufferHeight, frame->buf[0]->data, m_lineSizes);
+
+		return static_cast<size_t>(m_bufferSize) <= frame->buf[0]->size &&
+			equal(begin(data), end(data), frame->data) &&
+			equal(begin(m_lineSizes), end(m_lineSizes), frame->linesize);
+	}
+
+	vector<pair<GUID, Windows::Foundation::IInspectable>> UncompressedVideoSampleProvider::GetBufferLayoutProperties() const
+	{
+		vector<pair<GUID, Windows::Foundation::IInspectable>> properties;
+
+		// RGB subtypes are bottom-up unless a positive stride is given
+		properties.emplace_back(MF_MT_FRAME_SIZE, PropertyValue::CreateUInt64(Pack2UINT32AsUINT64(m_outputWidth, m_bufferHeight)));
+		properties.emplace_back(MF_MT_DEFAULT_STRIDE, PropertyValue::CreateUInt32(m_lineSizes[0]));
+
+		// Exclude padding rows from display
+		MFVideoArea displayAperture{ };
+		displayAperture.Area.cx = static_cast<LONG>(m_outputWidth);
+		displayAperture.Area.cy = static_cast<LONG>(m_outputHeight);
+
+		const uint8_t* displayApertureBuf{ reinterpret_cast<const uint8_t*>(&displayAperture) };
+		properties.emplace_back(MF_MT_MINIMUM_DISPLAY_APERTURE, PropertyValue::CreateUInt8Array({ displayApertureBuf, displayApertureBuf + sizeof(displayAperture) }));
+
+		return properties;
+	}
+
 	void UncompressedVideoSampleProvider::SetEncodingProperties(_Inout_ const IMediaEncodingProperties& encProp, _In_ bool setFormatUserData)
 	{
 		SampleProvider::SetEncodingProperties(encProp, setFormatUserData);
 
 		VideoEncodingProperties videoEncProp{ encProp.as<VideoEncodingProperties>() };
+		videoEncProp.Subtype(to_hstring(GetOutputSubtype(m_outputFormat)));
 
 		if (m_codecContext->framerate.num != 0 && m_codecContext->framerate.den != 0)
 		{
@@ -81,10 +330,24 @@ namespace winrt::FFmpegInterop::implementation
 		videoProp.Insert(MF_MT_ALL_SAMPLES_INDEPENDENT, PropertyValue::CreateUInt32(true));
 		videoProp.Insert(MF_MT_COMPRESSED, PropertyValue::CreateUInt32(false));
 		videoProp.Insert(MF_MT_INTERLACE_MODE, PropertyValue::CreateUInt32(MFVideoInterlace_MixedInterlaceOrProgressive));
+
+		for (const auto& [key, value] : GetBufferLayoutProperties())
+		{
+			videoProp.Insert(key, value);
+		}
+	}
+
+	void UncompressedVideoSampleProvider::Flush() noexcept
+	{
+		UncompressedSampleProvider::Flush();
+
+		m_lastDecodedPts = AV_NOPTS_VALUE;
 	}
 
-	tuple<IBuffer, int64_t, int64_t, vector<pair<GUID, Windows::Foundation::IInspectable>>, vector<pair<GUID, Windows::Foundation::IInspectable>>> UncompressedVideoSampleProvider::GetSampleData()
+	tuple<IBuffer, int64_t, int64_t, vector<pair<GUID, Windows::Foundation::IInspectable>>, vector<pair<GUID, Windows::Foundation::IInspectable>>> UncompressedVideoSampleProvider::DecodeSampleData()
 	{
+		const chrono::steady_clock::time_point decodeStart{ chrono::steady_clock::now() };
+
 		// Get the next decoded sample
 		AVFrame_ptr frame;
 		uint32_t decodeErrors{ 0 };
@@ -113,7 +376,7 @@ namespace winrt::FFmpegInterop::implementation
 						FFMPEG_INTEROP_TRACE("Stream %d: Decode error. Total decoder errors = %d, Limit = %d",
 							m_stream->index, decodeErrors, m_allowedDecodeErrors);
 
-						m_isDiscontinuous = true;
+						m_isDecodeDiscontinuous = true;
 					}
 					else
 					{
@@ -130,30 +393,70 @@ namespace winrt::FFmpegInterop::implementation
 
 		// Get the sample buffer
 		IBuffer sampleBuf{ nullptr };
-		if (m_swsContext == nullptr)
+		if (IsZeroCopyFrame(frame.get()))
 		{
-			// Image is already in the desired output format
-			sampleBuf = make<FFmpegInteropBuffer>(frame->buf[0]);
+			// Image is already in the desired output format and layout
+			AVFrame_ptr frameRef{ av_frame_clone(frame.get()) };
+			THROW_IF_NULL_ALLOC(frameRef);
+
+			sampleBuf = make<FFmpegInteropBuffer>(move(frameRef), static_cast<uint32_t>(m_bufferSize));
 		}
 		else
 		{
-			// Scale the image to the desired output format
-			AVBufferRef_ptr bufferRef{ av_buffer_pool_get(m_bufferPool.get()) };
-			THROW_IF_NULL_ALLOC(bufferRef);
-
-			uint8_t* data[4]{ };
-			const int requiredBufferSize{ av_image_fill_pointers(data, AV_PIX_FMT_NV12, frame->height, bufferRef->data, m_lineSizes) };
-			THROW_HR_IF_FFMPEG_FAILED(requiredBufferSize);
-			THROW_HR_IF(MF_E_UNEXPECTED, static_cast<size_t>(requiredBufferSize) != bufferRef->size);
+			// Convert the image to the desired output format and layout
+			AVFrame_ptr outputFrame{ av_frame_alloc() };
+			THROW_IF_NULL_ALLOC(outputFrame);
+
+			outputFrame->format = m_outputFormat;
+			outputFrame->width = m_outputWidth;
+			outputFrame->height = m_outputHeight;
+			outputFrame->buf[0] = av_buffer_pool_get(m_bufferPool.get());
+			THROW_IF_NULL_ALLOC(outputFrame->buf[0]);
+			copy(begin(m_lineSizes), end(m_lineSizes), outputFrame->linesize);
+			THROW_HR_IF_FFMPEG_FAILED(av_image_fill_pointers(outputFrame->data, m_outputFormat, m_bufferHeight, outputFrame->buf[0]->data, m_lineSizes));
+
+			if (m_conversion == Conversion::None)
+			{
+				// Planes are in separate buffers or laid out differently than described to MF
+				THROW_HR_IF(MF_E_UNEXPECTED, frame->format != m_outputFormat);
+				av_image_copy(outputFrame->data, m_lineSizes, frame->data, frame->linesize, m_outputFormat, m_outputWidth, m_outputHeight);
+			}
+			else if (m_conversion == Conversion::NV12Converter || m_conversion == Conversion::P01xConverter)
+			{
+				const AVPixelFormat frameFormat{ static_cast<AVPixelFormat>(frame->format) };
+				const auto convert{ m_conversion == Conversion::NV12Converter ? ConvertToNV12 : ConvertToP01x };
+				THROW_HR_IF(MF_E_UNEXPECTED, m_conversion == Conversion::NV12Converter ? !IsNV12ConversionSupported(frameFormat) : !IsP01xConversionSupported(frameFormat, m_outputFormat));
 
-			THROW_HR_IF_FFMPEG_FAILED(sws_scale(m_swsContext.get(), frame->data, frame->linesize, 0, frame->height, data, m_lineSizes));
+				const int sliceCount{ min(m_maxSliceCount, m_decoderThreads.GetThreadCount()) };
+				if (sliceCount > 1)
+				{
+					concurrency::parallel_for(0, sliceCount, [&](int sliceIndex)
+						{
+							convert(frame.get(), outputFrame->data, m_lineSizes, sliceIndex, sliceCount);
+						});
+				}
+				else
+				{
+					convert(frame.get(), outputFrame->data, m_lineSizes, 0, 1);
+				}
+			}
+			else
+			{
+				// Only sws_scale_frame() uses the scaler's slice threads
+				THROW_HR_IF_FFMPEG_FAILED(sws_scale_frame(m_swsContext.get(), outputFrame.get(), frame.get()));
+			}
 
-			sampleBuf = make<FFmpegInteropBuffer>(move(bufferRef));
+			sampleBuf = make<FFmpegInteropBuffer>(move(outputFrame), static_cast<uint32_t>(m_bufferSize));
 		}
 
 		// Get the sample properties
 		vector<pair<GUID, Windows::Foundation::IInspectable>> properties{ GetSampleProperties(frame.get()) };
 
+		if (m_isAdaptiveDecodeQualityEnabled)
+		{
+			UpdateDecodeQuality(frame.get(), chrono::steady_clock::now() - decodeStart);
+		}
+
 		return { move(sampleBuf), frame->best_effort_timestamp, frame->duration, move(properties), move(formatChanges) };
 	}
 
@@ -162,18 +465,23 @@ namespace winrt::FFmpegInterop::implementation
 		vector<pair<GUID, Windows::Foundation::IInspectable>> formatChanges;
 
 		// Check if the resolution changed
-		if (frame->width != m_outputWidth || frame->height != m_outputHeight)
+		if (frame->width != m_frameWidth || frame->height != m_frameHeight)
 		{
 			FFMPEG_INTEROP_TRACE("Stream %d: Resolution change. Old Width = %d, Old Height = %d, New Width = %d, New Height = %d",
-				m_stream->index, m_outputWidth, m_outputHeight, frame->width, frame->height);
+				m_stream->index, m_frameWidth, m_frameHeight, frame->width, frame->height);
+
+			const tuple<int, int, int, int> oldLayout{ m_outputWidth, m_outputHeight, m_bufferHeight, m_lineSizes[0] };
 
-			m_outputWidth = frame->width;
-			m_outputHeight = frame->height;
-			formatChanges.emplace_back(MF_MT_FRAME_SIZE, PropertyValue::CreateUInt64(Pack2UINT32AsUINT64(m_outputWidth, m_outputHeight)));
+			m_frameWidth = frame->width;
+			m_frameHeight = frame->height;
+			tie(m_outputWidth, m_outputHeight) = ScaleToFit(m_frameWidth, m_frameHeight, m_targetWidth, m_targetHeight);
 
-			if (m_swsContext != nullptr)
+			InitConversion();
+
+			// The buffer layout can change even if the output size doesn't
+			if (tuple<int, int, int, int>{ m_outputWidth, m_outputHeight, m_bufferHeight, m_lineSizes[0] } != oldLayout)
 			{
-				InitScaler();
+				formatChanges = GetBufferLayoutProperties();
 			}
 		}
 
@@ -202,4 +510,65 @@ namespace winrt::FFmpegInterop::implementation
 
 		return properties;
 	}
+
+	void UncompressedVideoSampleProvider::UpdateDecodeQuality(_In_ const AVFrame* frame, _In_ chrono::steady_clock::duration decodeTime)
+	{
+		// Compare the time spent decoding and converting with the media time the frame covers.
+		// Frames the decoder skipped count towards the next frame it outputs.
+		int64_t mediaDur{ frame->duration };
+		if (m_lastDecodedPts != AV_NOPTS_VALUE && frame->best_effort_timestamp != AV_NOPTS_VALUE && frame->best_effort_timestamp > m_lastDecodedPts)
+		{
+			mediaDur = frame->best_effort_timestamp - m_lastDecodedPts;
+		}
+
+		m_lastDecodedPts = frame->best_effort_timestamp;
+
+		const int64_t hnsMediaDur{ ConvertFromAVTime(mediaDur, m_stream->time_base, HNS_PER_SEC) };
+		if (hnsMediaDur <= 0)
+		{
+			return;
+		}
+
+		const double load{ static_cast<double>(chrono::duration_cast<TimeSpan>(decodeTime).count()) / hnsMediaDur };
+		m_decodeLoad += DECODE_LOAD_SMOOTHING * (load - m_decodeLoad);
+
+		// Only move one level at a time, and give the decoder time to settle at the new level before moving again
+		const chrono::steady_clock::duration timeAtQuality{ chrono::steady_clock::now() - m_lastDecodeQualityChange };
+
+		if (m_decodeLoad > DECODE_LOAD_HIGH && m_decodeQuality != DecodeQuality::KeyFramesOnly && timeAtQuality >= MIN_DEGRADE_INTERVAL)
+		{
+			SetDecodeQuality(static_cast<DecodeQuality>(static_cast<int>(m_decodeQuality) + 1));
+		}
+		else if (m_decodeLoad < DECODE_LOAD_LOW && m_decodeQuality != DecodeQuality::Full && timeAtQuality >= MIN_RECOVER_INTERVAL)
+		{
+			SetDecodeQuality(static_cast<DecodeQuality>(static_cast<int>(m_decodeQuality) - 1));
+		}
+	}
+
+	void UncompressedVideoSampleProvider::SetDecodeQuality(_In_ DecodeQuality decodeQuality)
+	{
+		FFMPEG_INTEROP_TRACE("Stream %d: Decode quality changed. Old = %d, New = %d, Load = %.2f",
+			m_stream->index, static_cast<int>(m_decodeQuality), static_cast<int>(decodeQuality), m_decodeLoad);
+		FFmpegInteropProvider::DecodeQualityChanged(m_stream->index, static_cast<int32_t>(decodeQuality), m_decodeLoad);
+
+		m_decodeQuality = decodeQuality;
+		m_lastDecodeQualityChange = chrono::steady_clock::now();
+
+		// The decoder picks up these fields on the next packet, including with frame threading
+		m_codecContext->skip_loop_filter = decodeQuality >= DecodeQuality::SkipLoopFilter ? AVDISCARD_ALL : AVDISCARD_DEFAULT;
+		m_codecContext->skip_idct = decodeQuality >= DecodeQuality::SkipIdct ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+
+		if (decodeQuality >= DecodeQuality::KeyFramesOnly)
+		{
+			m_codecContext->skip_frame = AVDISCARD_NONKEY;
+		}
+		else if (decodeQuality >= DecodeQuality::SkipNonReferenceFrames)
+		{
+			m_codecContext->skip_frame = AVDISCARD_NONREF;
+		}
+		else
+		{
+			m_codecContext->skip_frame = AVDISCARD_DEFAULT;
+		}
+	}
 }
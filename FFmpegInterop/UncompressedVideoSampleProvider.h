@@ -19,6 +19,7 @@
 #pragma once
 
 #include "UncompressedSampleProvider.h"
+#include "ConversionCache.h"
 
 namespace winrt::FFmpegInterop::implementation
 {
@@ -26,22 +27,113 @@ namespace winrt::FFmpegInterop::implementation
 		public UncompressedSampleProvider
 	{
 	public:
-		UncompressedVideoSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_ uint32_t allowedDecodeErrors);
+		UncompressedVideoSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext, _In_opt_ const FFmpegInterop::FFmpegInteropMSSConfig& config);
+		~UncompressedVideoSampleProvider() override;
 
 		void SetEncodingProperties(_Inout_ const Windows::Media::MediaProperties::IMediaEncodingProperties& encProp, _In_ bool setFormatUserData) override;
 
 	protected:
-		std::tuple<Windows::Storage::Streams::IBuffer, int64_t, int64_t, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>> GetSampleData() override;
+		void Flush() noexcept override;
+		std::tuple<Windows::Storage::Streams::IBuffer, int64_t, int64_t, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>, std::vector<std::pair<GUID, Windows::Foundation::IInspectable>>> DecodeSampleData() override;
 
 	private:
-		void InitScaler();
+		// How decoded frames are turned into output samples
+		enum class Conversion
+		{
+			None, // Frames are already in the output format and size
+			NV12Converter,
+			P01xConverter,
+			Scaler
+		};
+
+		// Identifies the contexts needed to convert frames
+		struct ConversionKey
+		{
+			AVPixelFormat inputFormat{ AV_PIX_FMT_NONE };
+			int inputWidth{ 0 };
+			int inputHeight{ 0 };
+			AVPixelFormat outputFormat{ AV_PIX_FMT_NONE };
+			int outputWidth{ 0 };
+			int outputHeight{ 0 };
+			int bufferWidth{ 0 };
+			int bufferHeight{ 0 };
+
+			bool operator==(const ConversionKey&) const = default;
+		};
+
+		struct ConversionContexts
+		{
+			SwsContext_ptr swsContext;
+			AVBufferPool_ptr bufferPool;
+		};
+
+		// Decoder work is shed in this order when decoding can't keep up with playback
+		enum class DecodeQuality
+		{
+			Full,
+			SkipLoopFilter,
+			SkipNonReferenceFrames,
+			SkipIdct,
+			KeyFramesOnly
+		};
+
+		static constexpr double DECODE_LOAD_SMOOTHING{ 0.1 };
+		static constexpr double DECODE_LOAD_HIGH{ 0.9 }; // Degrade above this
+		static constexpr double DECODE_LOAD_LOW{ 0.5 }; // Recover below this
+		static constexpr std::chrono::milliseconds MIN_DEGRADE_INTERVAL{ 500 };
+		static constexpr std::chrono::milliseconds MIN_RECOVER_INTERVAL{ 2000 };
+
+		// Frames are converted in parallel slices of at least this many output pixels
+		static constexpr int64_t MIN_SLICE_PIXEL_COUNT{ 1024 * 1024 };
+		static constexpr int64_t MAX_SLICE_COUNT{ 16 };
+
+		// Rows of buffers the decoder decodes into are padded to a multiple of this many pixels, which satisfies the
+		// decoder's stride alignment for every plane while keeping the chroma stride a fixed fraction of the luma stride.
+		static constexpr int BUFFER_WIDTH_ALIGNMENT{ 128 };
+
+		// Slack avcodec_default_get_buffer2() leaves after each plane for SIMD code that reads or writes past it
+		// (16 + STRIDE_ALIGN - 1), using the largest STRIDE_ALIGN FFmpeg builds with.
+		static constexpr size_t BUFFER_PLANE_PADDING{ 16 + 64 - 1 };
+
+		static AVPixelFormat GetOutputFormat(_In_ const hstring& subtype);
+		static GUID GetOutputSubtype(_In_ AVPixelFormat format);
+
+		AVPixelFormat SelectOutputFormat(_In_ AVPixelFormat format) const;
+
+		static int GetBuffer(_In_ AVCodecContext* codecContext, _Inout_ AVFrame* frame, _In_ int flags) noexcept;
+
+		void InitConversion();
+		bool IsZeroCopyFrame(_In_ const AVFrame* frame) const noexcept;
+		std::vector<std::pair<GUID, Windows::Foundation::IInspectable>> GetBufferLayoutProperties() const;
 		std::vector<std::pair<GUID, Windows::Foundation::IInspectable>> CheckForFormatChanges(_In_ const AVFrame* frame);
 		std::vector<std::pair<GUID, Windows::Foundation::IInspectable>> GetSampleProperties(_In_ const AVFrame* frame);
+		void UpdateDecodeQuality(_In_ const AVFrame* frame, _In_ std::chrono::steady_clock::duration decodeTime);
+		void SetDecodeQuality(_In_ DecodeQuality decodeQuality);
 
+		uint32_t m_targetWidth{ 0 };
+		uint32_t m_targetHeight{ 0 };
+		int m_frameWidth{ 0 };
+		int m_frameHeight{ 0 };
 		int m_outputWidth{ 0 };
 		int m_outputHeight{ 0 };
+		std::vector<AVPixelFormat> m_preferredFormats;
+		AVPixelFormat m_outputFormat{ AV_PIX_FMT_NV12 };
+		Conversion m_conversion{ Conversion::None };
 		SwsContext_ptr m_swsContext;
+		int m_maxSliceCount{ 1 };
+		int m_bufferWidth{ 0 }; // Including padding
+		int m_bufferHeight{ 0 }; // Including padding
 		int m_lineSizes[4]{ 0, 0, 0, 0};
+		int m_bufferSize{ 0 }; // Excluding padding
 		AVBufferPool_ptr m_bufferPool;
+		std::mutex m_bufferPoolLock; // GetBuffer() is called on decoder threads
+		ConversionKey m_conversionKey;
+		ConversionCache<ConversionKey, ConversionContexts> m_conversionCache;
+
+		bool m_isAdaptiveDecodeQualityEnabled{ false };
+		DecodeQuality m_decodeQuality{ DecodeQuality::Full };
+		double m_decodeLoad{ 0.0 }; // Smoothed ratio of decode time to media time
+		int64_t m_lastDecodedPts{ AV_NOPTS_VALUE };
+		std::chrono::steady_clock::time_point m_lastDecodeQualityChange;
 	};
 }
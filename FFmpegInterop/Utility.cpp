@@ -1,27 +1,27 @@
-//*****************************************************************************
-//
-//	Copyright 2015 Microsoft Corporation
-//
-//	Licensed under the Apache License, Version 2.0 (the "License");
-//	you may not use this file except in compliance with the License.
-//	You may obtain a copy of the License at
-//
-//	http ://www.apache.org/licenses/LICENSE-2.0
-//
-//	Unless required by applicable law or agreed to in writing, software
-//	distributed under the License is distributed on an "AS IS" BASIS,
-//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
-//	See the License for the specific language governing permissions and
-//	limitations under the License.
-//
-//*****************************************************************************
-
-#include "pch.h"
-#include "Utility.h"
-
-using namespace winrt::Windows::Foundation;
-
-namespace winrt::FFmpegInterop::implementation
+//*****************************************************************************
+//
+//	Copyright 2015 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "Utility.h"
+
+using namespace winrt::Windows::Foundation;
+
+namespace winrt::FFmpegInterop::implementation
 {
 	inline Windows::Foundation::IInspectable CreatePropValueFromMFAttribute(_In_ const PROPVARIANT& propvar)
 	{
@@ -56,5 +56,32 @@ namespace winrt::FFmpegInterop::implementation
 			WINRT_ASSERT(false);
 			THROW_HR(E_UNEXPECTED);
 		}
-	}
-}
+	}
+
+	// Function to read from file stream. Credit to Philipp Sch http://www.codeproject.com/Tips/489450/Creating-Custom-FFmpeg-IO-Context
+	int FileStreamRead(_In_ void* ptr, _Out_writes_bytes_(bufSize) uint8_t* buf, _In_ int bufSize)
+	{
+		IStream* fileStream{ reinterpret_cast<IStream*>(ptr) };
+		ULONG bytesRead{ 0 };
+
+		RETURN_IF_FAILED(fileStream->Read(buf, bufSize, &bytesRead));
+
+		// Assume we've reached EOF if we didn't read any bytes
+		RETURN_HR_IF(static_cast<HRESULT>(AVERROR_EOF), bytesRead == 0);
+
+		return bytesRead;
+	}
+
+	// Function to seek in file stream. Credit to Philipp Sch http://www.codeproject.com/Tips/489450/Creating-Custom-FFmpeg-IO-Context
+	int64_t FileStreamSeek(_In_ void* ptr, _In_ int64_t pos, _In_ int whence)
+	{
+		IStream* fileStream{ reinterpret_cast<IStream*>(ptr) };
+		LARGE_INTEGER in{ 0 };
+		in.QuadPart = pos;
+		ULARGE_INTEGER out{ 0 };
+
+		RETURN_IF_FAILED(fileStream->Seek(in, whence, &out));
+
+		return out.QuadPart;
+	}
+}
@@ -100,6 +100,29 @@ namespace winrt::FFmpegInterop::implementation
 		return static_cast<int64_t>(avTime *  av_q2d(avTimeBase) * unitsPerSec);
 	}
 
+	// Scale video dimensions down to fit within the max dimensions (0 = unconstrained), preserving the aspect ratio.
+	// The result is kept even so it can be used for 4:2:0 formats.
+	inline std::pair<int, int> ScaleToFit(_In_ int width, _In_ int height, _In_ uint32_t maxWidth, _In_ uint32_t maxHeight)
+	{
+		double scale{ 1.0 };
+		if (maxWidth > 0 && static_cast<uint32_t>(width) > maxWidth)
+		{
+			scale = static_cast<double>(maxWidth) / width;
+		}
+
+		if (maxHeight > 0 && static_cast<uint32_t>(height) > maxHeight)
+		{
+			scale = std::min(scale, static_cast<double>(maxHeight) / height);
+		}
+
+		if (scale >= 1.0)
+		{
+			return { width, height };
+		}
+
+		return { std::max(static_cast<int>(width * scale) & ~1, 2), std::max(static_cast<int>(height * scale) & ~1, 2) };
+	}
+
 	// Helper function to map AVERROR to HRESULT
 	inline constexpr HRESULT averror_to_hresult(_In_range_(< , 0) int status) noexcept
 	{
@@ -154,6 +177,10 @@ namespace winrt::FFmpegInterop::implementation
 	// Helper function to create a PropertyValue from an MF attribute
 	extern Windows::Foundation::IInspectable CreatePropValueFromMFAttribute(_In_ const PROPVARIANT& propVar);
 
+	// FFmpeg custom IO callbacks to read and seek an IStream
+	extern int FileStreamRead(_In_ void* ptr, _Out_writes_bytes_(bufSize) uint8_t* buf, _In_ int bufSize);
+	extern int64_t FileStreamSeek(_In_ void* ptr, _In_ int64_t pos, _In_ int whence);
+
 	class MFCallbackBase :
 		public implements<MFCallbackBase, IMFAsyncCallback>
 	{
@@ -305,6 +332,15 @@ namespace winrt::FFmpegInterop::implementation
 	};
 	typedef std::unique_ptr<void, AVBlobDeleter> AVBlob_ptr;
 
+	struct AVBSFContextDeleter
+	{
+		void operator()(_In_opt_ AVBSFContext* bsfContext)
+		{
+			av_bsf_free(&bsfContext);
+		}
+	};
+	typedef std::unique_ptr<AVBSFContext, AVBSFContextDeleter> AVBSFContext_ptr;
+
 	struct AVBufferPoolDeleter
 	{
 		void operator()(_In_opt_ AVBufferPool* bufferPool)
@@ -431,7 +467,8 @@ namespace winrt::FFmpegInterop::implementation
 		{
 			if (this != &other)
 			{
-				std::swap(*this, other);
+				// Swap the C structs. Swapping the wrappers would recurse back into this operator.
+				std::swap(static_cast<AVChannelLayout&>(*this), static_cast<AVChannelLayout&>(other));
 			}
 			return *this;
 		}
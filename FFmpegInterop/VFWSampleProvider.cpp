@@ -27,8 +27,8 @@ using namespace wil;
 
 namespace winrt::FFmpegInterop::implementation
 {
-	VFWSampleProvider::VFWSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader) :
-		SampleProvider(formatContext, stream, reader)
+	VFWSampleProvider::VFWSampleProvider(_In_ const AVFormatContext* formatContext, _In_ AVStream* stream, _In_ Reader& reader, _In_opt_ AVBSFContext_ptr bsfContext) :
+		SampleProvider(formatContext, stream, reader, move(bsfContext))
 	{
 		
 	}
@@ -39,7 +39,7 @@ namespace winrt::FFmpegInterop::implementation
 		// We intentionally don't call SampleProvider::SetEncodingProperties() here. We'll set all of the encoding properties we need.
 
 		// FFmpeg strips the bitmap info header from the codec private data. Recreate it.
-		const AVCodecParameters* codecPar{ m_stream->codecpar };
+		const AVCodecParameters* codecPar{ m_codecPar };
 		vector<uint8_t> vihBuf(sizeof(VIDEOINFOHEADER) + codecPar->extradata_size);
 
 		BITMAPINFOHEADER& bih{ reinterpret_cast<VIDEOINFOHEADER*>(vihBuf.data())->bmiHeader };
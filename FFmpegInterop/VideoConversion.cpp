@@ -0,0 +1,375 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "VideoConversion.h"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <immintrin.h>
+#define FFMPEG_INTEROP_SSE2
+#elif defined(_M_ARM64)
+#include <arm64_neon.h>
+#define FFMPEG_INTEROP_NEON
+#endif
+
+using namespace std;
+
+namespace
+{
+#if defined(FFMPEG_INTEROP_SSE2)
+	bool IsAvx2Supported() noexcept
+	{
+#ifdef PF_AVX2_INSTRUCTIONS_AVAILABLE
+		static const bool isAvx2Supported{ IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE) != FALSE };
+		return isAvx2Supported;
+#else
+		return false;
+#endif
+	}
+#endif
+
+	// dst[2i] = u[i], dst[2i + 1] = v[i]
+	void InterleaveRow(_Out_writes_(2 * count) uint8_t* dst, _In_reads_(count) const uint8_t* u, _In_reads_(count) const uint8_t* v, _In_ int count) noexcept
+	{
+		int i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		if (IsAvx2Supported())
+		{
+			for (; i + 32 <= count; i += 32)
+			{
+				// AVX2 unpacks within 128-bit lanes, so reorder the 64-bit quarters first
+				const __m256i uq{ _mm256_permute4x64_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(u + i)), _MM_SHUFFLE(3, 1, 2, 0)) };
+				const __m256i vq{ _mm256_permute4x64_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i)), _MM_SHUFFLE(3, 1, 2, 0)) };
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i), _mm256_unpacklo_epi8(uq, vq));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i + 32), _mm256_unpackhi_epi8(uq, vq));
+			}
+		}
+
+		for (; i + 16 <= count; i += 16)
+		{
+			const __m128i u16{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + i)) };
+			const __m128i v16{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i)) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), _mm_unpacklo_epi8(u16, v16));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i + 16), _mm_unpackhi_epi8(u16, v16));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		for (; i + 16 <= count; i += 16)
+		{
+			vst2q_u8(dst + 2 * i, uint8x16x2_t{ vld1q_u8(u + i), vld1q_u8(v + i) });
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			dst[2 * i] = u[i];
+			dst[2 * i + 1] = v[i];
+		}
+	}
+
+	// dst[i] = (row0[i] + row1[i] + 1) / 2
+	void AverageRows(_Out_writes_(count) uint8_t* dst, _In_reads_(count) const uint8_t* row0, _In_reads_(count) const uint8_t* row1, _In_ int count) noexcept
+	{
+		int i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		if (IsAvx2Supported())
+		{
+			for (; i + 32 <= count; i += 32)
+			{
+				const __m256i a{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + i)) };
+				const __m256i b{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + i)) };
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_avg_epu8(a, b));
+			}
+		}
+
+		for (; i + 16 <= count; i += 16)
+		{
+			const __m128i a{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i)) };
+			const __m128i b{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i)) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_avg_epu8(a, b));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		for (; i + 16 <= count; i += 16)
+		{
+			vst1q_u8(dst + i, vrhaddq_u8(vld1q_u8(row0 + i), vld1q_u8(row1 + i)));
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			dst[i] = static_cast<uint8_t>((row0[i] + row1[i] + 1) >> 1);
+		}
+	}
+
+	// dst[i] = (src[2i] + src[2i + 1] + 1) / 2. An odd trailing sample is copied.
+	void HalveRow(_Out_writes_(count) uint8_t* dst, _In_ const uint8_t* src, _In_ int srcCount, _In_ int count) noexcept
+	{
+		int i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		const __m128i lowBytes{ _mm_set1_epi16(0x00ff) };
+		for (; i + 8 <= count && 2 * (i + 8) <= srcCount; i += 8)
+		{
+			const __m128i pairs{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i)) };
+			const __m128i even{ _mm_and_si128(pairs, lowBytes) };
+			const __m128i odd{ _mm_srli_epi16(pairs, 8) };
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(_mm_avg_epu16(even, odd), _mm_setzero_si128()));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		for (; i + 16 <= count && 2 * (i + 16) <= srcCount; i += 16)
+		{
+			const uint8x16x2_t pairs{ vld2q_u8(src + 2 * i) };
+			vst1q_u8(dst + i, vrhaddq_u8(pairs.val[0], pairs.val[1]));
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			dst[i] = 2 * i + 1 < srcCount ? static_cast<uint8_t>((src[2 * i] + src[2 * i + 1] + 1) >> 1) : src[2 * i];
+		}
+	}
+
+	// dst[i] = src[i] << shift
+	void ShiftRow16(_Out_writes_(count) uint16_t* dst, _In_reads_(count) const uint16_t* src, _In_ int count, _In_ int shift) noexcept
+	{
+		int i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		const __m128i shiftCount{ _mm_cvtsi32_si128(shift) };
+		if (IsAvx2Supported())
+		{
+			for (; i + 16 <= count; i += 16)
+			{
+				const __m256i s{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)) };
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_sll_epi16(s, shiftCount));
+			}
+		}
+
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i s{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_sll_epi16(s, shiftCount));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		const int16x8_t shiftCount{ vdupq_n_s16(static_cast<int16_t>(shift)) };
+		for (; i + 8 <= count; i += 8)
+		{
+			vst1q_u16(dst + i, vshlq_u16(vld1q_u16(src + i), shiftCount));
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			dst[i] = static_cast<uint16_t>(src[i] << shift);
+		}
+	}
+
+	// dst[2i] = u[i] << shift, dst[2i + 1] = v[i] << shift
+	void InterleaveRow16(_Out_writes_(2 * count) uint16_t* dst, _In_reads_(count) const uint16_t* u, _In_reads_(count) const uint16_t* v, _In_ int count, _In_ int shift) noexcept
+	{
+		int i{ 0 };
+
+#if defined(FFMPEG_INTEROP_SSE2)
+		const __m128i shiftCount{ _mm_cvtsi32_si128(shift) };
+		if (IsAvx2Supported())
+		{
+			for (; i + 16 <= count; i += 16)
+			{
+				// AVX2 unpacks within 128-bit lanes, so reorder the 64-bit quarters first
+				const __m256i uq{ _mm256_permute4x64_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(u + i)), _MM_SHUFFLE(3, 1, 2, 0)) };
+				const __m256i vq{ _mm256_permute4x64_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i)), _MM_SHUFFLE(3, 1, 2, 0)) };
+				const __m256i us{ _mm256_sll_epi16(uq, shiftCount) };
+				const __m256i vs{ _mm256_sll_epi16(vq, shiftCount) };
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i), _mm256_unpacklo_epi16(us, vs));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i + 16), _mm256_unpackhi_epi16(us, vs));
+			}
+		}
+
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i us{ _mm_sll_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(u + i)), shiftCount) };
+			const __m128i vs{ _mm_sll_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i)), shiftCount) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), _mm_unpacklo_epi16(us, vs));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i + 8), _mm_unpackhi_epi16(us, vs));
+		}
+#elif defined(FFMPEG_INTEROP_NEON)
+		const int16x8_t shiftCount{ vdupq_n_s16(static_cast<int16_t>(shift)) };
+		for (; i + 8 <= count; i += 8)
+		{
+			vst2q_u16(dst + 2 * i, uint16x8x2_t{ vshlq_u16(vld1q_u16(u + i), shiftCount), vshlq_u16(vld1q_u16(v + i), shiftCount) });
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			dst[2 * i] = static_cast<uint16_t>(u[i] << shift);
+			dst[2 * i + 1] = static_cast<uint16_t>(v[i] << shift);
+		}
+	}
+}
+
+namespace winrt::FFmpegInterop::implementation
+{
+	bool IsNV12ConversionSupported(_In_ AVPixelFormat format) noexcept
+	{
+		switch (format)
+		{
+		case AV_PIX_FMT_YUV420P:
+		case AV_PIX_FMT_YUVJ420P:
+		case AV_PIX_FMT_YUV422P:
+		case AV_PIX_FMT_YUVJ422P:
+		case AV_PIX_FMT_YUV444P:
+		case AV_PIX_FMT_YUVJ444P:
+			return true;
+
+		default:
+			return false;
+		}
+	}
+
+	void ConvertToNV12(_In_ const AVFrame* frame, _In_reads_(2) uint8_t* const dst[], _In_reads_(2) const int dstLineSizes[], _In_ int sliceIndex, _In_ int sliceCount)
+	{
+		const AVPixFmtDescriptor* desc{ av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format)) };
+		THROW_HR_IF_NULL(MF_E_INVALIDMEDIATYPE, desc);
+		WINRT_ASSERT(IsNV12ConversionSupported(static_cast<AVPixelFormat>(frame->format)));
+
+		const int width{ frame->width };
+		const int height{ frame->height };
+		const int chromaWidth{ AV_CEIL_RSHIFT(width, 1) };
+		const int chromaHeight{ AV_CEIL_RSHIFT(height, 1) };
+		const int srcChromaWidth{ AV_CEIL_RSHIFT(width, desc->log2_chroma_w) };
+		const int srcChromaHeight{ AV_CEIL_RSHIFT(height, desc->log2_chroma_h) };
+		const bool isVerticallySubsampled{ desc->log2_chroma_h > 0 };
+		const bool isHorizontallySubsampled{ desc->log2_chroma_w > 0 };
+
+		// Slices are made of whole chroma rows and the luma rows they cover
+		WINRT_ASSERT(sliceIndex >= 0 && sliceIndex < sliceCount);
+		const int firstChromaRow{ static_cast<int>(static_cast<int64_t>(chromaHeight) * sliceIndex / sliceCount) };
+		const int lastChromaRow{ static_cast<int>(static_cast<int64_t>(chromaHeight) * (sliceIndex + 1) / sliceCount) };
+		const int firstLumaRow{ 2 * firstChromaRow };
+		const int lastLumaRow{ min(2 * lastChromaRow, height) };
+
+		// Luma is a straight copy
+		av_image_copy_plane(
+			dst[0] + static_cast<ptrdiff_t>(firstLumaRow) * dstLineSizes[0],
+			dstLineSizes[0],
+			frame->data[0] + static_cast<ptrdiff_t>(firstLumaRow) * frame->linesize[0],
+			frame->linesize[0],
+			width,
+			lastLumaRow - firstLumaRow);
+
+		// Scratch rows for chroma that needs to be filtered before it's interleaved
+		vector<uint8_t> scratch;
+		if (!isVerticallySubsampled || !isHorizontallySubsampled)
+		{
+			scratch.resize(4 * static_cast<size_t>(srcChromaWidth));
+		}
+
+		uint8_t* uRow{ scratch.data() };
+		uint8_t* vRow{ uRow + srcChromaWidth };
+		uint8_t* uHalf{ vRow + srcChromaWidth };
+		uint8_t* vHalf{ uHalf + srcChromaWidth };
+
+		for (int y{ firstChromaRow }; y < lastChromaRow; y++)
+		{
+			const uint8_t* u{ frame->data[1] + static_cast<ptrdiff_t>(isVerticallySubsampled ? y : 2 * y) * frame->linesize[1] };
+			const uint8_t* v{ frame->data[2] + static_cast<ptrdiff_t>(isVerticallySubsampled ? y : 2 * y) * frame->linesize[2] };
+
+			if (!isVerticallySubsampled)
+			{
+				// Average each pair of chroma rows. The last row of an odd height frame is used as is.
+				if (2 * y + 1 < srcChromaHeight)
+				{
+					AverageRows(uRow, u, u + frame->linesize[1], srcChromaWidth);
+					AverageRows(vRow, v, v + frame->linesize[2], srcChromaWidth);
+					u = uRow;
+					v = vRow;
+				}
+			}
+
+			if (!isHorizontallySubsampled)
+			{
+				HalveRow(uHalf, u, srcChromaWidth, chromaWidth);
+				HalveRow(vHalf, v, srcChromaWidth, chromaWidth);
+				u = uHalf;
+				v = vHalf;
+			}
+
+			InterleaveRow(dst[1] + static_cast<ptrdiff_t>(y) * dstLineSizes[1], u, v, chromaWidth);
+		}
+	}
+
+	bool IsP01xConversionSupported(_In_ AVPixelFormat format, _In_ AVPixelFormat outputFormat) noexcept
+	{
+		switch (format)
+		{
+		case AV_PIX_FMT_YUV420P9LE:
+		case AV_PIX_FMT_YUV420P10LE:
+		case AV_PIX_FMT_YUV420P12LE:
+		case AV_PIX_FMT_YUV420P14LE:
+		case AV_PIX_FMT_YUV420P16LE:
+			break;
+
+		default:
+			return false;
+		}
+
+		// P010 only has room for 10 significant bits. P016 holds any depth.
+		return outputFormat == AV_PIX_FMT_P016LE || (outputFormat == AV_PIX_FMT_P010LE && av_pix_fmt_desc_get(format)->comp[0].depth <= 10);
+	}
+
+	void ConvertToP01x(_In_ const AVFrame* frame, _In_reads_(2) uint8_t* const dst[], _In_reads_(2) const int dstLineSizes[], _In_ int sliceIndex, _In_ int sliceCount)
+	{
+		const AVPixFmtDescriptor* desc{ av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format)) };
+		THROW_HR_IF_NULL(MF_E_INVALIDMEDIATYPE, desc);
+		WINRT_ASSERT(IsP01xConversionSupported(static_cast<AVPixelFormat>(frame->format), AV_PIX_FMT_P016LE));
+
+		const int shift{ 16 - desc->comp[0].depth };
+		const int width{ frame->width };
+		const int height{ frame->height };
+		const int chromaWidth{ AV_CEIL_RSHIFT(width, 1) };
+		const int chromaHeight{ AV_CEIL_RSHIFT(height, 1) };
+
+		// Slices are made of whole chroma rows and the luma rows they cover
+		WINRT_ASSERT(sliceIndex >= 0 && sliceIndex < sliceCount);
+		const int firstChromaRow{ static_cast<int>(static_cast<int64_t>(chromaHeight) * sliceIndex / sliceCount) };
+		const int lastChromaRow{ static_cast<int>(static_cast<int64_t>(chromaHeight) * (sliceIndex + 1) / sliceCount) };
+		const int firstLumaRow{ 2 * firstChromaRow };
+		const int lastLumaRow{ min(2 * lastChromaRow, height) };
+
+		for (int y{ firstLumaRow }; y < lastLumaRow; y++)
+		{
+			ShiftRow16(
+				reinterpret_cast<uint16_t*>(dst[0] + static_cast<ptrdiff_t>(y) * dstLineSizes[0]),
+				reinterpret_cast<const uint16_t*>(frame->data[0] + static_cast<ptrdiff_t>(y) * frame->linesize[0]),
+				width,
+				shift);
+		}
+
+		for (int y{ firstChromaRow }; y < lastChromaRow; y++)
+		{
+			InterleaveRow16(
+				reinterpret_cast<uint16_t*>(dst[1] + static_cast<ptrdiff_t>(y) * dstLineSizes[1]),
+				reinterpret_cast<const uint16_t*>(frame->data[1] + static_cast<ptrdiff_t>(y) * frame->linesize[1]),
+				reinterpret_cast<const uint16_t*>(frame->data[2] + static_cast<ptrdiff_t>(y) * frame->linesize[2]),
+				chromaWidth,
+				shift);
+		}
+	}
+}
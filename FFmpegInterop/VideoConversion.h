@@ -0,0 +1,36 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+namespace winrt::FFmpegInterop::implementation
+{
+	// Returns true if ConvertToNV12() can convert frames in this pixel format
+	bool IsNV12ConversionSupported(_In_ AVPixelFormat format) noexcept;
+
+	// Converts a planar 4:2:0, 4:2:2, or 4:4:4 frame to NV12 of the same size. Subsampled chroma is box filtered.
+	// The frame can be split into horizontal slices that are converted independently (e.g. in parallel).
+	void ConvertToNV12(_In_ const AVFrame* frame, _In_reads_(2) uint8_t* const dst[], _In_reads_(2) const int dstLineSizes[], _In_ int sliceIndex, _In_ int sliceCount);
+
+	// Returns true if ConvertToP01x() can convert frames in this pixel format to the output format, which must be P010 or P016
+	bool IsP01xConversionSupported(_In_ AVPixelFormat format, _In_ AVPixelFormat outputFormat) noexcept;
+
+	// Repacks a planar 4:2:0 frame with 9 to 16 bit samples to P010/P016 of the same size, shifting samples to the
+	// most significant bits. Slices work the same as for ConvertToNV12().
+	void ConvertToP01x(_In_ const AVFrame* frame, _In_reads_(2) uint8_t* const dst[], _In_reads_(2) const int dstLineSizes[], _In_ int sliceIndex, _In_ int sliceCount);
+}
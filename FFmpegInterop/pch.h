@@ -36,6 +36,7 @@
 #include <winrt/Windows.Media.Core.h>
 #include <winrt/Windows.Media.MediaProperties.h>
 #include <robuffer.h>
+#include <ppl.h>
 
 // Windows
 #include <Windows.h>
@@ -76,10 +77,12 @@ typedef struct _MT_CUSTOM_VIDEO_PRIMARIES {
 extern "C"
 {
 #include <libavcodec/avcodec.h>
+#include <libavcodec/bsf.h>
 #include <libavformat/avformat.h>
 #include <libavutil/log.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/mastering_display_metadata.h>
+#include <libavutil/opt.h>
 #include <libswresample/swresample.h>
 #include <libswscale/swscale.h>
 }
@@ -90,11 +93,19 @@ extern "C"
 #include <memory>
 #include <functional>
 #include <deque>
+#include <list>
 #include <map>
 #include <mutex>
 #include <tuple>
 #include <limits>
 #include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+#include <optional>
+#include <atomic>
+#include <array>
+#include <cmath>
 
 // FFmpegInterop
 #include "Tracing.h"
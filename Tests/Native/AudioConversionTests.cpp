@@ -0,0 +1,411 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "AudioConversion.h"
+
+using namespace FFmpegInteropNativeTests;
+using namespace winrt::FFmpegInterop::implementation;
+using namespace std;
+
+namespace
+{
+	constexpr AVSampleFormat INTERLEAVE_INPUT_FORMATS[]
+	{
+		AV_SAMPLE_FMT_S16,
+		AV_SAMPLE_FMT_S16P,
+		AV_SAMPLE_FMT_S32,
+		AV_SAMPLE_FMT_S32P,
+		AV_SAMPLE_FMT_FLT,
+		AV_SAMPLE_FMT_FLTP
+	};
+
+	// Channel counts with and without dedicated kernels, up to the maximum
+	constexpr int CHANNEL_COUNTS[]{ 1, 2, 3, 6, 8, 11, 64 };
+
+	// Sample counts shorter than a vector register, with and without a tail, and a typical codec frame
+	constexpr int SAMPLE_COUNTS[]{ 1, 7, 8, 31, 300, 1024 };
+
+	constexpr int SAMPLE_RATE{ 48000 };
+
+	// Samples in one buffer per plane, and the plane pointers to pass to the converters
+	struct SampleBuffers
+	{
+		vector<vector<uint8_t>> planes;
+		vector<const uint8_t*> data;
+	};
+
+	// Allocates random samples. Float samples range a bit past full scale so that clipping is tested, and start with
+	// values that land exactly between two S16 values so that rounding is tested.
+	SampleBuffers CreateRandomSamples(_In_ AVSampleFormat format, _In_ int channels, _In_ int sampleCount, _In_ uint32_t seed)
+	{
+		const bool isPlanar{ av_sample_fmt_is_planar(format) != 0 };
+		const size_t planeSampleCount{ static_cast<size_t>(sampleCount) * (isPlanar ? 1 : channels) };
+
+		SampleBuffers samples;
+		samples.planes.resize(isPlanar ? channels : 1);
+		for (vector<uint8_t>& plane : samples.planes)
+		{
+			plane.resize(planeSampleCount * av_get_bytes_per_sample(format));
+
+			if (av_get_packed_sample_fmt(format) == AV_SAMPLE_FMT_FLT)
+			{
+				constexpr float SPECIAL_VALUES[]{ 0.5f / 32768, -0.5f / 32768, 1.5f / 32768, 1.0f, -1.0f, 2.0f, -2.0f };
+
+				mt19937 generator{ seed++ };
+				uniform_real_distribution<float> distribution{ -1.5f, 1.5f };
+				float* floatSamples{ reinterpret_cast<float*>(plane.data()) };
+				for (size_t i{ 0 }; i < planeSampleCount; i++)
+				{
+					floatSamples[i] = i < size(SPECIAL_VALUES) ? SPECIAL_VALUES[i] : distribution(generator);
+				}
+			}
+			else
+			{
+				FillRandom(plane.data(), plane.size(), seed++);
+			}
+
+			samples.data.push_back(plane.data());
+		}
+
+		return samples;
+	}
+
+	vector<uint8_t> ConvertWithKernel(_In_ const SampleBuffers& samples, _In_ AVSampleFormat inputFormat, _In_ AVSampleFormat outputFormat, _In_ int channels, _In_ int sampleCount)
+	{
+		vector<uint8_t> output(static_cast<size_t>(av_get_bytes_per_sample(outputFormat)) * channels * sampleCount);
+		ConvertToInterleaved(output.data(), outputFormat, samples.data.data(), inputFormat, channels, sampleCount);
+		return output;
+	}
+
+	SwrContext_ptr CreateResampler(_In_ AVSampleFormat inputFormat, _In_ AVSampleFormat outputFormat, _In_ int channels)
+	{
+		const AVChannelLayoutWrapper channelLayout{ channels };
+
+		SwrContext* swrContext{ nullptr };
+		THROW_HR_IF_FFMPEG_FAILED(swr_alloc_set_opts2(
+			&swrContext,
+			&channelLayout,
+			outputFormat,
+			SAMPLE_RATE,
+			&channelLayout,
+			inputFormat,
+			SAMPLE_RATE,
+			0,
+			nullptr));
+		SwrContext_ptr swrContextOwner{ swrContext };
+
+		THROW_HR_IF_FFMPEG_FAILED(swr_init(swrContext));
+		return swrContextOwner;
+	}
+
+	// Converts samples the way UncompressedAudioSampleProvider does when the kernels can't
+	vector<uint8_t> ConvertWithSwresample(_In_ const SampleBuffers& samples, _In_ AVSampleFormat inputFormat, _In_ AVSampleFormat outputFormat, _In_ int channels, _In_ int sampleCount)
+	{
+		SwrContext_ptr swrContext{ CreateResampler(inputFormat, outputFormat, channels) };
+
+		vector<uint8_t> output(static_cast<size_t>(av_get_bytes_per_sample(outputFormat)) * channels * sampleCount);
+		uint8_t* outputData{ output.data() };
+		VERIFY(swr_convert(swrContext.get(), &outputData, sampleCount, const_cast<const uint8_t**>(samples.data.data()), sampleCount) == sampleCount);
+
+		return output;
+	}
+}
+
+NATIVE_TEST(Interleave_SupportedFormats)
+{
+	for (AVSampleFormat inputFormat : INTERLEAVE_INPUT_FORMATS)
+	{
+		for (AVSampleFormat outputFormat : { AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_FLT })
+		{
+			VERIFY(IsInterleavedConversionSupported(inputFormat, outputFormat, 1));
+			VERIFY(IsInterleavedConversionSupported(inputFormat, outputFormat, 64));
+			VERIFY(!IsInterleavedConversionSupported(inputFormat, outputFormat, 0));
+			VERIFY(!IsInterleavedConversionSupported(inputFormat, outputFormat, 65));
+		}
+
+		VERIFY(!IsInterleavedConversionSupported(inputFormat, AV_SAMPLE_FMT_S16P, 2));
+		VERIFY(!IsInterleavedConversionSupported(inputFormat, AV_SAMPLE_FMT_DBL, 2));
+	}
+
+	VERIFY(!IsInterleavedConversionSupported(AV_SAMPLE_FMT_U8, AV_SAMPLE_FMT_S16, 2));
+	VERIFY(!IsInterleavedConversionSupported(AV_SAMPLE_FMT_DBLP, AV_SAMPLE_FMT_FLT, 2));
+}
+
+// Conversions to S16 and FLT, and S16/S32 to S32, must match swresample bit for bit
+NATIVE_TEST(Interleave_MatchesSwresample)
+{
+	for (AVSampleFormat inputFormat : INTERLEAVE_INPUT_FORMATS)
+	{
+		for (AVSampleFormat outputFormat : { AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_FLT })
+		{
+			if (outputFormat == AV_SAMPLE_FMT_S32 && av_get_packed_sample_fmt(inputFormat) == AV_SAMPLE_FMT_FLT)
+			{
+				continue;
+			}
+
+			for (int channels : CHANNEL_COUNTS)
+			{
+				for (int sampleCount : SAMPLE_COUNTS)
+				{
+					const SampleBuffers samples{ CreateRandomSamples(inputFormat, channels, sampleCount, static_cast<uint32_t>(channels * sampleCount)) };
+					const vector<uint8_t> expected{ ConvertWithSwresample(samples, inputFormat, outputFormat, channels, sampleCount) };
+					const vector<uint8_t> actual{ ConvertWithKernel(samples, inputFormat, outputFormat, channels, sampleCount) };
+					VERIFY(actual == expected);
+				}
+			}
+		}
+	}
+}
+
+// Float to S32 conversions produce 24-bit samples in the high bits, which swresample doesn't do
+NATIVE_TEST(Interleave_FloatToS32)
+{
+	for (AVSampleFormat inputFormat : { AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_FLTP })
+	{
+		for (int channels : CHANNEL_COUNTS)
+		{
+			for (int sampleCount : SAMPLE_COUNTS)
+			{
+				const SampleBuffers samples{ CreateRandomSamples(inputFormat, channels, sampleCount, static_cast<uint32_t>(channels + sampleCount)) };
+				const vector<uint8_t> actual{ ConvertWithKernel(samples, inputFormat, AV_SAMPLE_FMT_S32, channels, sampleCount) };
+				const int32_t* actualSamples{ reinterpret_cast<const int32_t*>(actual.data()) };
+
+				for (int i{ 0 }; i < sampleCount; i++)
+				{
+					for (int channel{ 0 }; channel < channels; channel++)
+					{
+						const float sample{ inputFormat == AV_SAMPLE_FMT_FLTP ?
+							reinterpret_cast<const float*>(samples.data[channel])[i] :
+							reinterpret_cast<const float*>(samples.data[0])[i * channels + channel] };
+						const long expected{ clamp(lrintf(sample * 8388608.0f), -8388608L, 8388607L) * 256 };
+						VERIFY(actualSamples[i * channels + channel] == expected);
+					}
+				}
+			}
+		}
+	}
+}
+
+// One second of 48 kHz audio in 1024-sample frames, for every channel count, must not allocate. The kernels used to
+// allocate scratch space on every call.
+NATIVE_TEST(Interleave_DoesNotAllocate)
+{
+	constexpr int FRAME_SAMPLE_COUNT{ 1024 };
+	constexpr int FRAME_COUNT{ SAMPLE_RATE / FRAME_SAMPLE_COUNT };
+
+	for (AVSampleFormat inputFormat : INTERLEAVE_INPUT_FORMATS)
+	{
+		for (AVSampleFormat outputFormat : { AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_FLT })
+		{
+			for (int channels : CHANNEL_COUNTS)
+			{
+				const SampleBuffers samples{ CreateRandomSamples(inputFormat, channels, FRAME_SAMPLE_COUNT, 1) };
+				vector<uint8_t> output(static_cast<size_t>(av_get_bytes_per_sample(outputFormat)) * channels * FRAME_SAMPLE_COUNT);
+
+				const size_t allocationCount{ GetAllocationCount() };
+				for (int frame{ 0 }; frame < FRAME_COUNT; frame++)
+				{
+					ConvertToInterleaved(output.data(), outputFormat, samples.data.data(), inputFormat, channels, FRAME_SAMPLE_COUNT);
+				}
+
+				VERIFY(GetAllocationCount() == allocationCount);
+			}
+		}
+	}
+}
+
+// Levels are accumulated in whole groups of vectors that span a whole number of frames, with a scalar tail. Peaks must
+// match the scalar loop exactly. Sums of squares are accumulated in float within a group, so they only need to be close.
+NATIVE_TEST(AccumulateLevels_MatchesScalar)
+{
+	// Every group size from 1 to 5 vectors, and a count that falls back to the scalar loop
+	constexpr int LEVEL_CHANNEL_COUNTS[]{ 1, 2, 3, 4, 6, 8, 10, 11, 16 };
+
+	for (AVSampleFormat format : { AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_FLT })
+	{
+		for (int channels : LEVEL_CHANNEL_COUNTS)
+		{
+			for (int sampleCount : SAMPLE_COUNTS)
+			{
+				const SampleBuffers samples{ CreateRandomSamples(format, channels, sampleCount, static_cast<uint32_t>(channels * sampleCount)) };
+
+				vector<float> expectedPeak(channels);
+				vector<double> expectedSumOfSquares(channels);
+				const float scale{ format == AV_SAMPLE_FMT_S16 ? 1.0f / 32768.0f : (format == AV_SAMPLE_FMT_S32 ? 1.0f / 2147483648.0f : 1.0f) };
+				for (int i{ 0 }; i < sampleCount; i++)
+				{
+					for (int channel{ 0 }; channel < channels; channel++)
+					{
+						const size_t index{ static_cast<size_t>(i) * channels + channel };
+						const float value{ format == AV_SAMPLE_FMT_S16 ? reinterpret_cast<const int16_t*>(samples.data[0])[index] :
+							(format == AV_SAMPLE_FMT_S32 ? static_cast<float>(reinterpret_cast<const int32_t*>(samples.data[0])[index]) :
+							reinterpret_cast<const float*>(samples.data[0])[index]) };
+						expectedPeak[channel] = max(expectedPeak[channel], abs(value) * scale);
+						expectedSumOfSquares[channel] += static_cast<double>(value) * value * scale * scale;
+					}
+				}
+
+				vector<float> actualPeak(channels);
+				vector<double> actualSumOfSquares(channels);
+				AccumulateLevels(actualPeak.data(), actualSumOfSquares.data(), samples.data[0], format, channels, sampleCount);
+
+				VERIFY(actualPeak == expectedPeak);
+				for (int channel{ 0 }; channel < channels; channel++)
+				{
+					VERIFY(abs(actualSumOfSquares[channel] - expectedSumOfSquares[channel]) <= 1e-5 * expectedSumOfSquares[channel]);
+				}
+			}
+		}
+	}
+}
+
+// Big-endian 24-bit PCM is swapped 5 samples per vector on x86/x64 and 16 on ARM64, with a scalar tail
+NATIVE_TEST(ByteSwap24_MatchesScalar)
+{
+	for (size_t sampleCount : { 0, 1, 5, 6, 7, 15, 16, 17, 31, 1000 })
+	{
+		vector<uint8_t> samples(3 * sampleCount);
+		FillRandom(samples.data(), samples.size(), static_cast<uint32_t>(sampleCount));
+
+		vector<uint8_t> expected(samples.size());
+		for (size_t i{ 0 }; i < sampleCount; i++)
+		{
+			expected[3 * i] = samples[3 * i + 2];
+			expected[3 * i + 1] = samples[3 * i + 1];
+			expected[3 * i + 2] = samples[3 * i];
+		}
+
+		vector<uint8_t> actual(samples.size());
+		ByteSwap24(actual.data(), samples.data(), sampleCount);
+		VERIFY(actual == expected);
+
+		// Swapping in place must work too
+		ByteSwap24(samples.data(), samples.data(), sampleCount);
+		VERIFY(samples == expected);
+	}
+}
+
+// 10 seconds of 192 kHz 24-bit stereo PCM, the heaviest big-endian format PCMSampleProvider repacks
+NATIVE_BENCHMARK(ByteSwap24_192kHz_Stereo)
+{
+	constexpr int RUN_COUNT{ 10 };
+	constexpr size_t SAMPLE_COUNT{ 10 * 192000 * 2 };
+
+	vector<uint8_t> samples(3 * SAMPLE_COUNT);
+	FillRandom(samples.data(), samples.size(), 1);
+	vector<uint8_t> output(samples.size());
+
+	const double kernelTime{ MeasureMilliseconds(RUN_COUNT, [&]()
+		{
+			ByteSwap24(output.data(), samples.data(), SAMPLE_COUNT);
+		}) };
+
+	const double scalarTime{ MeasureMilliseconds(RUN_COUNT, [&]()
+		{
+			for (size_t i{ 0 }; i < SAMPLE_COUNT; i++)
+			{
+				output[3 * i] = samples[3 * i + 2];
+				output[3 * i + 1] = samples[3 * i + 1];
+				output[3 * i + 2] = samples[3 * i];
+			}
+		}) };
+
+	printf("  kernel %7.3f ms  scalar %7.3f ms per 10 s of audio  (%.1fx)\n", kernelTime, scalarTime, scalarTime / kernelTime);
+}
+
+// 10 seconds of 48 kHz 5.1 and 7.1 audio converted in 1024-sample frames, the way a decoder produces it
+NATIVE_BENCHMARK(Interleave_KernelVsSwresample_48kHz)
+{
+	constexpr int RUN_COUNT{ 10 };
+	constexpr int FRAME_SAMPLE_COUNT{ 1024 };
+	constexpr int FRAME_COUNT{ 10 * SAMPLE_RATE / FRAME_SAMPLE_COUNT };
+
+	for (int channels : { 6, 8 })
+	{
+		for (AVSampleFormat inputFormat : { AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_S32P })
+		{
+			for (AVSampleFormat outputFormat : { AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_FLT })
+			{
+				const SampleBuffers samples{ CreateRandomSamples(inputFormat, channels, FRAME_SAMPLE_COUNT, 1) };
+				vector<uint8_t> output(static_cast<size_t>(av_get_bytes_per_sample(outputFormat)) * channels * FRAME_SAMPLE_COUNT);
+
+				const double kernelTime{ MeasureMilliseconds(RUN_COUNT, [&]()
+					{
+						for (int frame{ 0 }; frame < FRAME_COUNT; frame++)
+						{
+							ConvertToInterleaved(output.data(), outputFormat, samples.data.data(), inputFormat, channels, FRAME_SAMPLE_COUNT);
+						}
+					}) };
+
+				SwrContext_ptr swrContext{ CreateResampler(inputFormat, outputFormat, channels) };
+				uint8_t* outputData{ output.data() };
+
+				const double swresampleTime{ MeasureMilliseconds(RUN_COUNT, [&]()
+					{
+						for (int frame{ 0 }; frame < FRAME_COUNT; frame++)
+						{
+							swr_convert(swrContext.get(), &outputData, FRAME_SAMPLE_COUNT, const_cast<const uint8_t**>(samples.data.data()), FRAME_SAMPLE_COUNT);
+						}
+					}) };
+
+				printf("  %d ch  %-4s -> %-3s  kernel %7.3f ms  swresample %7.3f ms per 10 s of audio  (%.1fx)\n",
+					channels, av_get_sample_fmt_name(inputFormat), av_get_sample_fmt_name(outputFormat), kernelTime, swresampleTime, swresampleTime / kernelTime);
+			}
+		}
+	}
+}
+
+// 10 seconds of 48 kHz float audio measured in 1024-sample frames, the way levels are measured as samples are output
+NATIVE_BENCHMARK(AccumulateLevels_KernelVsScalar_48kHz)
+{
+	constexpr int RUN_COUNT{ 10 };
+	constexpr int FRAME_SAMPLE_COUNT{ 1024 };
+	constexpr int FRAME_COUNT{ 10 * SAMPLE_RATE / FRAME_SAMPLE_COUNT };
+
+	for (int channels : { 2, 6, 8 })
+	{
+		const SampleBuffers samples{ CreateRandomSamples(AV_SAMPLE_FMT_FLT, channels, FRAME_SAMPLE_COUNT, 1) };
+		const float* src{ reinterpret_cast<const float*>(samples.data[0]) };
+		vector<float> peak(channels);
+		vector<double> sumOfSquares(channels);
+
+		const double kernelTime{ MeasureMilliseconds(RUN_COUNT, [&]()
+			{
+				for (int frame{ 0 }; frame < FRAME_COUNT; frame++)
+				{
+					AccumulateLevels(peak.data(), sumOfSquares.data(), samples.data[0], AV_SAMPLE_FMT_FLT, channels, FRAME_SAMPLE_COUNT);
+				}
+			}) };
+
+		const double scalarTime{ MeasureMilliseconds(RUN_COUNT, [&]()
+			{
+				for (int frame{ 0 }; frame < FRAME_COUNT; frame++)
+				{
+					for (int i{ 0 }; i < FRAME_SAMPLE_COUNT * channels; i++)
+					{
+						const int channel{ i % channels };
+						peak[channel] = max(peak[channel], abs(src[i]));
+						sumOfSquares[channel] += static_cast<double>(src[i]) * src[i];
+					}
+				}
+			}) };
+
+		printf("  %d ch  kernel %7.3f ms  scalar %7.3f ms per 10 s of audio  (%.1fx)\n", channels, kernelTime, scalarTime, scalarTime / kernelTime);
+	}
+}
@@ -0,0 +1,260 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "AudioOutputBufferPool.h"
+#include "AudioConversion.h"
+
+using namespace FFmpegInteropNativeTests;
+using namespace winrt::FFmpegInterop::implementation;
+using namespace std;
+
+namespace
+{
+	constexpr int SAMPLE_RATE{ 48000 };
+	constexpr int CHANNELS{ 2 };
+	constexpr int FRAME_SAMPLE_COUNT{ 1024 }; // AAC
+	constexpr int SAMPLE_DURATION_MS{ 200 };
+	constexpr size_t BLOCK_ALIGN{ CHANNELS * sizeof(int16_t) };
+
+	// Samples the pipeline holds on to downstream of the provider while they wait to be rendered
+	constexpr size_t QUEUED_SAMPLE_COUNT{ 4 };
+
+	// Allocations made while decoding some audio. The FFmpeg count is the buffers allocated to hold output samples. It
+	// doesn't include the small references FFmpeg allocates to hand out pooled buffers, or the decoder's own allocations.
+	struct AllocationCounts
+	{
+		uint64_t ffmpeg{ 0 };
+		uint64_t heap{ 0 };
+	};
+
+	// Planar float frames, which is what most audio decoders output
+	vector<vector<float>> CreateFrame()
+	{
+		vector<vector<float>> planes(CHANNELS, vector<float>(FRAME_SAMPLE_COUNT));
+		for (int channel{ 0 }; channel < CHANNELS; channel++)
+		{
+			FillRandom(reinterpret_cast<uint8_t*>(planes[channel].data()), planes[channel].size() * sizeof(float), channel);
+			for (float& sample : planes[channel])
+			{
+				// Random bytes can be NaN, which swresample and the kernels are free to convert differently
+				sample = isfinite(sample) ? clamp(sample, -1.0f, 1.0f) : 0.0f;
+			}
+		}
+
+		return planes;
+	}
+
+	// Compacts frames into samples the way UncompressedAudioSampleProvider::DecodeSampleData() does, converting each
+	// frame straight into a pooled output buffer. skipFrameCount frames are decoded before counting starts.
+	AllocationCounts DecodeWithBufferPool(_In_ int frameCount, _In_ int skipFrameCount)
+	{
+		const vector<vector<float>> planes{ CreateFrame() };
+		const uint8_t* frameData[CHANNELS]{ };
+		for (int channel{ 0 }; channel < CHANNELS; channel++)
+		{
+			frameData[channel] = reinterpret_cast<const uint8_t*>(planes[channel].data());
+		}
+
+		// Sized the same way as UncompressedAudioSampleProvider::InitConversion()
+		constexpr size_t bufferSize{ (SAMPLE_DURATION_MS * SAMPLE_RATE / 1000 + 2048) * BLOCK_ALIGN };
+		AudioOutputBufferPool pool{ 0 };
+		pool.Init(bufferSize);
+
+		AVBufferRef_ptr queuedSamples[QUEUED_SAMPLE_COUNT];
+		size_t nextQueuedSample{ 0 };
+		AVBufferRef_ptr outputBuf;
+		size_t outputSize{ 0 };
+		int compactedSampleCount{ 0 };
+
+		uint64_t poolAllocationCount{ 0 };
+		size_t heapAllocationCount{ 0 };
+		for (int frame{ 0 }; frame < frameCount; frame++)
+		{
+			if (frame == skipFrameCount)
+			{
+				poolAllocationCount = pool.GetAllocationCount();
+				heapAllocationCount = GetAllocationCount();
+			}
+
+			pool.Reserve(outputBuf, outputSize, FRAME_SAMPLE_COUNT * BLOCK_ALIGN);
+			ConvertToInterleaved(outputBuf->data + outputSize, AV_SAMPLE_FMT_S16, frameData, AV_SAMPLE_FMT_FLTP, CHANNELS, FRAME_SAMPLE_COUNT);
+			outputSize += FRAME_SAMPLE_COUNT * BLOCK_ALIGN;
+			compactedSampleCount += FRAME_SAMPLE_COUNT;
+
+			if (compactedSampleCount >= SAMPLE_DURATION_MS * SAMPLE_RATE / 1000)
+			{
+				// Hand off the sample. The oldest queued sample has been rendered by now, which returns its buffer to the pool.
+				queuedSamples[nextQueuedSample] = move(outputBuf);
+				nextQueuedSample = (nextQueuedSample + 1) % QUEUED_SAMPLE_COUNT;
+				outputSize = 0;
+				compactedSampleCount = 0;
+			}
+		}
+
+		return { pool.GetAllocationCount() - poolAllocationCount, GetAllocationCount() - heapAllocationCount };
+	}
+
+	// Compacts frames into samples the way DecodeSampleData() did before output buffers were pooled: each frame was
+	// resampled into a buffer from av_samples_alloc() and then appended to a vector that became the sample's buffer.
+	AllocationCounts DecodeWithSampleVector(_In_ int frameCount, _In_ int skipFrameCount)
+	{
+		const vector<vector<float>> planes{ CreateFrame() };
+		const uint8_t* frameData[CHANNELS]{ };
+		for (int channel{ 0 }; channel < CHANNELS; channel++)
+		{
+			frameData[channel] = reinterpret_cast<const uint8_t*>(planes[channel].data());
+		}
+
+		const AVChannelLayoutWrapper channelLayout{ CHANNELS };
+
+		SwrContext* swrContext{ nullptr };
+		THROW_HR_IF_FFMPEG_FAILED(swr_alloc_set_opts2(
+			&swrContext,
+			&channelLayout,
+			AV_SAMPLE_FMT_S16,
+			SAMPLE_RATE,
+			&channelLayout,
+			AV_SAMPLE_FMT_FLTP,
+			SAMPLE_RATE,
+			0,
+			nullptr));
+		SwrContext_ptr swrContextOwner{ swrContext };
+
+		THROW_HR_IF_FFMPEG_FAILED(swr_init(swrContext));
+
+		vector<uint8_t> queuedSamples[QUEUED_SAMPLE_COUNT];
+		size_t nextQueuedSample{ 0 };
+		vector<uint8_t> compactedSampleBuf;
+		int compactedSampleCount{ 0 };
+
+		// Every av_samples_alloc() call is one av_malloc() call
+		uint64_t ffmpegAllocationCount{ 0 };
+		size_t heapAllocationCount{ 0 };
+		uint64_t samplesAllocCount{ 0 };
+		for (int frame{ 0 }; frame < frameCount; frame++)
+		{
+			if (frame == skipFrameCount)
+			{
+				ffmpegAllocationCount = samplesAllocCount;
+				heapAllocationCount = GetAllocationCount();
+			}
+
+			uint8_t* buf{ nullptr };
+			const int bufSize{ av_samples_alloc(&buf, nullptr, CHANNELS, FRAME_SAMPLE_COUNT, AV_SAMPLE_FMT_S16, 0) };
+			THROW_HR_IF_FFMPEG_FAILED(bufSize);
+			AVBlob_ptr resampledData{ buf };
+			samplesAllocCount++;
+
+			const int resampledSampleCount{ swr_convert(swrContext, &buf, FRAME_SAMPLE_COUNT, frameData, FRAME_SAMPLE_COUNT) };
+			THROW_HR_IF_FFMPEG_FAILED(resampledSampleCount);
+
+			compactedSampleBuf.insert(compactedSampleBuf.end(), buf, buf + resampledSampleCount * BLOCK_ALIGN);
+			compactedSampleCount += resampledSampleCount;
+
+			if (compactedSampleCount >= SAMPLE_DURATION_MS * SAMPLE_RATE / 1000)
+			{
+				queuedSamples[nextQueuedSample] = move(compactedSampleBuf);
+				nextQueuedSample = (nextQueuedSample + 1) % QUEUED_SAMPLE_COUNT;
+				compactedSampleBuf = { };
+				compactedSampleCount = 0;
+			}
+		}
+
+		return { samplesAllocCount - ffmpegAllocationCount, GetAllocationCount() - heapAllocationCount };
+	}
+}
+
+NATIVE_TEST(AudioOutputBufferPool_ReusesReleasedBuffers)
+{
+	AudioOutputBufferPool pool{ 0 };
+	pool.Init(4096);
+
+	AVBufferRef_ptr outputBuf;
+	pool.Reserve(outputBuf, 0, 1024);
+	VERIFY(outputBuf != nullptr && outputBuf->size == 4096);
+	VERIFY(pool.GetAllocationCount() == 1);
+
+	// Room left in the current buffer
+	AVBufferRef* const firstBuf{ outputBuf.get() };
+	pool.Reserve(outputBuf, 1024, 3072);
+	VERIFY(outputBuf.get() == firstBuf);
+
+	// Another buffer while the first is still held
+	AVBufferRef_ptr otherBuf;
+	pool.Reserve(otherBuf, 0, 1024);
+	VERIFY(pool.GetAllocationCount() == 2);
+
+	// Released buffers are handed out again
+	outputBuf.reset();
+	otherBuf.reset();
+	pool.Reserve(outputBuf, 0, 1024);
+	VERIFY(pool.GetAllocationCount() == 2);
+}
+
+NATIVE_TEST(AudioOutputBufferPool_GrowsForLargeFrames)
+{
+	AudioOutputBufferPool pool{ 0 };
+	pool.Init(4096);
+
+	AVBufferRef_ptr outputBuf;
+	pool.Reserve(outputBuf, 0, 3000);
+	FillRandom(outputBuf->data, 3000, 1);
+	const vector<uint8_t> compactedSamples(outputBuf->data, outputBuf->data + 3000);
+
+	// A frame that doesn't fit grows the pool and carries over the compacted samples
+	pool.Reserve(outputBuf, 3000, 3000);
+	VERIFY(pool.GetBufferSize() == 8192);
+	VERIFY(outputBuf->size == 8192);
+	VERIFY(memcmp(outputBuf->data, compactedSamples.data(), compactedSamples.size()) == 0);
+
+	// Buffers from before the pool grew stay valid
+	AVBufferRef_ptr oldBuf;
+	pool.Init(4096);
+	pool.Reserve(oldBuf, 0, 4096);
+	pool.Init(16384);
+	VERIFY(oldBuf->size == 4096);
+	oldBuf.reset();
+}
+
+NATIVE_TEST(AudioOutputBufferPool_SteadyStateDoesNotAllocate)
+{
+	// After the first second, each sample reuses a buffer released by a sample that has been rendered
+	const AllocationCounts counts{ DecodeWithBufferPool(10 * SAMPLE_RATE / FRAME_SAMPLE_COUNT, SAMPLE_RATE / FRAME_SAMPLE_COUNT) };
+	VERIFY(counts.ffmpeg == 0);
+	VERIFY(counts.heap == 0);
+}
+
+// Allocations made to compact 10 seconds of 48 kHz stereo audio into 200 ms samples, before and after output buffers were pooled
+NATIVE_BENCHMARK(AudioOutputBuffers_AllocationsPerSecond)
+{
+	constexpr int SECONDS{ 10 };
+	constexpr int FRAME_COUNT{ SECONDS * SAMPLE_RATE / FRAME_SAMPLE_COUNT };
+
+	const AllocationCounts before{ DecodeWithSampleVector(FRAME_COUNT, 0) };
+	const AllocationCounts after{ DecodeWithBufferPool(FRAME_COUNT, 0) };
+	const AllocationCounts afterSteadyState{ DecodeWithBufferPool(FRAME_COUNT, SAMPLE_RATE / FRAME_SAMPLE_COUNT) };
+
+	printf("  per second of audio  before: %5.1f av_malloc %5.1f new  after: %5.1f pool allocations %5.1f new  (%.1f and %.1f after the first second)\n",
+		static_cast<double>(before.ffmpeg) / SECONDS,
+		static_cast<double>(before.heap) / SECONDS,
+		static_cast<double>(after.ffmpeg) / SECONDS,
+		static_cast<double>(after.heap) / SECONDS,
+		static_cast<double>(afterSteadyState.ffmpeg) / (SECONDS - 1),
+		static_cast<double>(afterSteadyState.heap) / (SECONDS - 1));
+}
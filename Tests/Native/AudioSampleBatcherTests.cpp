@@ -0,0 +1,204 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "AudioSampleBatcher.h"
+
+using namespace FFmpegInteropNativeTests;
+using namespace winrt::FFmpegInterop::implementation;
+using namespace std;
+using namespace std::chrono;
+
+namespace
+{
+	constexpr int64_t HNS_PER_MS{ HNS_PER_SEC / MS_PER_SEC };
+
+	struct BatchPolicy
+	{
+		const char* name;
+		pair<int64_t, int64_t> durationRange; // hns
+	};
+
+	// The presets from FFmpegInteropMSSConfig::GetAudioSampleDurationRange()
+	constexpr BatchPolicy BATCH_POLICIES[]
+	{
+		{ "LowLatency", { 20 * HNS_PER_MS, 20 * HNS_PER_MS } },
+		{ "Balanced", { 40 * HNS_PER_MS, 200 * HNS_PER_MS } },
+		{ "PowerSaver", { 200 * HNS_PER_MS, 1000 * HNS_PER_MS } }
+	};
+
+	// Requests and sample durations seen by a renderer that keeps a fixed amount of audio buffered
+	struct RendererStats
+	{
+		int requestCount{ 0 };
+		int64_t firstSampleDuration{ 0 }; // hns
+		int64_t lastSampleDuration{ 0 }; // hns
+		int64_t minSampleDurationAfterUnderrun{ numeric_limits<int64_t>::max() }; // hns
+	};
+
+	// Plays audio for playDuration with a clock that advances 1 ms at a time. The renderer requests a sample whenever it
+	// has less than rendererBuffer buffered, which is how the audio renderer paces its requests once playback starts.
+	// If underrunTime is set, the renderer runs out at that time (e.g. the audio device glitched) and raises its buffering
+	// to underrunBuffer, so it has to catch up.
+	RendererStats SimulateRenderer(
+		_In_ AudioSampleBatcher& batcher,
+		_In_ int64_t playDuration,
+		_In_ int64_t rendererBuffer,
+		_In_ int64_t underrunTime = -1,
+		_In_ int64_t underrunBuffer = 0)
+	{
+		const steady_clock::time_point start{ steady_clock::now() };
+		RendererStats stats;
+		int64_t buffered{ 0 }; // hns
+		bool isRefilling{ false };
+
+		for (int64_t time{ 0 }; time < playDuration; )
+		{
+			if (time == underrunTime)
+			{
+				buffered = 0;
+				rendererBuffer = underrunBuffer;
+				isRefilling = true;
+				underrunTime = -1;
+			}
+
+			if (buffered < rendererBuffer)
+			{
+				batcher.OnSampleRequested(start + nanoseconds{ 100 * time });
+
+				const int64_t sampleDuration{ batcher.GetTargetDuration() };
+				buffered += sampleDuration;
+				stats.requestCount++;
+				stats.lastSampleDuration = sampleDuration;
+
+				if (stats.firstSampleDuration == 0)
+				{
+					stats.firstSampleDuration = sampleDuration;
+				}
+
+				if (isRefilling)
+				{
+					stats.minSampleDurationAfterUnderrun = min(stats.minSampleDurationAfterUnderrun, sampleDuration);
+				}
+
+				continue;
+			}
+
+			isRefilling = false;
+			time += HNS_PER_MS;
+			buffered -= HNS_PER_MS;
+		}
+
+		return stats;
+	}
+}
+
+NATIVE_TEST(AudioSampleBatcher_GrowsAtRealTimeCadence)
+{
+	AudioSampleBatcher batcher{ 0, { 40 * HNS_PER_MS, 200 * HNS_PER_MS } };
+	const steady_clock::time_point start{ steady_clock::now() };
+
+	// Requests in quick succession while the renderer fills its buffer keep samples short
+	batcher.OnSampleRequested(start);
+	batcher.OnSampleRequested(start + 1ms);
+	batcher.OnSampleRequested(start + 2ms);
+	VERIFY(batcher.GetTargetDuration() == 40 * HNS_PER_MS);
+
+	// Requests a sample duration apart double the target up to the maximum
+	steady_clock::time_point now{ start + 2ms };
+	for (int64_t expected : { 80, 160, 200, 200 })
+	{
+		now += nanoseconds{ 100 * batcher.GetTargetDuration() };
+		batcher.OnSampleRequested(now);
+		VERIFY(batcher.GetTargetDuration() == expected * HNS_PER_MS);
+	}
+
+	// Flushing starts over from the minimum
+	batcher.Reset();
+	VERIFY(batcher.GetTargetDuration() == 40 * HNS_PER_MS);
+}
+
+NATIVE_TEST(AudioSampleBatcher_ShrinksWhenConsumerStarves)
+{
+	AudioSampleBatcher batcher{ 0, { 40 * HNS_PER_MS, 200 * HNS_PER_MS } };
+	steady_clock::time_point now{ steady_clock::now() };
+
+	batcher.OnSampleRequested(now);
+	while (batcher.GetTargetDuration() < 200 * HNS_PER_MS)
+	{
+		now += nanoseconds{ 100 * batcher.GetTargetDuration() };
+		batcher.OnSampleRequested(now);
+	}
+
+	// Requests a bit early or late don't change the target
+	for (milliseconds interval : { 150ms, 250ms, 60ms })
+	{
+		now += interval;
+		batcher.OnSampleRequested(now);
+		VERIFY(batcher.GetTargetDuration() == 200 * HNS_PER_MS);
+	}
+
+	// Back-to-back requests halve the target, down to the minimum
+	for (int64_t expected : { 100, 50, 40, 40 })
+	{
+		now += 1ms;
+		batcher.OnSampleRequested(now);
+		VERIFY(batcher.GetTargetDuration() == expected * HNS_PER_MS);
+	}
+
+	// Once the consumer has caught up, the target grows again
+	now += 40ms;
+	batcher.OnSampleRequested(now);
+	VERIFY(batcher.GetTargetDuration() == 80 * HNS_PER_MS);
+}
+
+// A renderer that keeps 100 ms buffered, for each batch policy. 5 s in, it runs out and raises its buffering to 400 ms.
+NATIVE_BENCHMARK(AudioSampleBatcher_RequestsPerSecond)
+{
+	constexpr int64_t PLAY_DURATION{ 10 * HNS_PER_SEC };
+	constexpr int64_t RENDERER_BUFFER{ 100 * HNS_PER_MS };
+	constexpr int64_t UNDERRUN_TIME{ 5 * HNS_PER_SEC };
+	constexpr int64_t UNDERRUN_BUFFER{ 400 * HNS_PER_MS };
+
+	printf("  policy      requests/s  first sample  steady sample  smallest sample while catching up\n");
+	for (const BatchPolicy& policy : BATCH_POLICIES)
+	{
+		AudioSampleBatcher batcher{ 0, policy.durationRange };
+		const RendererStats stats{ SimulateRenderer(batcher, PLAY_DURATION, RENDERER_BUFFER, UNDERRUN_TIME, UNDERRUN_BUFFER) };
+
+		printf("  %-10s  %10.1f  %9lld ms  %10lld ms  %15lld ms\n",
+			policy.name,
+			static_cast<double>(stats.requestCount) * HNS_PER_SEC / PLAY_DURATION,
+			stats.firstSampleDuration / HNS_PER_MS,
+			stats.lastSampleDuration / HNS_PER_MS,
+			stats.minSampleDurationAfterUnderrun / HNS_PER_MS);
+	}
+
+	// Cost of the bookkeeping done on every request
+	constexpr int REQUEST_COUNT{ 1000000 };
+	AudioSampleBatcher batcher{ 0, BATCH_POLICIES[1].durationRange };
+	const double requestTime{ MeasureMilliseconds(10, [&]()
+		{
+			for (int i{ 0 }; i < REQUEST_COUNT; i++)
+			{
+				batcher.OnSampleRequested();
+			}
+		}) };
+
+	printf("  OnSampleRequested %.3f us per request\n", requestTime * 1000 / REQUEST_COUNT);
+}
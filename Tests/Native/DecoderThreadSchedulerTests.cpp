@@ -0,0 +1,258 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "DecoderThreadScheduler.h"
+#include <winrt/FFmpegInterop.h>
+
+using namespace FFmpegInteropNativeTests;
+using namespace winrt::FFmpegInterop;
+using namespace winrt::FFmpegInterop::implementation;
+using namespace std;
+
+namespace
+{
+	constexpr int MAX_THREAD_COUNT{ 16 };
+
+	AVCodecContext_ptr CreateCodecContext(_In_ const AVCodec* codec, _In_ AVMediaType codecType, _In_ AVCodecID codecId, _In_ int width, _In_ int height)
+	{
+		AVCodecContext_ptr codecContext{ avcodec_alloc_context3(codec) };
+		THROW_IF_NULL_ALLOC(codecContext);
+
+		codecContext->codec_type = codecType;
+		codecContext->codec_id = codecId;
+		codecContext->width = width;
+		codecContext->height = height;
+
+		return codecContext;
+	}
+
+	// Encodes a synthetic clip for the benchmark to decode. MPEG-4 Part 2 is used because FFmpeg can both encode it and
+	// decode it with frame threads without any external libraries. The frames are a moving gradient with noise on top so
+	// that both the residuals and motion compensation have work to do.
+	vector<AVPacket_ptr> EncodeTestClip(_In_ int width, _In_ int height, _In_ int frameCount)
+	{
+		const AVCodec* encoder{ avcodec_find_encoder(AV_CODEC_ID_MPEG4) };
+		THROW_HR_IF_NULL(E_NOTIMPL, encoder);
+
+		AVCodecContext_ptr encoderContext{ CreateCodecContext(encoder, AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_MPEG4, width, height) };
+		encoderContext->pix_fmt = AV_PIX_FMT_YUV420P;
+		encoderContext->time_base = { 1, 30 };
+		encoderContext->gop_size = 30;
+		encoderContext->bit_rate = 8'000'000;
+		THROW_HR_IF_FFMPEG_FAILED(avcodec_open2(encoderContext.get(), encoder, nullptr));
+
+		AVFrame_ptr frame{ av_frame_alloc() };
+		THROW_IF_NULL_ALLOC(frame);
+		frame->format = AV_PIX_FMT_YUV420P;
+		frame->width = width;
+		frame->height = height;
+		THROW_HR_IF_FFMPEG_FAILED(av_frame_get_buffer(frame.get(), 0));
+
+		vector<AVPacket_ptr> packets;
+		auto receivePackets = [&]()
+			{
+				while (true)
+				{
+					AVPacket_ptr packet{ av_packet_alloc() };
+					THROW_IF_NULL_ALLOC(packet);
+
+					const int result{ avcodec_receive_packet(encoderContext.get(), packet.get()) };
+					if (result == AVERROR(EAGAIN) || result == AVERROR_EOF)
+					{
+						break;
+					}
+
+					THROW_HR_IF_FFMPEG_FAILED(result);
+					packets.push_back(move(packet));
+				}
+			};
+
+		mt19937 generator{ 1 };
+		for (int i{ 0 }; i < frameCount; i++)
+		{
+			THROW_HR_IF_FFMPEG_FAILED(av_frame_make_writable(frame.get()));
+
+			for (int plane{ 0 }; plane < 3; plane++)
+			{
+				const int planeWidth{ plane == 0 ? width : AV_CEIL_RSHIFT(width, 1) };
+				const int planeHeight{ plane == 0 ? height : AV_CEIL_RSHIFT(height, 1) };
+				for (int y{ 0 }; y < planeHeight; y++)
+				{
+					uint8_t* row{ frame->data[plane] + y * frame->linesize[plane] };
+					for (int x{ 0 }; x < planeWidth; x++)
+					{
+						row[x] = static_cast<uint8_t>(x + y + 4 * i + (generator() & 15));
+					}
+				}
+			}
+
+			frame->pts = i;
+			THROW_HR_IF_FFMPEG_FAILED(avcodec_send_frame(encoderContext.get(), frame.get()));
+			receivePackets();
+		}
+
+		THROW_HR_IF_FFMPEG_FAILED(avcodec_send_frame(encoderContext.get(), nullptr));
+		receivePackets();
+
+		return packets;
+	}
+
+	// Decodes the clip repeatCount times and returns the number of frames decoded
+	int DecodeClip(_In_ AVCodecContext* codecContext, _In_ const vector<AVPacket_ptr>& packets, _In_ int repeatCount)
+	{
+		AVFrame_ptr frame{ av_frame_alloc() };
+		THROW_IF_NULL_ALLOC(frame);
+
+		int frameCount{ 0 };
+		auto receiveFrames = [&]()
+			{
+				while (true)
+				{
+					const int result{ avcodec_receive_frame(codecContext, frame.get()) };
+					if (result == AVERROR(EAGAIN) || result == AVERROR_EOF)
+					{
+						break;
+					}
+
+					THROW_HR_IF_FFMPEG_FAILED(result);
+					av_frame_unref(frame.get());
+					frameCount++;
+				}
+			};
+
+		for (int i{ 0 }; i < repeatCount; i++)
+		{
+			for (const AVPacket_ptr& packet : packets)
+			{
+				THROW_HR_IF_FFMPEG_FAILED(avcodec_send_packet(codecContext, packet.get()));
+				receiveFrames();
+			}
+
+			THROW_HR_IF_FFMPEG_FAILED(avcodec_send_packet(codecContext, nullptr));
+			receiveFrames();
+			avcodec_flush_buffers(codecContext);
+		}
+
+		return frameCount;
+	}
+}
+
+NATIVE_TEST(DecoderThreads_AudioIsSingleThreaded)
+{
+	AVCodecContext_ptr codecContext{ CreateCodecContext(nullptr, AVMEDIA_TYPE_AUDIO, AV_CODEC_ID_AAC, 0, 0) };
+	const DecoderThreadScheduler::Allocation allocation{ DecoderThreadScheduler::Allocate(codecContext.get(), DecoderThreadPriority::High) };
+	VERIFY(allocation.GetThreadCount() == 1);
+}
+
+// Shares are rebalanced as decoders are opened, closed and change priority
+NATIVE_TEST(DecoderThreads_SharesFollowSessions)
+{
+	const int hardwareThreadCount{ static_cast<int>(thread::hardware_concurrency()) };
+	AVCodecContext_ptr codecContext{ CreateCodecContext(nullptr, AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_H264, 1280, 720) };
+
+	vector<DecoderThreadScheduler::Allocation> allocations;
+	allocations.push_back(DecoderThreadScheduler::Allocate(codecContext.get(), DecoderThreadPriority::Normal));
+	VERIFY(allocations[0].GetThreadCount() == clamp(hardwareThreadCount, 1, MAX_THREAD_COUNT));
+
+	// A grid of equal sessions splits the threads evenly, but every decoder keeps at least one
+	constexpr int SESSION_COUNT{ 9 };
+	for (int i{ 1 }; i < SESSION_COUNT; i++)
+	{
+		allocations.push_back(DecoderThreadScheduler::Allocate(codecContext.get(), DecoderThreadPriority::Normal));
+	}
+
+	const int evenShare{ clamp(static_cast<int>(lround(static_cast<double>(hardwareThreadCount) / SESSION_COUNT)), 1, MAX_THREAD_COUNT) };
+	for (const DecoderThreadScheduler::Allocation& allocation : allocations)
+	{
+		VERIFY(allocation.GetThreadCount() == evenShare);
+	}
+
+	// Raising one session's priority moves threads to it from the others
+	allocations[0].SetPriority(DecoderThreadPriority::High);
+	VERIFY(allocations[0].GetThreadCount() >= evenShare);
+	VERIFY(allocations[1].GetThreadCount() <= evenShare);
+	VERIFY(allocations[0].GetThreadCount() >= allocations[1].GetThreadCount());
+
+	// Closing the other sessions returns their threads
+	allocations.resize(1);
+	VERIFY(allocations[0].GetThreadCount() == clamp(hardwareThreadCount, 1, MAX_THREAD_COUNT));
+}
+
+// Total decode throughput of N concurrent sessions, each decoding the same 720p clip on its own thread. Compares a
+// thread per core per session, which is what every decoder used to get, with the scheduler's shares.
+NATIVE_BENCHMARK(DecoderThreads_ThroughputVsSessionCount)
+{
+	constexpr int WIDTH{ 1280 };
+	constexpr int HEIGHT{ 720 };
+	constexpr int CLIP_FRAME_COUNT{ 90 };
+	constexpr int REPEAT_COUNT{ 2 };
+
+	const vector<AVPacket_ptr> packets{ EncodeTestClip(WIDTH, HEIGHT, CLIP_FRAME_COUNT) };
+	const AVCodec* decoder{ avcodec_find_decoder(AV_CODEC_ID_MPEG4) };
+	THROW_HR_IF_NULL(E_NOTIMPL, decoder);
+
+	const int hardwareThreadCount{ static_cast<int>(thread::hardware_concurrency()) };
+	printf("  %d hardware threads\n", hardwareThreadCount);
+
+	for (int sessionCount : { 1, 2, 4, 9, 16 })
+	{
+		for (bool isScheduled : { false, true })
+		{
+			// Allocate every session's share before opening any decoder so each one opens with its final share
+			vector<AVCodecContext_ptr> codecContexts;
+			vector<DecoderThreadScheduler::Allocation> allocations;
+			for (int i{ 0 }; i < sessionCount; i++)
+			{
+				codecContexts.push_back(CreateCodecContext(decoder, AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_MPEG4, WIDTH, HEIGHT));
+				if (isScheduled)
+				{
+					allocations.push_back(DecoderThreadScheduler::Allocate(codecContexts.back().get(), DecoderThreadPriority::Normal));
+				}
+			}
+
+			int totalThreadCount{ 0 };
+			for (int i{ 0 }; i < sessionCount; i++)
+			{
+				AVCodecContext* codecContext{ codecContexts[i].get() };
+				codecContext->thread_count = isScheduled ? allocations[i].GetThreadCount() : hardwareThreadCount;
+				codecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+				THROW_HR_IF_FFMPEG_FAILED(avcodec_open2(codecContext, decoder, nullptr));
+				totalThreadCount += codecContext->thread_count;
+			}
+
+			const auto start{ chrono::steady_clock::now() };
+
+			vector<future<int>> results;
+			for (int i{ 0 }; i < sessionCount; i++)
+			{
+				results.push_back(async(launch::async, DecodeClip, codecContexts[i].get(), cref(packets), REPEAT_COUNT));
+			}
+
+			int frameCount{ 0 };
+			for (future<int>& result : results)
+			{
+				frameCount += result.get();
+			}
+
+			const chrono::duration<double> elapsed{ chrono::steady_clock::now() - start };
+			printf("  %2d sessions  %-9s  %3d decoder threads  %7.1f frames/s total\n",
+				sessionCount, isScheduled ? "scheduled" : "per core", totalThreadCount, frameCount / elapsed.count());
+		}
+	}
+}
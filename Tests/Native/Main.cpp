@@ -0,0 +1,121 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+
+using namespace FFmpegInteropNativeTests;
+using namespace std;
+
+namespace
+{
+	atomic<size_t> s_allocationCount;
+}
+
+// Count allocations for GetAllocationCount(). The other forms of new and delete call these ones.
+void* operator new(size_t size)
+{
+	s_allocationCount.fetch_add(1, memory_order_relaxed);
+
+	if (void* ptr{ malloc(size == 0 ? 1 : size) })
+	{
+		return ptr;
+	}
+
+	throw bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+namespace FFmpegInteropNativeTests
+{
+	size_t GetAllocationCount() noexcept
+	{
+		return s_allocationCount.load(memory_order_relaxed);
+	}
+
+	vector<TestCase>& GetTestCases()
+	{
+		static vector<TestCase> s_testCases;
+		return s_testCases;
+	}
+
+	void FillRandom(_Out_writes_bytes_(size) uint8_t* data, _In_ size_t size, _In_ uint32_t seed)
+	{
+		mt19937 generator{ seed };
+		for (size_t i{ 0 }; i < size; i++)
+		{
+			data[i] = static_cast<uint8_t>(generator());
+		}
+	}
+}
+
+// Usage: FFmpegInteropNativeTests [--benchmark] [name filter]
+// Runs the tests, or the benchmarks with --benchmark, whose names contain the filter. Returns the number of failures.
+int main(int argc, char* argv[])
+{
+	bool runBenchmarks{ false };
+	string_view filter;
+	for (int i{ 1 }; i < argc; i++)
+	{
+		if (string_view{ argv[i] } == "--benchmark")
+		{
+			runBenchmarks = true;
+		}
+		else
+		{
+			filter = argv[i];
+		}
+	}
+
+	av_log_set_level(AV_LOG_ERROR);
+
+	int runCount{ 0 };
+	int failureCount{ 0 };
+	for (const TestCase& testCase : GetTestCases())
+	{
+		if (testCase.isBenchmark != runBenchmarks || string_view{ testCase.name }.find(filter) == string_view::npos)
+		{
+			continue;
+		}
+
+		printf("[ RUN    ] %s\n", testCase.name);
+		runCount++;
+
+		try
+		{
+			testCase.function();
+			printf("[     OK ] %s\n", testCase.name);
+		}
+		catch (const exception& e)
+		{
+			printf("[ FAILED ] %s: %s\n", testCase.name, e.what());
+			failureCount++;
+		}
+		catch (const winrt::hresult_error& e)
+		{
+			printf("[ FAILED ] %s: 0x%08X %ls\n", testCase.name, static_cast<uint32_t>(e.code()), e.message().c_str());
+			failureCount++;
+		}
+	}
+
+	printf("%d of %d passed\n", runCount - failureCount, runCount);
+	return failureCount;
+}
@@ -0,0 +1,90 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#pragma once
+
+namespace FFmpegInteropNativeTests
+{
+	// Thrown by VERIFY() when a check fails
+	class TestFailure :
+		public std::runtime_error
+	{
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	struct TestCase
+	{
+		const char* name;
+		void (*function)();
+		bool isBenchmark;
+	};
+
+	// Every test and benchmark in the process, in registration order
+	std::vector<TestCase>& GetTestCases();
+
+	struct TestRegistration
+	{
+		TestRegistration(_In_ const char* name, _In_ void (*function)(), _In_ bool isBenchmark)
+		{
+			GetTestCases().push_back({ name, function, isBenchmark });
+		}
+	};
+
+	// Number of times operator new has been called in the process. Take the difference around code that shouldn't allocate.
+	size_t GetAllocationCount() noexcept;
+
+	// Fills a buffer with random bytes. The same seed always gives the same bytes so failures can be reproduced.
+	void FillRandom(_Out_writes_bytes_(size) uint8_t* data, _In_ size_t size, _In_ uint32_t seed);
+
+	// Runs func several times and returns the fastest run in milliseconds, which is the one least disturbed by the rest of the system
+	template <typename Func>
+	double MeasureMilliseconds(_In_ int runCount, _In_ Func&& func)
+	{
+		double fastest{ std::numeric_limits<double>::max() };
+		for (int i{ 0 }; i < runCount; i++)
+		{
+			const auto start{ std::chrono::steady_clock::now() };
+			func();
+			const std::chrono::duration<double, std::milli> elapsed{ std::chrono::steady_clock::now() - start };
+			fastest = std::min(fastest, elapsed.count());
+		}
+
+		return fastest;
+	}
+}
+
+// Defines a test, which runs by default
+#define NATIVE_TEST(name) \
+	static void name(); \
+	static FFmpegInteropNativeTests::TestRegistration name##Registration{ #name, name, false }; \
+	static void name()
+
+// Defines a benchmark, which only runs when --benchmark is passed. Benchmarks print their results.
+#define NATIVE_BENCHMARK(name) \
+	static void name(); \
+	static FFmpegInteropNativeTests::TestRegistration name##Registration{ #name, name, true }; \
+	static void name()
+
+#define VERIFY(condition) \
+	do { \
+		if (!(condition)) \
+		{ \
+			throw FFmpegInteropNativeTests::TestFailure(std::format("{}({}): {}", FILENAME(__FILE__), __LINE__, #condition)); \
+		} \
+	} while (false)
@@ -0,0 +1,497 @@
+//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+#include "pch.h"
+#include "VideoConversion.h"
+
+using namespace FFmpegInteropNativeTests;
+using namespace winrt::FFmpegInterop::implementation;
+using namespace std;
+
+namespace
+{
+	// Odd sizes, sizes smaller than a vector register, and a full frame
+	constexpr pair<int, int> FRAME_SIZES[]{ { 1, 1 }, { 2, 2 }, { 17, 9 }, { 64, 36 }, { 131, 75 }, { 1920, 1080 } };
+
+	constexpr AVPixelFormat NV12_SOURCE_FORMATS[]
+	{
+		AV_PIX_FMT_YUV420P,
+		AV_PIX_FMT_YUVJ420P,
+		AV_PIX_FMT_YUV422P,
+		AV_PIX_FMT_YUVJ422P,
+		AV_PIX_FMT_YUV444P,
+		AV_PIX_FMT_YUVJ444P
+	};
+
+	constexpr AVPixelFormat P01X_SOURCE_FORMATS[]
+	{
+		AV_PIX_FMT_YUV420P9LE,
+		AV_PIX_FMT_YUV420P10LE,
+		AV_PIX_FMT_YUV420P12LE,
+		AV_PIX_FMT_YUV420P14LE,
+		AV_PIX_FMT_YUV420P16LE
+	};
+
+	using ConversionKernel = void (*)(const AVFrame*, uint8_t* const[], const int[], int, int);
+
+	AVFrame_ptr AllocateFrame(_In_ AVPixelFormat format, _In_ int width, _In_ int height)
+	{
+		AVFrame_ptr frame{ av_frame_alloc() };
+		THROW_IF_NULL_ALLOC(frame);
+
+		frame->format = format;
+		frame->width = width;
+		frame->height = height;
+		THROW_HR_IF_FFMPEG_FAILED(av_frame_get_buffer(frame.get(), 0));
+
+		return frame;
+	}
+
+	int GetPlaneHeight(_In_ const AVFrame* frame, _In_ int plane)
+	{
+		const AVPixFmtDescriptor* desc{ av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format)) };
+		return plane == 0 ? frame->height : AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h);
+	}
+
+	// Allocates a frame of random samples. Samples deeper than 8 bits are kept within the format's bit depth.
+	AVFrame_ptr CreateRandomFrame(_In_ AVPixelFormat format, _In_ int width, _In_ int height, _In_ uint32_t seed)
+	{
+		AVFrame_ptr frame{ AllocateFrame(format, width, height) };
+
+		const int bitDepth{ av_pix_fmt_desc_get(format)->comp[0].depth };
+		for (int plane{ 0 }; plane < av_pix_fmt_count_planes(format); plane++)
+		{
+			const size_t planeSize{ static_cast<size_t>(frame->linesize[plane]) * GetPlaneHeight(frame.get(), plane) };
+			FillRandom(frame->data[plane], planeSize, seed + plane);
+
+			if (bitDepth > 8)
+			{
+				const uint16_t mask{ static_cast<uint16_t>((1 << bitDepth) - 1) };
+				uint16_t* samples{ reinterpret_cast<uint16_t*>(frame->data[plane]) };
+				for (size_t i{ 0 }; i < planeSize / 2; i++)
+				{
+					samples[i] &= mask;
+				}
+			}
+		}
+
+		return frame;
+	}
+
+	// Compares the visible samples of two frames with the same format and size. Padding is ignored.
+	bool AreFramesEqual(_In_ const AVFrame* a, _In_ const AVFrame* b)
+	{
+		const AVPixelFormat format{ static_cast<AVPixelFormat>(a->format) };
+		for (int plane{ 0 }; plane < av_pix_fmt_count_planes(format); plane++)
+		{
+			const int rowSize{ av_image_get_linesize(format, a->width, plane) };
+			for (int row{ 0 }; row < GetPlaneHeight(a, plane); row++)
+			{
+				if (memcmp(a->data[plane] + row * a->linesize[plane], b->data[plane] + row * b->linesize[plane], rowSize) != 0)
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// Converts a frame with one of the VideoConversion kernels, one slice at a time. The output starts out as random
+	// bytes, so samples that no slice writes show up as differences. Slices run last to first to catch a slice that
+	// depends on the output of an earlier one.
+	AVFrame_ptr ConvertWithKernel(_In_ const AVFrame* frame, _In_ AVPixelFormat outputFormat, _In_ ConversionKernel convert, _In_ int sliceCount = 1)
+	{
+		AVFrame_ptr output{ AllocateFrame(outputFormat, frame->width, frame->height) };
+		for (int plane{ 0 }; plane < av_pix_fmt_count_planes(outputFormat); plane++)
+		{
+			FillRandom(output->data[plane], static_cast<size_t>(output->linesize[plane]) * GetPlaneHeight(output.get(), plane), static_cast<uint32_t>(sliceCount));
+		}
+
+		for (int sliceIndex{ sliceCount - 1 }; sliceIndex >= 0; sliceIndex--)
+		{
+			convert(frame, output->data, output->linesize, sliceIndex, sliceCount);
+		}
+
+		return output;
+	}
+
+	// Converts a frame the way UncompressedVideoSampleProvider does when the kernels can't
+	AVFrame_ptr ConvertWithSwscale(_In_ const AVFrame* frame, _In_ AVPixelFormat outputFormat)
+	{
+		SwsContext_ptr swsContext{ sws_getContext(frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+			frame->width, frame->height, outputFormat, SWS_BICUBIC, nullptr, nullptr, nullptr) };
+		THROW_IF_NULL_ALLOC(swsContext);
+
+		AVFrame_ptr output{ AllocateFrame(outputFormat, frame->width, frame->height) };
+		THROW_HR_IF_FFMPEG_FAILED(sws_scale_frame(swsContext.get(), output.get(), frame));
+
+		return output;
+	}
+
+	// Straightforward NV12 conversion to check the kernels against. Chroma is averaged vertically and then horizontally,
+	// rounding up each time, and the last row and column are repeated for odd sizes.
+	AVFrame_ptr ConvertToNV12Reference(_In_ const AVFrame* frame)
+	{
+		AVFrame_ptr output{ AllocateFrame(AV_PIX_FMT_NV12, frame->width, frame->height) };
+		av_image_copy_plane(output->data[0], output->linesize[0], frame->data[0], frame->linesize[0], frame->width, frame->height);
+
+		const AVPixFmtDescriptor* desc{ av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format)) };
+		const int chromaWidth{ AV_CEIL_RSHIFT(frame->width, desc->log2_chroma_w) };
+		const int chromaHeight{ AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h) };
+		const int stepX{ desc->log2_chroma_w == 0 ? 2 : 1 };
+		const int stepY{ desc->log2_chroma_h == 0 ? 2 : 1 };
+
+		for (int plane{ 1 }; plane <= 2; plane++)
+		{
+			auto sample = [&](int x, int y)
+				{
+					return static_cast<int>(frame->data[plane][min(y, chromaHeight - 1) * frame->linesize[plane] + min(x, chromaWidth - 1)]);
+				};
+
+			for (int y{ 0 }; y < AV_CEIL_RSHIFT(frame->height, 1); y++)
+			{
+				for (int x{ 0 }; x < AV_CEIL_RSHIFT(frame->width, 1); x++)
+				{
+					const int srcX{ x * stepX };
+					const int srcY{ y * stepY };
+					const int left{ (sample(srcX, srcY) + sample(srcX, srcY + stepY - 1) + 1) >> 1 };
+					const int right{ (sample(srcX + stepX - 1, srcY) + sample(srcX + stepX - 1, srcY + stepY - 1) + 1) >> 1 };
+					output->data[1][y * output->linesize[1] + 2 * x + plane - 1] = static_cast<uint8_t>((left + right + 1) >> 1);
+				}
+			}
+		}
+
+		return output;
+	}
+
+	// The output format UncompressedVideoSampleProvider picks for a high bit depth source
+	AVPixelFormat GetP01xOutputFormat(_In_ AVPixelFormat format)
+	{
+		return av_pix_fmt_desc_get(format)->comp[0].depth <= 10 ? AV_PIX_FMT_P010LE : AV_PIX_FMT_P016LE;
+	}
+
+	// Straightforward P010/P016 conversion to check the kernel against. Samples move to the most significant bits.
+	AVFrame_ptr ConvertToP01xReference(_In_ const AVFrame* frame, _In_ AVPixelFormat outputFormat)
+	{
+		AVFrame_ptr output{ AllocateFrame(outputFormat, frame->width, frame->height) };
+		const int shift{ 16 - av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format))->comp[0].depth };
+
+		auto sample = [&](int plane, int x, int y)
+			{
+				return static_cast<uint16_t>(reinterpret_cast<const uint16_t*>(frame->data[plane] + y * frame->linesize[plane])[x] << shift);
+			};
+
+		for (int y{ 0 }; y < frame->height; y++)
+		{
+			uint16_t* luma{ reinterpret_cast<uint16_t*>(output->data[0] + y * output->linesize[0]) };
+			for (int x{ 0 }; x < frame->width; x++)
+			{
+				luma[x] = sample(0, x, y);
+			}
+		}
+
+		for (int y{ 0 }; y < AV_CEIL_RSHIFT(frame->height, 1); y++)
+		{
+			uint16_t* chroma{ reinterpret_cast<uint16_t*>(output->data[1] + y * output->linesize[1]) };
+			for (int x{ 0 }; x < AV_CEIL_RSHIFT(frame->width, 1); x++)
+			{
+				chroma[2 * x] = sample(1, x, y);
+				chroma[2 * x + 1] = sample(2, x, y);
+			}
+		}
+
+		return output;
+	}
+}
+
+NATIVE_TEST(NV12_SupportedFormats)
+{
+	for (AVPixelFormat format : NV12_SOURCE_FORMATS)
+	{
+		VERIFY(IsNV12ConversionSupported(format));
+	}
+
+	VERIFY(!IsNV12ConversionSupported(AV_PIX_FMT_NV12));
+	VERIFY(!IsNV12ConversionSupported(AV_PIX_FMT_YUV420P10LE));
+	VERIFY(!IsNV12ConversionSupported(AV_PIX_FMT_YUV411P));
+}
+
+NATIVE_TEST(NV12_MatchesReference)
+{
+	for (AVPixelFormat format : NV12_SOURCE_FORMATS)
+	{
+		for (auto [width, height] : FRAME_SIZES)
+		{
+			AVFrame_ptr frame{ CreateRandomFrame(format, width, height, static_cast<uint32_t>(width * height)) };
+			AVFrame_ptr expected{ ConvertToNV12Reference(frame.get()) };
+			AVFrame_ptr actual{ ConvertWithKernel(frame.get(), AV_PIX_FMT_NV12, ConvertToNV12) };
+			VERIFY(AreFramesEqual(actual.get(), expected.get()));
+		}
+	}
+}
+
+// swscale converts yuv420p to NV12 at the same size with an unscaled copy and interleave, so the output must match
+// exactly. swscale filters 4:2:2 and 4:4:4 chroma differently than the kernels' box filter, and it converts the range
+// of yuvj formats, so those are only checked against the reference.
+NATIVE_TEST(NV12_YUV420P_MatchesSwscale)
+{
+	for (auto [width, height] : FRAME_SIZES)
+	{
+		if (width < 2 || height < 2)
+		{
+			continue;
+		}
+
+		AVFrame_ptr frame{ CreateRandomFrame(AV_PIX_FMT_YUV420P, width, height, static_cast<uint32_t>(width + height)) };
+		AVFrame_ptr expected{ ConvertWithSwscale(frame.get(), AV_PIX_FMT_NV12) };
+		AVFrame_ptr actual{ ConvertWithKernel(frame.get(), AV_PIX_FMT_NV12, ConvertToNV12) };
+		VERIFY(AreFramesEqual(actual.get(), expected.get()));
+	}
+}
+
+// Each slice covers whole chroma rows and writes disjoint output, so any split must match a single pass
+NATIVE_TEST(NV12_SlicesMatchSinglePass)
+{
+	for (AVPixelFormat format : NV12_SOURCE_FORMATS)
+	{
+		for (auto [width, height] : FRAME_SIZES)
+		{
+			AVFrame_ptr frame{ CreateRandomFrame(format, width, height, static_cast<uint32_t>(width * height)) };
+			AVFrame_ptr expected{ ConvertWithKernel(frame.get(), AV_PIX_FMT_NV12, ConvertToNV12) };
+
+			for (int sliceCount : { 2, 3, 7, 16 })
+			{
+				AVFrame_ptr actual{ ConvertWithKernel(frame.get(), AV_PIX_FMT_NV12, ConvertToNV12, sliceCount) };
+				VERIFY(AreFramesEqual(actual.get(), expected.get()));
+			}
+		}
+	}
+}
+
+NATIVE_BENCHMARK(NV12_KernelVsSwscale)
+{
+	constexpr int RUN_COUNT{ 50 };
+
+	for (AVPixelFormat format : { AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV444P })
+	{
+		for (auto [width, height] : { pair{ 1920, 1080 }, pair{ 3840, 2160 } })
+		{
+			AVFrame_ptr frame{ CreateRandomFrame(format, width, height, 1) };
+			AVFrame_ptr output{ AllocateFrame(AV_PIX_FMT_NV12, width, height) };
+
+			const double kernelTime{ MeasureMilliseconds(RUN_COUNT, [&]()
+				{
+					ConvertToNV12(frame.get(), output->data, output->linesize, 0, 1);
+				}) };
+
+			SwsContext_ptr swsContext{ sws_getContext(width, height, format, width, height, AV_PIX_FMT_NV12, SWS_BICUBIC, nullptr, nullptr, nullptr) };
+			THROW_IF_NULL_ALLOC(swsContext);
+
+			const double swscaleTime{ MeasureMilliseconds(RUN_COUNT, [&]()
+				{
+					THROW_HR_IF_FFMPEG_FAILED(sws_scale_frame(swsContext.get(), output.get(), frame.get()));
+				}) };
+
+			printf("  %-8s %4dx%-4d  kernel %7.3f ms  swscale %7.3f ms  (%.1fx)\n",
+				av_get_pix_fmt_name(format), width, height, kernelTime, swscaleTime, swscaleTime / kernelTime);
+		}
+	}
+}
+
+NATIVE_TEST(P01x_SupportedFormats)
+{
+	for (AVPixelFormat format : P01X_SOURCE_FORMATS)
+	{
+		VERIFY(IsP01xConversionSupported(format, GetP01xOutputFormat(format)));
+		VERIFY(IsP01xConversionSupported(format, AV_PIX_FMT_P016LE));
+	}
+
+	VERIFY(!IsP01xConversionSupported(AV_PIX_FMT_YUV420P, AV_PIX_FMT_P016LE));
+	VERIFY(!IsP01xConversionSupported(AV_PIX_FMT_P010LE, AV_PIX_FMT_P016LE));
+	VERIFY(!IsP01xConversionSupported(AV_PIX_FMT_YUV422P10LE, AV_PIX_FMT_P016LE));
+	VERIFY(!IsP01xConversionSupported(AV_PIX_FMT_YUV420P10BE, AV_PIX_FMT_P016LE));
+
+	// P010 can't hold more than 10 significant bits
+	VERIFY(!IsP01xConversionSupported(AV_PIX_FMT_YUV420P12LE, AV_PIX_FMT_P010LE));
+}
+
+// A preferred subtype list can select any output format for high bit depth input. Everything other than P010/P016 must go
+// through swscale, as the repacked frame is larger than the buffers of smaller formats (e.g. YUY2 or IYUV).
+NATIVE_TEST(P01x_RejectsOtherOutputFormats)
+{
+	constexpr AVPixelFormat OTHER_OUTPUT_FORMATS[]
+	{
+		AV_PIX_FMT_NV12,
+		AV_PIX_FMT_YUYV422,
+		AV_PIX_FMT_YUV420P,
+		AV_PIX_FMT_BGRA,
+		AV_PIX_FMT_BGR0,
+		AV_PIX_FMT_VUYA
+	};
+
+	for (AVPixelFormat format : P01X_SOURCE_FORMATS)
+	{
+		for (AVPixelFormat outputFormat : OTHER_OUTPUT_FORMATS)
+		{
+			VERIFY(!IsP01xConversionSupported(format, outputFormat));
+		}
+	}
+}
+
+NATIVE_TEST(P01x_MatchesReference)
+{
+	for (AVPixelFormat format : P01X_SOURCE_FORMATS)
+	{
+		for (auto [width, height] : FRAME_SIZES)
+		{
+			AVFrame_ptr frame{ CreateRandomFrame(format, width, height, static_cast<uint32_t>(width * height)) };
+			AVFrame_ptr expected{ ConvertToP01xReference(frame.get(), GetP01xOutputFormat(format)) };
+			AVFrame_ptr actual{ ConvertWithKernel(frame.get(), GetP01xOutputFormat(format), ConvertToP01x) };
+			VERIFY(AreFramesEqual(actual.get(), expected.get()));
+		}
+	}
+}
+
+// swscale repacks 10-bit and 12-bit 4:2:0 to P010/P016 at the same size with an unscaled shift and interleave,
+// so the output must match exactly. Other bit depths go through swscale's scaler and are only checked against
+// the reference.
+NATIVE_TEST(P01x_MatchesSwscale)
+{
+	for (AVPixelFormat format : { AV_PIX_FMT_YUV420P10LE, AV_PIX_FMT_YUV420P12LE })
+	{
+		for (auto [width, height] : FRAME_SIZES)
+		{
+			if (width < 2 || height < 2)
+			{
+				continue;
+			}
+
+			AVFrame_ptr frame{ CreateRandomFrame(format, width, height, static_cast<uint32_t>(width + height)) };
+			AVFrame_ptr expected{ ConvertWithSwscale(frame.get(), GetP01xOutputFormat(format)) };
+			AVFrame_ptr actual{ ConvertWithKernel(frame.get(), GetP01xOutputFormat(format), ConvertToP01x) };
+			VERIFY(AreFramesEqual(actual.get(), expected.get()));
+		}
+	}
+}
+
+NATIVE_TEST(P01x_SlicesMatchSinglePass)
+{
+	for (AVPixelFormat format : P01X_SOURCE_FORMATS)
+	{
+		for (auto [width, height] : FRAME_SIZES)
+		{
+			AVFrame_ptr frame{ CreateRandomFrame(format, width, height, static_cast<uint32_t>(width * height)) };
+			AVFrame_ptr expected{ ConvertWithKernel(frame.get(), GetP01xOutputFormat(format), ConvertToP01x) };
+
+			for (int sliceCount : { 2, 3, 7, 16 })
+			{
+				AVFrame_ptr actual{ ConvertWithKernel(frame.get(), GetP01xOutputFormat(format), ConvertToP01x, sliceCount) };
+				VERIFY(AreFramesEqual(actual.get(), expected.get()));
+			}
+		}
+	}
+}
+
+// Compares the repack kernel with swscale producing the same format, and with the 8-bit NV12 conversion that high
+// bit depth video used to go through
+NATIVE_BENCHMARK(P01x_KernelVsSwscale)
+{
+	constexpr int RUN_COUNT{ 50 };
+
+	for (AVPixelFormat format : { AV_PIX_FMT_YUV420P10LE, AV_PIX_FMT_YUV420P12LE })
+	{
+		for (auto [width, height] : { pair{ 1920, 1080 }, pair{ 3840, 2160 } })
+		{
+			const AVPixelFormat outputFormat{ GetP01xOutputFormat(format) };
+			AVFrame_ptr frame{ CreateRandomFrame(format, width, height, 1) };
+			AVFrame_ptr output{ AllocateFrame(outputFormat, width, height) };
+			AVFrame_ptr nv12Output{ AllocateFrame(AV_PIX_FMT_NV12, width, height) };
+
+			const double kernelTime{ MeasureMilliseconds(RUN_COUNT, [&]()
+				{
+					ConvertToP01x(frame.get(), output->data, output->linesize, 0, 1);
+				}) };
+
+			SwsContext_ptr swsContext{ sws_getContext(width, height, format, width, height, outputFormat, SWS_BICUBIC, nullptr, nullptr, nullptr) };
+			THROW_IF_NULL_ALLOC(swsContext);
+
+			const double swscaleTime{ MeasureMilliseconds(RUN_COUNT, [&]()
+				{
+					THROW_HR_IF_FFMPEG_FAILED(sws_scale_frame(swsContext.get(), output.get(), frame.get()));
+				}) };
+
+			SwsContext_ptr nv12SwsContext{ sws_getContext(width, height, format, width, height, AV_PIX_FMT_NV12, SWS_BICUBIC, nullptr, nullptr, nullptr) };
+			THROW_IF_NULL_ALLOC(nv12SwsContext);
+
+			const double nv12Time{ MeasureMilliseconds(RUN_COUNT, [&]()
+				{
+					THROW_HR_IF_FFMPEG_FAILED(sws_scale_frame(nv12SwsContext.get(), nv12Output.get(), frame.get()));
+				}) };
+
+			printf("  %-13s %4dx%-4d  kernel %7.3f ms  swscale to %s %7.3f ms  swscale to NV12 %7.3f ms\n",
+				av_get_pix_fmt_name(format), width, height, kernelTime, av_get_pix_fmt_name(outputFormat), swscaleTime, nv12Time);
+		}
+	}
+}
+
+// Per-frame conversion latency against the number of slices, sliced the same way as UncompressedVideoSampleProvider.
+// The kernels split the frame with parallel_for, and the scaling path uses swscale's own slice threads.
+NATIVE_BENCHMARK(SliceLatencyVsThreadCount)
+{
+	constexpr int RUN_COUNT{ 20 };
+	const int maxThreadCount{ static_cast<int>(min(thread::hardware_concurrency(), 16u)) };
+
+	for (auto [width, height] : { pair{ 3840, 2160 }, pair{ 7680, 4320 } })
+	{
+		AVFrame_ptr frame{ CreateRandomFrame(AV_PIX_FMT_YUV420P, width, height, 1) };
+		AVFrame_ptr output{ AllocateFrame(AV_PIX_FMT_NV12, width, height) };
+		AVFrame_ptr scaledOutput{ AllocateFrame(AV_PIX_FMT_NV12, width / 2, height / 2) };
+
+		for (int threadCount{ 1 }; threadCount <= maxThreadCount; threadCount *= 2)
+		{
+			const double kernelTime{ MeasureMilliseconds(RUN_COUNT, [&]()
+				{
+					concurrency::parallel_for(0, threadCount, [&](int sliceIndex)
+						{
+							ConvertToNV12(frame.get(), output->data, output->linesize, sliceIndex, threadCount);
+						});
+				}) };
+
+			SwsContext_ptr swsContext{ sws_alloc_context() };
+			THROW_IF_NULL_ALLOC(swsContext);
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_int(swsContext.get(), "srcw", width, 0));
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_int(swsContext.get(), "srch", height, 0));
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_pixel_fmt(swsContext.get(), "src_format", AV_PIX_FMT_YUV420P, 0));
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_int(swsContext.get(), "dstw", width / 2, 0));
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_int(swsContext.get(), "dsth", height / 2, 0));
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_pixel_fmt(swsContext.get(), "dst_format", AV_PIX_FMT_NV12, 0));
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_int(swsContext.get(), "sws_flags", SWS_BILINEAR, 0));
+			THROW_HR_IF_FFMPEG_FAILED(av_opt_set_int(swsContext.get(), "threads", threadCount, 0));
+			THROW_HR_IF_FFMPEG_FAILED(sws_init_context(swsContext.get(), nullptr, nullptr));
+
+			const double scaleTime{ MeasureMilliseconds(RUN_COUNT, [&]()
+				{
+					THROW_HR_IF_FFMPEG_FAILED(sws_scale_frame(swsContext.get(), scaledOutput.get(), frame.get()));
+				}) };
+
+			printf("  %4dx%-4d %2d threads  NV12 kernel %7.3f ms  swscale to %dx%d %7.3f ms\n",
+				width, height, threadCount, kernelTime, width / 2, height / 2, scaleTime);
+		}
+	}
+}
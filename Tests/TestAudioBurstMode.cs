@@ -0,0 +1,143 @@
+﻿//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+using FFmpegInterop;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using Microsoft.VisualStudio.TestTools.UnitTesting.Logging;
+using System;
+using System.Runtime.InteropServices.WindowsRuntime;
+using System.Text.RegularExpressions;
+using System.Threading;
+using System.Threading.Tasks;
+using Windows.Media.Core;
+using Windows.Media.Playback;
+using Windows.Storage;
+using Windows.Storage.Streams;
+
+namespace UnitTest.Windows
+{
+    [TestClass]
+    public class TestAudioBurstMode
+    {
+        // How long each mode plays for. The test file is shorter than this, so it loops.
+        private static readonly TimeSpan PlaybackTime = TimeSpan.FromSeconds(60);
+
+        // Logged by each decode-ahead thread as it exits
+        private static readonly Regex DecodeAheadUsage = new Regex(@"Decode-ahead thread exiting\. Wakeups = (\d+), CPU Time = (\d+) hns");
+
+        private class PlaybackStats
+        {
+            public long SampleRequests;
+            public long DecodeWakeups;
+            public long DecodeCpuTime; // hns
+        }
+
+        private async Task<IRandomAccessStream> OpenTestFile(string name)
+        {
+            var uri = new Uri("ms-appx:///TestFiles//" + name);
+            StorageFile file = await StorageFile.GetFileFromApplicationUriAsync(uri);
+            return await file.OpenAsync(FileAccessMode.Read);
+        }
+
+        private async Task<PlaybackStats> PlayAudioOnly(bool audioBurstMode)
+        {
+            PlaybackStats stats = new PlaybackStats();
+
+            EventHandler<LogEventArgs> logHandler = (sender, args) =>
+            {
+                Match match = DecodeAheadUsage.Match(args.Message);
+                if (match.Success)
+                {
+                    Interlocked.Add(ref stats.DecodeWakeups, long.Parse(match.Groups[1].Value));
+                    Interlocked.Add(ref stats.DecodeCpuTime, long.Parse(match.Groups[2].Value));
+                }
+            };
+
+            FFmpegInteropLogging.Log += logHandler;
+
+            try
+            {
+                IRandomAccessStream stream = await OpenTestFile("silence with album art.mp3");
+
+                IActivationFactory mssFactory = WindowsRuntimeMarshal.GetActivationFactory(typeof(MediaStreamSource));
+                MediaStreamSource mss = mssFactory.ActivateInstance() as MediaStreamSource;
+
+                // Decode MP3 ourselves so burst mode applies. Both modes decode on the decode-ahead thread,
+                // so the only difference between them is whether it works in bursts.
+                var config = new FFmpegInteropMSSConfig
+                {
+                    ForceAudioDecode = true,
+                    DecodeAheadDepth = 1,
+                    AudioBurstMode = audioBurstMode
+                };
+
+                FFmpegInteropMSS.InitializeFromStream(stream, mss, config);
+
+                // These handlers are added after FFmpegInteropMSS's own, so they run after it.
+                // By the time Closed is raised here, the decode-ahead threads have exited and logged their usage.
+                var closed = new TaskCompletionSource<bool>();
+                mss.SampleRequested += (sender, args) => Interlocked.Increment(ref stats.SampleRequests);
+                mss.Closed += (sender, args) => closed.TrySetResult(true);
+
+                var failed = new TaskCompletionSource<bool>();
+                using (MediaPlayer player = new MediaPlayer())
+                {
+                    player.IsMuted = true;
+                    player.IsLoopingEnabled = true;
+                    player.MediaFailed += (sender, args) => failed.TrySetException(new Exception("Playback failed: " + args.ErrorMessage));
+                    player.Source = MediaSource.CreateFromMediaStreamSource(mss);
+                    player.Play();
+
+                    // Play for a fixed time, failing early if playback can't start
+                    Task delay = Task.Delay(PlaybackTime);
+                    if (await Task.WhenAny(delay, failed.Task) != delay)
+                    {
+                        await failed.Task;
+                    }
+
+                    player.Source = null;
+                }
+
+                await closed.Task;
+            }
+            finally
+            {
+                FFmpegInteropLogging.Log -= logHandler;
+            }
+
+            Logger.LogMessage("Burst mode {0}: {1} sample requests, {2} decode wakeups, {3:F1} ms decode thread CPU time in {4:F0} s",
+                audioBurstMode ? "on" : "off", stats.SampleRequests, stats.DecodeWakeups, stats.DecodeCpuTime / 10000.0, PlaybackTime.TotalSeconds);
+
+            return stats;
+        }
+
+        [TestMethod]
+        public async Task AudioBurstMode_Wakeups()
+        {
+            PlaybackStats burstOff = await PlayAudioOnly(false);
+            PlaybackStats burstOn = await PlayAudioOnly(true);
+
+            // Both modes play the same audio, so the pipeline asks for it at the same cadence.
+            // Burst mode should wake the decoder less often.
+            Assert.IsTrue(burstOff.SampleRequests > 0);
+            Assert.IsTrue(burstOn.SampleRequests > 0);
+            Assert.IsTrue(burstOff.DecodeWakeups > 0);
+            Assert.IsTrue(burstOn.DecodeWakeups < burstOff.DecodeWakeups);
+        }
+    }
+}
@@ -0,0 +1,143 @@
+﻿//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+using FFmpegInterop;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using Microsoft.VisualStudio.TestTools.UnitTesting.Logging;
+using System;
+using System.Diagnostics;
+using System.Threading.Tasks;
+using Windows.Storage;
+using Windows.Storage.Streams;
+
+namespace UnitTest.Windows
+{
+    [TestClass]
+    public class TestAudioExtractor
+    {
+        private async Task<IRandomAccessStream> OpenTestFile(string name)
+        {
+            var uri = new Uri("ms-appx:///TestFiles//" + name);
+            StorageFile file = await StorageFile.GetFileFromApplicationUriAsync(uri);
+            return await file.OpenAsync(FileAccessMode.Read);
+        }
+
+        [TestMethod]
+        public void ExtractAudio_Null()
+        {
+            // FFmpegInteropAudioExtractor should throw if stream is null
+            try
+            {
+                new FFmpegInteropAudioExtractor(null, 1, 16000, TimeSpan.Zero);
+                Assert.IsTrue(false);
+            }
+            catch (Exception)
+            {
+                // Call threw as expected
+            }
+        }
+
+        [TestMethod]
+        public async Task ExtractAudio_Bad_Input()
+        {
+            IRandomAccessStream stream = await OpenTestFile("test.txt");
+
+            // FFmpegInteropAudioExtractor should throw since test.txt is not a valid media file
+            try
+            {
+                new FFmpegInteropAudioExtractor(stream, 1, 16000, TimeSpan.Zero);
+                Assert.IsTrue(false);
+            }
+            catch (Exception)
+            {
+                // Call threw as expected
+            }
+        }
+
+        [TestMethod]
+        public async Task ExtractAudio_Mono_16kHz()
+        {
+            IRandomAccessStream stream = await OpenTestFile("silence with album art.mp3");
+
+            FFmpegInteropAudioExtractor extractor = new FFmpegInteropAudioExtractor(stream, 1, 16000, TimeSpan.Zero);
+            Assert.AreEqual(1u, extractor.ChannelCount);
+            Assert.AreEqual(16000u, extractor.SampleRate);
+            Assert.IsTrue(extractor.Duration.TotalMilliseconds > 0);
+
+            // Read every chunk. Each one is a whole number of float samples, and the position advances past it.
+            long sampleCount = 0;
+            TimeSpan lastPosition = extractor.Position;
+            IBuffer chunk;
+            while ((chunk = extractor.ReadChunk()) != null)
+            {
+                Assert.IsTrue(chunk.Length > 0);
+                Assert.AreEqual(0u, chunk.Length % sizeof(float));
+                Assert.IsTrue(extractor.Position > lastPosition);
+
+                sampleCount += chunk.Length / sizeof(float);
+                lastPosition = extractor.Position;
+            }
+
+            Assert.AreEqual(extractor.Duration.TotalSeconds * 16000, sampleCount, 0.1 * 16000);
+
+            // Seeking back to the start restarts extraction
+            extractor.Seek(TimeSpan.Zero);
+            Assert.AreEqual(TimeSpan.Zero, extractor.Position);
+            Assert.IsNotNull(extractor.ReadChunk());
+
+            // Closing releases the file, after which reads throw
+            extractor.Dispose();
+            try
+            {
+                extractor.ReadChunk();
+                Assert.IsTrue(false);
+            }
+            catch (Exception)
+            {
+                // Call threw as expected
+            }
+        }
+
+        [TestMethod]
+        public async Task ExtractAudio_Throughput()
+        {
+            IRandomAccessStream stream = await OpenTestFile("silence with album art.mp3");
+
+            // Extract the whole file as mono 16 kHz, the way a transcription pipeline would, and time it
+            Stopwatch stopwatch = Stopwatch.StartNew();
+            long sampleCount = 0;
+            using (FFmpegInteropAudioExtractor extractor = new FFmpegInteropAudioExtractor(stream, 1, 16000, TimeSpan.Zero))
+            {
+                IBuffer chunk;
+                while ((chunk = extractor.ReadChunk()) != null)
+                {
+                    sampleCount += chunk.Length / sizeof(float);
+                }
+            }
+            stopwatch.Stop();
+
+            // Report throughput as a multiple of realtime. Extraction involves no playback, so it must be faster than realtime.
+            double audioSeconds = sampleCount / 16000.0;
+            double realtimeMultiple = audioSeconds / stopwatch.Elapsed.TotalSeconds;
+            Logger.LogMessage("Extracted {0:F1} s of audio in {1:F1} ms ({2:F0}x realtime)", audioSeconds, stopwatch.Elapsed.TotalMilliseconds, realtimeMultiple);
+
+            Assert.IsTrue(sampleCount > 0);
+            Assert.IsTrue(realtimeMultiple > 1.0);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+﻿//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+using FFmpegInterop;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using System;
+
+namespace UnitTest.Windows
+{
+    [TestClass]
+    public class TestAudioLevelMeter
+    {
+        [TestMethod]
+        public void AudioLevelMeter_Empty()
+        {
+            // A meter that hasn't measured anything yet shouldn't have any levels
+            AudioLevelMeter meter = new AudioLevelMeter();
+            Assert.IsNull(meter.GetLatestLevels());
+            Assert.IsNull(meter.GetLevels(TimeSpan.Zero));
+        }
+
+        [TestMethod]
+        public void AudioLevelMeter_Config()
+        {
+            FFmpegInteropMSSConfig config = new FFmpegInteropMSSConfig();
+            Assert.IsNull(config.AudioLevelMeter);
+
+            AudioLevelMeter meter = new AudioLevelMeter();
+            config.AudioLevelMeter = meter;
+            Assert.AreSame(meter, config.AudioLevelMeter);
+        }
+    }
+}
@@ -0,0 +1,117 @@
+﻿//*****************************************************************************
+//
+//	Copyright 2023 Microsoft Corporation
+//
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http ://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+//
+//*****************************************************************************
+
+using FFmpegInterop;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using System;
+using System.Threading.Tasks;
+using Windows.Foundation;
+using Windows.Storage;
+using Windows.Storage.Streams;
+
+namespace UnitTest.Windows
+{
+    [TestClass]
+    public class TestAudioScanner
+    {
+        private async Task<IRandomAccessStream> OpenTestFile(string name)
+        {
+            var uri = new Uri("ms-appx:///TestFiles//" + name);
+            StorageFile file = await StorageFile.GetFileFromApplicationUriAsync(uri);
+            return await file.OpenAsync(FileAccessMode.Read);
+        }
+
+        [TestMethod]
+        public async Task ScanAudio_Null()
+        {
+            // FFmpegInteropAudioScanner.ScanAsync should throw if stream is null
+            try
+            {
+                await FFmpegInteropAudioScanner.ScanAsync(null, 0);
+                Assert.IsTrue(false);
+            }
+            catch (Exception)
+            {
+                // Call threw as expected
+            }
+        }
+
+        [TestMethod]
+        public async Task ScanAudio_Bad_Input()
+        {
+            IRandomAccessStream stream = await OpenTestFile("test.txt");
+
+            // FFmpegInteropAudioScanner.ScanAsync should throw since test.txt is not a valid media file
+            try
+            {
+                await FFmpegInteropAudioScanner.ScanAsync(stream, 0);
+                Assert.IsTrue(false);
+            }
+            catch (Exception)
+            {
+                // Call threw as expected
+            }
+        }
+
+        [TestMethod]
+        public async Task ScanAudio_Silence()
+        {
+            IRandomAccessStream stream = await OpenTestFile("silence with album art.mp3");
+
+            double lastProgress = 0.0;
+            IAsyncOperationWithProgress<AudioScanResult, double> operation = FFmpegInteropAudioScanner.ScanAsync(stream, 0);
+            operation.Progress = (op, progress) =>
+            {
+                Assert.IsTrue(progress >= lastProgress && progress <= 1.0);
+                lastProgress = progress;
+            };
+
+            AudioScanResult result = await operation;
+
+            Assert.IsTrue(result.Duration.TotalMilliseconds > 0);
+            Assert.IsTrue(result.SampleRate > 0);
+            Assert.IsTrue(result.ChannelCount > 0);
+            Assert.AreEqual(1.0, lastProgress);
+
+            // Silence is below the absolute gate
+            Assert.IsTrue(double.IsNegativeInfinity(result.IntegratedLoudness));
+
+            // Each level halves the bins until there's one left. Every peak is silent.
+            Assert.AreEqual(256u, result.SamplesPerPeak);
+            Assert.IsTrue(result.PeakLevelCount > 0);
+
+            int previousBinCount = int.MaxValue;
+            for (uint level = 0; level < result.PeakLevelCount; level++)
+            {
+                float[] peaks = result.GetPeaks(level);
+                int binCount = peaks.Length / (2 * (int)result.ChannelCount);
+
+                Assert.AreEqual(0, peaks.Length % (2 * (int)result.ChannelCount));
+                Assert.IsTrue(binCount < previousBinCount);
+                previousBinCount = binCount;
+
+                foreach (float peak in peaks)
+                {
+                    Assert.IsTrue(Math.Abs(peak) < 0.001f);
+                }
+            }
+
+            Assert.AreEqual(1, previousBinCount);
+        }
+    }
+}